@@ -0,0 +1,153 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "AccuracyTrace.h"
+#include "DistanceError.h"
+#include "DistanceFile.h"
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+// Serializes the samples appended by concurrent solves in this process
+std::mutex append_mutex;
+
+double seconds_between(std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double>(end - begin).count();
+}
+
+void write_csv_field(std::ostream &out, const std::string &field) {
+  out << '"';
+  for (size_t i = 0; i < field.size(); ++i) {
+    if (field[i] == '"') {
+      out << '"';
+    }
+    out << field[i];
+  }
+  out << '"';
+}
+
+}
+
+AccuracyTrace::AccuracyTrace()
+    : enable_sampling(false),
+      start_time(Clock::now()),
+      sample_start(start_time),
+      sampling_seconds(0) {
+}
+
+bool AccuracyTrace::load_reference(const std::string &file_name,
+                                   MeshIndex n_vertices) {
+  reference.resize(0);
+  DenseVector values;
+  if (!DistanceFile::load(file_name.c_str(), values)) {
+    std::cerr << "Error: unable to read the accuracy reference file "
+              << file_name << std::endl;
+    return false;
+  }
+
+  if (values.size() != n_vertices) {
+    std::cerr << "Error: the accuracy reference file " << file_name << " has "
+              << values.size() << " values for " << n_vertices << " vertices"
+              << std::endl;
+    return false;
+  }
+
+  reference.swap(values);
+  return true;
+}
+
+void AccuracyTrace::start(bool enable) {
+  enable_sampling = enable && reference.size() > 0;
+  sample_list.clear();
+  start_time = Clock::now();
+  sample_start = start_time;
+  sampling_seconds = 0;
+}
+
+void AccuracyTrace::begin_sample() {
+  sample_start = Clock::now();
+}
+
+void AccuracyTrace::add(int iteration, const DenseVector &dist_values,
+                        const std::vector<MeshIndex> &source_vertices) {
+  Clock::time_point integrated = Clock::now();
+
+  Sample sample;
+  sample.iteration = iteration;
+  sample.seconds = seconds_between(start_time, integrated) - sampling_seconds;
+  sample.mean_relative_error = DistanceError::mean_relative_error(
+      dist_values, reference, source_vertices);
+  sample_list.push_back(sample);
+
+  sampling_seconds += seconds_between(sample_start, Clock::now());
+}
+
+bool AccuracyTrace::append(const std::string &file_name,
+                           const std::string &mesh, const Parameters &param,
+                           int n_threads) const {
+  std::lock_guard<std::mutex> lock(append_mutex);
+  bool new_file = !std::ifstream(file_name.c_str()).good();
+  std::ofstream ofile(file_name.c_str(), std::ios::app);
+  if (!ofile.is_open()) {
+    std::cerr << "Error: unable to write accuracy trace file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  // The parameters as they are written in the parameter file
+  std::ostringstream solve;
+  solve << (param.solver_type == 0 ? "face" : "edge") << "," << n_threads
+        << "," << param.heat_solver_eps << "," << param.heat_solver_max_iter
+        << "," << param.grad_solver_eps << "," << param.grad_solver_max_iter
+        << "," << param.penalty;
+
+  ofile.precision(std::numeric_limits<double>::digits10 + 2);
+  if (new_file) {
+    ofile << "mesh,solver,threads,heat_solver_eps,heat_solver_max_iter,"
+          << "grad_solver_eps,grad_solver_max_iter,penalty,iteration,seconds,"
+          << "mean_relative_error\n";
+  }
+
+  for (size_t i = 0; i < sample_list.size(); ++i) {
+    const Sample &s = sample_list[i];
+    write_csv_field(ofile, mesh);
+    ofile << "," << solve.str() << "," << s.iteration << "," << s.seconds
+          << "," << s.mean_relative_error << "\n";
+  }
+
+  return ofile.good();
+}
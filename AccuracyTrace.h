@@ -0,0 +1,108 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef ACCURACYTRACE_H_
+#define ACCURACYTRACE_H_
+
+#include "EigenTypes.h"
+#include "Parameters.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Error of the distances against a reference field at regular ADMM
+// iterations of a solve, for choosing the solver parameters that reach an
+// accuracy target in the least time.
+//
+// A sample integrates the current gradients into the distances and measures
+// their mean relative error against the reference, as CompareDistance does.
+// Its time is the time since start() that a solve stopping at the sampled
+// iteration would take: it includes the integration of the sample, but not
+// the integrations and error computations of earlier samples.
+//
+// The samples are appended to a CSV file at the end of the solve, with the
+// columns
+//   mesh,solver,threads,heat_solver_eps,heat_solver_max_iter,
+//   grad_solver_eps,grad_solver_max_iter,penalty,iteration,seconds,
+//   mean_relative_error
+// and a header line if the file is new.
+class AccuracyTrace {
+ public:
+  struct Sample {
+    int iteration;
+    double seconds;
+    double mean_relative_error;
+  };
+
+  AccuracyTrace();
+
+  // Read the reference distances from a file written by DistanceFile, for a
+  // mesh with n_vertices vertices
+  bool load_reference(const std::string &file_name, MeshIndex n_vertices);
+
+  // Clear the samples, and enable sampling if asked and a reference is
+  // loaded; the times of the samples start from here
+  void start(bool enable);
+
+  bool enabled() const {
+    return enable_sampling;
+  }
+
+  // Mark the start of the integration of a sample
+  void begin_sample();
+
+  // Add the sample of the distances integrated since begin_sample()
+  void add(int iteration, const DenseVector &dist_values,
+           const std::vector<MeshIndex> &source_vertices);
+
+  const std::vector<Sample>& samples() const {
+    return sample_list;
+  }
+
+  // Append the samples to the CSV file, with the parameters of the solve
+  bool append(const std::string &file_name, const std::string &mesh,
+              const Parameters &param, int n_threads) const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  DenseVector reference;
+  bool enable_sampling;
+  std::vector<Sample> sample_list;
+
+  // Start of the solve and of the current sample, and the time spent on
+  // earlier samples
+  Clock::time_point start_time, sample_start;
+  double sampling_seconds;
+};
+
+#endif /* ACCURACYTRACE_H_ */
@@ -0,0 +1,127 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "FaceBasedGeodesicSolver.h"
+#include "EdgeBasedGeodesicSolver.h"
+#include "BatchPipeline.h"
+#include "GetRSS.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Read the batch list file. Each non-comment line contains a mesh file and
+// the distance file to be written for it, separated by whitespace.
+bool load_batch_tasks(const char *file_name, std::vector<BatchTask> &tasks) {
+  std::ifstream ifile(file_name);
+  if (!ifile.is_open()) {
+    std::cerr << "Error while opening file " << file_name << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(ifile, line)) {
+    line_number++;
+    std::string::size_type pos = line.find_first_not_of(" \t\r");
+    if (pos == std::string::npos || line.at(pos) == '#') {
+      continue;
+    }
+
+    std::istringstream istr(line);
+    BatchTask task;
+    if (!(istr >> task.mesh_file >> task.distance_file)) {
+      std::cerr << "Error parsing line " << line_number << " of " << file_name
+                << std::endl;
+      return false;
+    }
+
+    tasks.push_back(task);
+  }
+
+  if (tasks.empty()) {
+    std::cerr << "Error: no mesh listed in " << file_name << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+template<typename SolverT>
+bool run_batch(const Parameters &param, const std::vector<BatchTask> &tasks) {
+  BatchPipeline<SolverT> pipeline(param);
+  bool success = pipeline.run(tasks);
+  pipeline.print_utilization();
+  return success;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: BatchGeodDistSolver PARAMETERS_FILE BATCH_LIST_FILE"
+              << std::endl;
+    return 1;
+  }
+
+  Parameters param;
+  if (!param.load(argv[1])) {
+    std::cerr << "Error: unable to load parameter file" << std::endl;
+    return 1;
+  }
+  param.output_options();
+
+  // Each mesh in the batch needs its own operator
+  if (!param.operator_store.empty()) {
+    std::cerr << "Warning: OperatorStore is ignored by BatchGeodDistSolver"
+              << std::endl;
+    param.operator_store.clear();
+  }
+
+  std::vector<BatchTask> tasks;
+  if (!load_batch_tasks(argv[2], tasks)) {
+    std::cerr << "Error: unable to load batch list file" << std::endl;
+    return 1;
+  }
+
+  bool success =
+      (param.solver_type == 0) ?
+          run_batch<FaceBasedGeodesicSolver>(param, tasks) :
+          run_batch<EdgeBasedGeodesicSolver>(param, tasks);
+
+  size_t peak_mem = getPeakRSS();
+  std::cout << "Peak memory usage in bytes: " << peak_mem << std::endl;
+
+  if (!success) {
+    std::cerr << "Error: some meshes in the batch were not processed"
+              << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
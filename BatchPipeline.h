@@ -0,0 +1,239 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BATCHPIPELINE_H_
+#define BATCHPIPELINE_H_
+
+#include "EigenTypes.h"
+#include "Parameters.h"
+#include "DistanceFile.h"
+#include "BoundedQueue.h"
+#include "OMPHelper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A mesh to be processed in a batch run, and the file for its distance values
+struct BatchTask {
+  std::string mesh_file;
+  std::string distance_file;
+};
+
+// Pipelined batch executor. Three stages run concurrently and are connected by
+// bounded queues:
+//   1. load: read and normalize the next meshes (batch_loader_threads threads,
+//      each building its operator alone);
+//   2. solve: run the solver on the current mesh, using batch_solver_threads
+//      OpenMP threads;
+//   3. write: encode and write the distance values of previous meshes
+//      (batch_writer_threads threads).
+// SolverT is FaceBasedGeodesicSolver or EdgeBasedGeodesicSolver.
+template<typename SolverT>
+class BatchPipeline {
+ public:
+  explicit BatchPipeline(const Parameters &para)
+      : param(para),
+        n_loader_threads(para.batch_loader_threads),
+        n_solver_threads(para.batch_solver_threads),
+        n_writer_threads(para.batch_writer_threads),
+        wall_time(0),
+        load_busy_time(0),
+        solve_busy_time(0),
+        write_busy_time(0) {
+    if (n_solver_threads <= 0) {
+      int n_hw_threads = std::thread::hardware_concurrency();
+      n_solver_threads = std::max(
+          1, n_hw_threads - n_loader_threads - n_writer_threads);
+    }
+  }
+
+  // Process all tasks. Returns false if any of them failed.
+  bool run(const std::vector<BatchTask> &tasks) {
+    BoundedQueue<LoadedMesh> load_queue(param.batch_queue_capacity);
+    BoundedQueue<SolvedMesh> solve_queue(param.batch_queue_capacity);
+    std::atomic<int> next_task(0), n_failed(0);
+    std::atomic<int> active_loaders(n_loader_threads);
+    int n_tasks = tasks.size();
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+
+    // Stage 1: load meshes
+    for (int t = 0; t < n_loader_threads; ++t) {
+      threads.push_back(std::thread([&]() {
+        // The operator of each mesh is built by its loader thread alone, so
+        // that the loaders do not compete with the solver threads
+        SerialScope loader_serial(true);
+        double busy = 0;
+        int id = 0;
+        while ((id = next_task++) < n_tasks) {
+          Clock::time_point t0 = Clock::now();
+          LoadedMesh item;
+          item.task_id = id;
+          item.solver.reset(new SolverT());
+          bool loaded = item.solver->load(tasks[id].mesh_file.c_str(), param);
+          busy += seconds_since(t0);
+
+          if (!loaded) {
+            std::cerr << "Error: unable to load mesh " << tasks[id].mesh_file
+                      << std::endl;
+            n_failed++;
+          } else if (!load_queue.push(std::move(item))) {
+            break;
+          }
+        }
+
+        add_busy_time(load_busy_time, busy);
+        if (--active_loaders == 0) {
+          load_queue.close();
+        }
+      }));
+    }
+
+    // Stage 2: solve
+    threads.push_back(std::thread([&]() {
+#ifdef USE_OPENMP
+      omp_set_num_threads(n_solver_threads);
+#elif defined(USE_TASK_SCHEDULER)
+      TaskScheduler solver_pool(n_solver_threads);
+      TaskScheduler::Scope solver_scope(solver_pool);
+#endif
+      double busy = 0;
+      LoadedMesh item;
+      while (load_queue.pop(item)) {
+        Clock::time_point t0 = Clock::now();
+        bool solved = item.solver->compute();
+        SolvedMesh result;
+        result.task_id = item.task_id;
+        if (solved) {
+          result.distance = item.solver->get_distance_values();
+        }
+        item.solver.reset();  // Release solver memory before the next mesh
+        busy += seconds_since(t0);
+
+        if (!solved) {
+          std::cerr << "Error: solver failed for mesh "
+                    << tasks[item.task_id].mesh_file << std::endl;
+          n_failed++;
+        } else {
+          solve_queue.push(std::move(result));
+        }
+      }
+
+      add_busy_time(solve_busy_time, busy);
+      solve_queue.close();
+    }));
+
+    // Stage 3: encode and write results
+    for (int t = 0; t < n_writer_threads; ++t) {
+      threads.push_back(std::thread([&]() {
+        double busy = 0;
+        SolvedMesh result;
+        std::string buffer;
+        while (solve_queue.pop(result)) {
+          Clock::time_point t0 = Clock::now();
+          const char *file_name = tasks[result.task_id].distance_file.c_str();
+          if (!(DistanceFile::encode(result.distance, buffer)
+              && DistanceFile::write_encoded(file_name, buffer))) {
+            std::cerr << "Error in saving geodesic distance to " << file_name
+                      << std::endl;
+            n_failed++;
+          }
+          busy += seconds_since(t0);
+        }
+
+        add_busy_time(write_busy_time, busy);
+      }));
+    }
+
+    for (int i = 0; i < static_cast<int>(threads.size()); ++i) {
+      threads[i].join();
+    }
+
+    wall_time = seconds_since(start);
+    return n_failed == 0;
+  }
+
+  // Print the busy time and utilization of each stage
+  void print_utilization() const {
+    std::cout << std::endl;
+    std::cout << "====== Pipeline utilization ======" << std::endl;
+    print_stage("Load", n_loader_threads, load_busy_time);
+    print_stage("Solve", 1, solve_busy_time);
+    print_stage("Write", n_writer_threads, write_busy_time);
+    std::cout << "Solver threads: " << n_solver_threads << std::endl;
+    std::cout << "Total wall time: " << wall_time << " seconds" << std::endl;
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct LoadedMesh {
+    int task_id;
+    std::unique_ptr<SolverT> solver;
+  };
+
+  struct SolvedMesh {
+    int task_id;
+    DenseVector distance;
+  };
+
+  Parameters param;
+  int n_loader_threads, n_solver_threads, n_writer_threads;
+
+  double wall_time;
+  double load_busy_time, solve_busy_time, write_busy_time;  // Summed over the threads of each stage
+  std::mutex stats_mutex;
+
+  static double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+  }
+
+  void add_busy_time(double &stage_busy_time, double busy) {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stage_busy_time += busy;
+  }
+
+  void print_stage(const char *name, int n_threads, double busy) const {
+    double utilization =
+        wall_time > 0 ? busy / (wall_time * n_threads) * 100 : 0;
+    std::cout << name << " stage (" << n_threads << " thread"
+              << (n_threads > 1 ? "s" : "") << "): busy " << busy
+              << " seconds, utilization " << utilization << "%" << std::endl;
+  }
+};
+
+#endif /* BATCHPIPELINE_H_ */
@@ -0,0 +1,171 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "KernelBenchmark.h"
+#include "MeshGenerator.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Build the operator of a mesh file, or of a synthetic mesh named by a
+// MeshGenerator specification
+bool build_operator(const std::string &mesh_name, GeodesicOperator &op) {
+  if (!MeshGenerator::is_synthetic(mesh_name)) {
+    return op.build(mesh_name.c_str());
+  }
+
+  surface_mesh::Surface_mesh mesh;
+  return MeshGenerator::generate(mesh_name, mesh) && op.build(mesh);
+}
+
+template<typename SolverT>
+bool run_benchmark(const std::string &mesh_name, const char *solver_name,
+                   const GeodesicOperator &op, const Parameters &param,
+                   std::ofstream &results_file) {
+  KernelBenchmark<SolverT> benchmark(param.benchmark_warmup,
+                                     param.benchmark_repetitions);
+  if (!benchmark.run(op, param)) {
+    std::cerr << "Error: unable to run the " << solver_name
+              << " kernels on " << mesh_name << std::endl;
+    return false;
+  }
+
+  std::cout << std::endl << "====== " << solver_name << " solver kernels ("
+            << param.benchmark_repetitions << " runs after "
+            << param.benchmark_warmup << " warm-up runs, times in ms) ======"
+            << std::endl;
+  char line[256];
+  std::snprintf(line, sizeof(line), "%-38s %10s %10s %10s %10s %10s %7s",
+                "kernel", "min", "median", "mean", "stddev", "max", "cv");
+  std::cout << line << std::endl;
+
+  const std::vector<typename KernelBenchmark<SolverT>::Result> &results =
+      benchmark.results();
+  for (size_t i = 0; i < results.size(); ++i) {
+    const typename KernelBenchmark<SolverT>::Result &r = results[i];
+    double cv = r.mean_seconds > 0 ? r.stddev_seconds / r.mean_seconds : 0;
+    std::snprintf(line, sizeof(line),
+                  "%-38s %10.4f %10.4f %10.4f %10.4f %10.4f %6.1f%%",
+                  r.kernel.c_str(), r.min_seconds * 1e3,
+                  r.median_seconds * 1e3, r.mean_seconds * 1e3,
+                  r.stddev_seconds * 1e3, r.max_seconds * 1e3, cv * 100);
+    std::cout << line << std::endl;
+
+    if (results_file.is_open()) {
+      results_file << mesh_name << "," << op.n_vertices << "," << op.n_faces
+                   << "," << solver_name << "," << available_threads() << ","
+                   << r.kernel << "," << r.repetitions << "," << r.min_seconds
+                   << "," << r.median_seconds << "," << r.mean_seconds << ","
+                   << r.stddev_seconds << "," << r.max_seconds << "\n";
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: paraheat_bench PARAMETERS_FILE MESH_FILE|KIND:FACES"
+              << " [MESH_FILE|KIND:FACES ...]" << std::endl;
+    return 1;
+  }
+
+  Parameters param;
+  if (!param.load(argv[1])) {
+    std::cerr << "Error: unable to load parameter file" << std::endl;
+    return 1;
+  }
+
+#ifdef USE_TASK_SCHEDULER
+  TaskScheduler scheduler(0, param.thread_affinity);
+  TaskScheduler::Scope scheduler_scope(scheduler);
+#endif
+  NumaPlacement::pin_threads(param.thread_affinity);
+
+  std::ofstream results_file;
+  if (!param.benchmark_results_file.empty()) {
+    bool new_file = !std::ifstream(param.benchmark_results_file.c_str()).good();
+    results_file.open(param.benchmark_results_file.c_str(), std::ios::app);
+    if (!results_file.is_open()) {
+      std::cerr << "Error: unable to open benchmark results file "
+                << param.benchmark_results_file << std::endl;
+      return 1;
+    }
+
+    results_file.precision(9);
+    if (new_file) {
+      results_file << "mesh,vertices,faces,solver,threads,kernel,repetitions,"
+                   << "min_seconds,median_seconds,mean_seconds,"
+                   << "stddev_seconds,max_seconds\n";
+    }
+  }
+
+  // Expand the ranges of synthetic meshes, e.g. "icosphere:10000-100000000"
+  bool success = true;
+  std::vector<std::string> mesh_names;
+  for (int i = 2; i < argc; ++i) {
+    std::vector<MeshGenerator::Spec> specs;
+    if (!MeshGenerator::is_synthetic(argv[i])) {
+      mesh_names.push_back(argv[i]);
+    } else if (MeshGenerator::parse(argv[i], specs)) {
+      for (size_t k = 0; k < specs.size(); ++k) {
+        mesh_names.push_back(MeshGenerator::name(specs[k]));
+      }
+    } else {
+      std::cerr << "Error: invalid synthetic mesh " << argv[i] << std::endl;
+      success = false;
+    }
+  }
+
+  for (size_t i = 0; i < mesh_names.size(); ++i) {
+    const std::string &mesh_name = mesh_names[i];
+    GeodesicOperator op;
+    if (!build_operator(mesh_name, op)) {
+      std::cerr << "Error: unable to load mesh " << mesh_name << std::endl;
+      success = false;
+      continue;
+    }
+
+    std::cout << std::endl << "Mesh " << mesh_name << ": " << op.n_vertices
+              << " vertices, " << op.n_faces << " faces, " << op.n_edges
+              << " edges, " << available_threads() << " threads" << std::endl;
+    success = run_benchmark<FaceBasedGeodesicSolver>(mesh_name, "face", op,
+                                                     param, results_file)
+        && success;
+    success = run_benchmark<EdgeBasedGeodesicSolver>(mesh_name, "edge", op,
+                                                     param, results_file)
+        && success;
+  }
+
+  return success ? 0 : 1;
+}
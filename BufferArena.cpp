@@ -0,0 +1,399 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "BufferArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Smallest region backed by transparent huge pages. The page faults and TLB
+// misses of smaller regions cost little, while rounding the buffers of each
+// phase to huge pages adds a large part to their resident memory.
+const size_t kMinTransparentHugePages = 32;
+
+size_t round_up(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+}
+
+BufferArena::BufferArena()
+    : next_block(0),
+      base(NULL),
+      capacity_bytes(0),
+      mapped_bytes(0),
+      allocation(NULL),
+      mode(REGULAR_PAGES) {
+}
+
+BufferArena::~BufferArena() {
+  release();
+}
+
+void BufferArena::begin_layout() {
+  release();
+  blocks.clear();
+  external_blocks.clear();
+}
+
+void* BufferArena::allocate_bytes(size_t bytes, int first_phase,
+                                  int last_phase) {
+  if (base == NULL) {
+    Block block = { bytes, 0, first_phase, last_phase };
+    blocks.push_back(block);
+    return NULL;
+  }
+
+  if (next_block >= static_cast<int>(blocks.size())
+      || blocks[next_block].bytes != bytes) {
+    std::cerr << "Error: solver buffers requested out of the planned layout"
+              << std::endl;
+    return NULL;
+  }
+
+  return base + blocks[next_block++].offset;
+}
+
+size_t BufferArena::plan_layout() {
+  std::vector<int> order(blocks.size());
+  for (int i = 0; i < static_cast<int>(order.size()); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    if (blocks[a].first_phase != blocks[b].first_phase) {
+      return blocks[a].first_phase < blocks[b].first_phase;
+    }
+    return blocks[a].bytes > blocks[b].bytes;
+  });
+
+  size_t layout_bytes = 0;
+  for (int i = 0; i < static_cast<int>(order.size()); ++i) {
+    Block &block = blocks[order[i]];
+
+    // Ranges used by the placed buffers that are live with this one
+    std::vector<std::pair<size_t, size_t> > used_ranges;
+    for (int j = 0; j < i; ++j) {
+      const Block &other = blocks[order[j]];
+      if (other.first_phase <= block.last_phase
+          && block.first_phase <= other.last_phase) {
+        used_ranges.push_back(
+            std::make_pair(other.offset, other.offset + other.bytes));
+      }
+    }
+    std::sort(used_ranges.begin(), used_ranges.end());
+
+    size_t offset = 0;
+    for (int j = 0; j < static_cast<int>(used_ranges.size()); ++j) {
+      if (offset + block.bytes <= used_ranges[j].first) {
+        break;
+      }
+      offset = std::max(offset, round_up(used_ranges[j].second, kAlignment));
+    }
+
+    block.offset = offset;
+    layout_bytes = std::max(layout_bytes, offset + block.bytes);
+  }
+
+  return layout_bytes;
+}
+
+size_t BufferArena::unshared_size() const {
+  size_t bytes = 0;
+  for (int i = 0; i < static_cast<int>(blocks.size()); ++i) {
+    bytes = round_up(bytes, kAlignment) + blocks[i].bytes;
+  }
+
+  return bytes;
+}
+
+size_t BufferArena::live_bytes(int phase) const {
+  size_t bytes = 0;
+  for (int i = 0; i < static_cast<int>(blocks.size()); ++i) {
+    if (blocks[i].first_phase <= phase && phase <= blocks[i].last_phase) {
+      bytes += blocks[i].bytes;
+    }
+  }
+
+  return bytes;
+}
+
+void BufferArena::count_external(size_t bytes, int first_phase,
+                                 int last_phase) {
+  Block block = { bytes, 0, first_phase, last_phase };
+  external_blocks.push_back(block);
+}
+
+size_t BufferArena::peak_bytes() const {
+  int last_phase = 0;
+  for (int i = 0; i < static_cast<int>(blocks.size()); ++i) {
+    last_phase = std::max(last_phase, blocks[i].last_phase);
+  }
+  for (int i = 0; i < static_cast<int>(external_blocks.size()); ++i) {
+    last_phase = std::max(last_phase, external_blocks[i].last_phase);
+  }
+
+  size_t peak = 0;
+  for (int phase = 0; phase <= last_phase; ++phase) {
+    size_t bytes = live_bytes(phase);
+    for (int i = 0; i < static_cast<int>(external_blocks.size()); ++i) {
+      const Block &block = external_blocks[i];
+      if (block.first_phase <= phase && phase <= block.last_phase) {
+        bytes += block.bytes;
+      }
+    }
+    peak = std::max(peak, bytes);
+  }
+
+  return peak;
+}
+
+void BufferArena::discard(int phase) {
+#ifdef __linux__
+  if (base == NULL) {
+    return;
+  }
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  for (int i = 0; i < static_cast<int>(blocks.size()); ++i) {
+    const Block &block = blocks[i];
+    if (block.first_phase != phase) {
+      continue;
+    }
+
+    // Pages partly used by neighboring buffers are kept
+    size_t begin = round_up(block.offset, page_size);
+    size_t end = (block.offset + block.bytes) / page_size * page_size;
+    if (begin < end) {
+      madvise(base + begin, end - begin, MADV_DONTNEED);
+    }
+  }
+#else
+  (void) phase;
+#endif
+}
+
+void BufferArena::retire(int phase) {
+#ifdef __linux__
+  if (base == NULL) {
+    return;
+  }
+
+  // Pages shared with buffers of later phases can be freed too, as those
+  // buffers are initialized in their first phase. Freed pages of a
+  // memory-backed region read as zero when they are used again.
+  int advice = file_backed() ? MADV_REMOVE : MADV_DONTNEED;
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  for (int i = 0; i < static_cast<int>(blocks.size()); ++i) {
+    const Block &block = blocks[i];
+    if (block.last_phase != phase) {
+      continue;
+    }
+
+    size_t begin = round_up(block.offset, page_size);
+    size_t end = (block.offset + block.bytes) / page_size * page_size;
+    if (begin < end) {
+      madvise(base + begin, end - begin, advice);
+    }
+  }
+#else
+  (void) phase;
+#endif
+}
+
+void BufferArena::prefetch(const void *data, size_t bytes) const {
+#ifdef __linux__
+  advise(data, bytes, MADV_WILLNEED);
+#else
+  (void) data;
+  (void) bytes;
+#endif
+}
+
+void BufferArena::stream(const void *data, size_t bytes) const {
+#ifdef __linux__
+  advise(data, bytes, MADV_SEQUENTIAL);
+#else
+  (void) data;
+  (void) bytes;
+#endif
+}
+
+void BufferArena::advise(const void *data, size_t bytes, int advice) const {
+#ifdef __linux__
+  if (!file_backed() || data == NULL || bytes == 0) {
+    return;
+  }
+
+  // madvise needs a page-aligned start
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = reinterpret_cast<uintptr_t>(data) / page_size * page_size;
+  uintptr_t end = reinterpret_cast<uintptr_t>(data) + bytes;
+  madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+#else
+  (void) data;
+  (void) bytes;
+  (void) advice;
+#endif
+}
+
+bool BufferArena::reserve_file(size_t bytes, const std::string &directory) {
+  release();
+  bytes = std::max(bytes, size_t(kAlignment));
+  if (!(file.create_temporary(directory) && file.map_writable(bytes))) {
+    std::cerr << "Error: unable to reserve " << bytes
+              << " bytes for solver buffers in " << directory << std::endl;
+    file.release();
+    return false;
+  }
+
+  base = file.data();
+  capacity_bytes = bytes;
+  next_block = 0;
+  return true;
+}
+
+bool BufferArena::reserve(size_t bytes, int page_mode) {
+  release();
+  bytes = std::max(bytes, size_t(kAlignment));
+  mode = REGULAR_PAGES;
+
+#ifdef __linux__
+  if (page_mode == EXPLICIT_HUGE_PAGES) {
+    size_t length = round_up(bytes, kHugePageSize);
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      allocation = p;
+      mapped_bytes = length;
+      base = static_cast<char*>(p);
+      mode = EXPLICIT_HUGE_PAGES;
+    } else {
+      std::cerr << "Warning: not enough explicit huge pages for "
+                << length / kHugePageSize
+                << " pages, using transparent huge pages" << std::endl;
+      page_mode = TRANSPARENT_HUGE_PAGES;
+    }
+  }
+
+  if (base == NULL) {
+    // Over-allocate so that the region can start at a huge page boundary,
+    // and return the unused head and tail to the OS
+    bool huge = (page_mode == TRANSPARENT_HUGE_PAGES
+        && bytes >= kMinTransparentHugePages * kHugePageSize);
+    size_t alignment = huge ? kHugePageSize : kAlignment;
+    size_t length = huge ? round_up(bytes, kHugePageSize) : bytes;
+    size_t padded_length = length + (huge ? kHugePageSize : 0);
+    void *p = mmap(NULL, padded_length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      std::cerr << "Error: unable to reserve " << bytes
+                << " bytes for solver buffers" << std::endl;
+      return false;
+    }
+
+    char *start = static_cast<char*>(p);
+    char *aligned = reinterpret_cast<char*>(round_up(
+        reinterpret_cast<uintptr_t>(start), alignment));
+    size_t head = aligned - start, tail = padded_length - head - length;
+    if (head > 0) {
+      munmap(start, head);
+    }
+    if (tail > 0) {
+      munmap(aligned + length, tail);
+    }
+
+    // The tail that does not fill a huge page stays on regular pages, so
+    // that its unused part is not made resident
+    size_t huge_length = bytes / kHugePageSize * kHugePageSize;
+    if (huge && huge_length > 0
+        && madvise(aligned, huge_length, MADV_HUGEPAGE) == 0) {
+      mode = TRANSPARENT_HUGE_PAGES;
+    }
+
+    allocation = aligned;
+    mapped_bytes = length;
+    base = aligned;
+  }
+#else
+  (void) page_mode;
+  allocation = std::malloc(bytes + kAlignment);
+  if (allocation == NULL) {
+    std::cerr << "Error: unable to reserve " << bytes
+              << " bytes for solver buffers" << std::endl;
+    return false;
+  }
+  base = reinterpret_cast<char*>(round_up(
+      reinterpret_cast<uintptr_t>(allocation), kAlignment));
+#endif
+
+  capacity_bytes = bytes;
+  next_block = 0;
+  return true;
+}
+
+void BufferArena::release() {
+  if (allocation != NULL) {
+#ifdef __linux__
+    munmap(allocation, mapped_bytes);
+#else
+    std::free(allocation);
+#endif
+  }
+  file.release();
+
+  base = NULL;
+  allocation = NULL;
+  capacity_bytes = 0;
+  mapped_bytes = 0;
+  next_block = 0;
+  mode = REGULAR_PAGES;
+}
+
+const char* BufferArena::page_mode_name(int page_mode) {
+  switch (page_mode) {
+    case TRANSPARENT_HUGE_PAGES:
+      return "transparent huge pages";
+    case EXPLICIT_HUGE_PAGES:
+      return "explicit huge pages";
+    default:
+      return "regular pages";
+  }
+}
@@ -0,0 +1,199 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BUFFERARENA_H_
+#define BUFFERARENA_H_
+
+#include "MappedRegion.h"
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+// A single memory region that hands out aligned buffers for the arrays of a
+// solver, instead of allocating each array separately.
+//
+// Each buffer is requested with the range of solver phases in which it is
+// live. The region is planned with a layout pass: after begin_layout(),
+// allocate() and map() only record the requests and return NULL.
+// plan_layout() then assigns offsets so that buffers whose phases do not
+// overlap share storage, reserve() allocates the region, and the same
+// sequence of requests places the buffers in it. A buffer may hold data of
+// buffers from earlier phases, and must be initialized in its first phase.
+// The pages of the region are not touched until the buffers are first written,
+// and the pages of the buffers of each finished phase are returned.
+//
+// On Linux, the region can be backed by transparent huge pages (advised with
+// madvise) or explicit huge pages (MAP_HUGETLB, from the pool configured in
+// /proc/sys/vm/nr_hugepages), to reduce page faults and TLB misses.
+//
+// For arrays that do not fit in memory, the region can instead be a shared
+// mapping of a temporary file, whose pages the kernel writes back and drops
+// under memory pressure. The solvers then advise the kernel of their access
+// order; the advice is ignored for memory-backed regions.
+class BufferArena {
+ public:
+  enum PageMode {
+    REGULAR_PAGES = 0,
+    TRANSPARENT_HUGE_PAGES = 1,
+    EXPLICIT_HUGE_PAGES = 2,
+    PAGE_MODE_COUNT = 3
+  };
+
+  // Alignment of each buffer, enough for any SIMD load
+  static const size_t kAlignment = 64;
+
+  BufferArena();
+  ~BufferArena();
+
+  // Start a layout pass, releasing the current region
+  void begin_layout();
+
+  // Assign offsets to the buffers recorded by the layout pass, in the order of
+  // their first phase and then the largest first, each at the lowest offset
+  // not used by a buffer live in a common phase, so that the buffers of early
+  // phases stay at the start of the region. Returns the size of the region
+  // needed.
+  size_t plan_layout();
+
+  // Size of the region needed without sharing storage between phases
+  size_t unshared_size() const;
+
+  // Total size of the buffers live in the phase
+  size_t live_bytes(int phase) const;
+
+  // Record memory held outside the region that is live from first_phase to
+  // last_phase, e.g. the mesh operator, so that it counts in peak_bytes()
+  void count_external(size_t bytes, int first_phase, int last_phase);
+
+  // Largest total size of the buffers and the external memory live in a
+  // common phase, which bounds the memory used by the solver
+  size_t peak_bytes() const;
+
+  // Allocate the region for the planned layout. Explicit huge pages fall back
+  // to transparent huge pages if the pool is too small.
+  bool reserve(size_t bytes, int page_mode);
+
+  // Allocate the region for the planned layout in a temporary file in the
+  // directory, with its storage allocated up front
+  bool reserve_file(size_t bytes, const std::string &directory);
+
+  void release();
+
+  // Uninitialized buffer for count objects of type T, live from first_phase
+  // to last_phase, or NULL during a layout pass
+  template<typename T>
+  T* allocate(size_t count, int first_phase, int last_phase) {
+    return static_cast<T*>(allocate_bytes(count * sizeof(T), first_phase,
+                                          last_phase));
+  }
+
+  // Re-seat an Eigen::Map on a new buffer of rows x cols coefficients, in
+  // place as recommended by the Eigen documentation
+  template<typename MapT>
+  void map(MapT &m, ptrdiff_t rows, ptrdiff_t cols, int first_phase,
+           int last_phase) {
+    new (&m) MapT(
+        allocate<typename MapT::Scalar>(rows * cols, first_phase, last_phase),
+        rows, cols);
+  }
+
+  // Re-seat an Eigen::Map of a vector
+  template<typename MapT>
+  void map(MapT &m, ptrdiff_t size, int first_phase, int last_phase) {
+    new (&m) MapT(
+        allocate<typename MapT::Scalar>(size, first_phase, last_phase), size);
+  }
+
+  // Return the pages of the buffers that become live in the phase to the
+  // system, except those shared with other buffers, so that they are placed
+  // again by the threads that first write them
+  void discard(int phase);
+
+  // Return the pages of the buffers that are no longer live after the phase
+  // to the system. For a file-backed region, their storage is freed so that
+  // their data is not written back.
+  void retire(int phase);
+
+  // For a file-backed region: start reading a range that will be used soon
+  void prefetch(const void *data, size_t bytes) const;
+
+  // For a file-backed region: the range is accessed in order, so the kernel
+  // can read further ahead and drop the pages behind
+  void stream(const void *data, size_t bytes) const;
+
+  template<typename MapT>
+  void stream(const MapT &m) const {
+    stream(m.data(), m.size() * sizeof(typename MapT::Scalar));
+  }
+
+  bool file_backed() const {
+    return file.data() != NULL;
+  }
+
+  size_t capacity() const {
+    return capacity_bytes;
+  }
+
+  // Page mode in effect after reserve(), which can differ from the
+  // requested one after a fallback
+  int page_mode() const {
+    return mode;
+  }
+
+  static const char* page_mode_name(int page_mode);
+
+ private:
+  struct Block {
+    size_t bytes;
+    size_t offset;
+    int first_phase, last_phase;
+  };
+
+  std::vector<Block> blocks;  // Buffers recorded by the layout pass
+  std::vector<Block> external_blocks;  // Memory counted by count_external()
+  int next_block;  // Next buffer to place after reserve()
+
+  char *base;
+  size_t capacity_bytes;
+  size_t mapped_bytes;  // Length of the OS mapping, 0 if the region is from malloc
+  void *allocation;  // Start of the mapping or the malloc block
+  int mode;
+  MappedRegion file;  // Backing file of a file-backed region
+
+  void* allocate_bytes(size_t bytes, int first_phase, int last_phase);
+  void advise(const void *data, size_t bytes, int advice) const;
+
+  BufferArena(const BufferArena&);
+  BufferArena& operator=(const BufferArena&);
+};
+
+#endif /* BUFFERARENA_H_ */
@@ -31,23 +31,9 @@
 
 #include "Parameters.h"
 #include "DistanceFile.h"
+#include "DistanceError.h"
 #include <iostream>
 
-void shift_and_normalize_distance(const std::vector<int> &source_vtx,
-                                  DenseVector &dist_values) {
-  double mean_source_dist = 0;
-  for (int i = 0; i < static_cast<int>(source_vtx.size()); ++i) {
-    mean_source_dist += dist_values(source_vtx[i]);
-  }
-  mean_source_dist /= double(source_vtx.size());
-
-  DenseVector source_dist;
-  source_dist.setConstant(dist_values.size(), mean_source_dist);
-  dist_values -= source_dist;
-
-  dist_values /= dist_values.maxCoeff();
-}
-
 int main(int argc, char* argv[]) {
   if (argc != 4) {
     std::cerr
@@ -89,26 +75,8 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  // Shift distance array such that the value at sources become zero
-  shift_and_normalize_distance(param.source_vertices, distance);
-  shift_and_normalize_distance(param.source_vertices, ref_distance);
-
-  // Compute mean error
-  double err = 0;
-  double eps = 1e-14;
-  std::vector<bool> source_flag(n_vtx, false);
-  for (int i = 0; i < static_cast<int>(param.source_vertices.size()); ++i) {
-    source_flag[param.source_vertices[i]] = true;
-  }
-
-  for (int i = 0; i < n_vtx; ++i) {
-    if ((!source_flag[i]) && (std::fabs(ref_distance(i)) > eps)) {
-      err += std::fabs(distance(i) - ref_distance(i))
-          / std::fabs(ref_distance(i));
-    }
-  }
-  err /= double(n_vtx - param.source_vertices.size());
-
+  double err = DistanceError::mean_relative_error(distance, ref_distance,
+                                                 param.source_vertices);
   std::cout << "Mean relative error: " << (err * 100) << "%" << std::endl;
 
   return 0;
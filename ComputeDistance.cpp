@@ -33,6 +33,8 @@
 #include "EdgeBasedGeodesicSolver.h"
 #include "DistanceFile.h"
 #include "GetRSS.h"
+#include "NumaPlacement.h"
+#include "OMPHelper.h"
 #include <iostream>
 
 int main(int argc, char* argv[]) {
@@ -49,6 +51,12 @@ int main(int argc, char* argv[]) {
   }
   param.output_options();
 
+#ifdef USE_TASK_SCHEDULER
+  TaskScheduler scheduler(0, param.thread_affinity);
+  TaskScheduler::Scope scheduler_scope(scheduler);
+#endif
+  NumaPlacement::pin_threads(param.thread_affinity);
+
   if (param.solver_type == 0) {
     FaceBasedGeodesicSolver FaceBasedSolver;
     if (!FaceBasedSolver.solve(argv[2], param)) {
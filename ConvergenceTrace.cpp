@@ -0,0 +1,160 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "ConvergenceTrace.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+static_assert(sizeof(ConvergenceTrace::Record) == 48,
+              "The binary trace format has 48-byte records");
+
+const char* const kPhaseNames[] = { "heat", "admm" };
+
+// Serializes the traces appended by concurrent solves in this process
+std::mutex append_mutex;
+
+bool ends_with(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size()
+      && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void write_csv_field(std::ostream &out, const std::string &field) {
+  out << '"';
+  for (size_t i = 0; i < field.size(); ++i) {
+    if (field[i] == '"') {
+      out << '"';
+    }
+    out << field[i];
+  }
+  out << '"';
+}
+
+}
+
+ConvergenceTrace::ConvergenceTrace()
+    : n_added(0),
+      start_time(std::chrono::steady_clock::now()) {
+}
+
+void ConvergenceTrace::start(size_t capacity) {
+  records.assign(capacity, Record());
+  n_added = 0;
+  start_time = std::chrono::steady_clock::now();
+}
+
+size_t ConvergenceTrace::size() const {
+  return (n_added < records.size()) ? size_t(n_added) : records.size();
+}
+
+unsigned long long ConvergenceTrace::n_overwritten() const {
+  return n_added - size();
+}
+
+const ConvergenceTrace::Record& ConvergenceTrace::record(size_t i) const {
+  return records[(n_overwritten() + i) % records.size()];
+}
+
+bool ConvergenceTrace::append(const std::string &file_name,
+                              const std::string &mesh) const {
+  std::lock_guard<std::mutex> lock(append_mutex);
+  bool success =
+      ends_with(file_name, ".csv") ?
+          append_csv(file_name, mesh) : append_binary(file_name, mesh);
+  if (!success) {
+    std::cerr << "Error: unable to write convergence trace file " << file_name
+              << std::endl;
+  }
+
+  return success;
+}
+
+bool ConvergenceTrace::append_csv(const std::string &file_name,
+                                  const std::string &mesh) const {
+  bool new_file = !std::ifstream(file_name.c_str()).good();
+  std::ofstream ofile(file_name.c_str(), std::ios::app);
+  if (!ofile.is_open()) {
+    return false;
+  }
+
+  ofile.precision(std::numeric_limits<double>::digits10 + 2);
+  if (new_file) {
+    ofile << "mesh,phase,iteration,seconds,heat_residual,"
+          << "primal_residual_sqr_norm,dual_residual_sqr_norm,penalty\n";
+  }
+
+  for (size_t i = 0; i < size(); ++i) {
+    const Record &r = record(i);
+    write_csv_field(ofile, mesh);
+    ofile << "," << kPhaseNames[r.phase] << "," << r.iteration << ","
+          << r.seconds << "," << r.heat_residual << ","
+          << r.primal_residual_sqr_norm << "," << r.dual_residual_sqr_norm
+          << "," << r.penalty << "\n";
+  }
+
+  ofile.flush();
+  return bool(ofile);
+}
+
+bool ConvergenceTrace::append_binary(const std::string &file_name,
+                                     const std::string &mesh) const {
+  std::ofstream ofile(file_name.c_str(), std::ios::app | std::ios::binary);
+  if (!ofile.is_open()) {
+    return false;
+  }
+
+  const char magic[8] = "PHTRACE";
+  std::uint32_t version = 1;
+  std::uint32_t mesh_length = mesh.size();
+  std::uint64_t n_records = size();
+  std::uint64_t n_lost = n_overwritten();
+  ofile.write(magic, sizeof(magic));
+  ofile.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  ofile.write(reinterpret_cast<const char*>(&mesh_length),
+              sizeof(mesh_length));
+  ofile.write(reinterpret_cast<const char*>(&n_records), sizeof(n_records));
+  ofile.write(reinterpret_cast<const char*>(&n_lost), sizeof(n_lost));
+  ofile.write(mesh.data(), mesh.size());
+
+  // The kept records are in at most two contiguous parts of the buffer
+  size_t first = (records.empty()) ? 0 : n_overwritten() % records.size();
+  size_t n_first = std::min(size(), records.size() - first);
+  ofile.write(reinterpret_cast<const char*>(records.data() + first),
+              n_first * sizeof(Record));
+  ofile.write(reinterpret_cast<const char*>(records.data()),
+              (size() - n_first) * sizeof(Record));
+
+  ofile.flush();
+  return bool(ofile);
+}
@@ -0,0 +1,120 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CONVERGENCETRACE_H_
+#define CONVERGENCETRACE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Residuals of the heat solver and of ADMM at each convergence check of a
+// solve, recorded into a buffer allocated before the solve. When the buffer
+// is full, the oldest records are overwritten.
+//
+// The records are appended to a file at the end of the solve, as CSV if the
+// file name ends with ".csv", with the columns
+//   mesh,phase,iteration,seconds,heat_residual,primal_residual_sqr_norm,
+//   dual_residual_sqr_norm,penalty
+// and a header line if the file is new. Otherwise they are appended in
+// binary, in the byte order of the machine, as a block per solve:
+//   char magic[8] = "PHTRACE", uint32 version = 1, uint32 mesh name length,
+//   uint64 number of records, uint64 number of overwritten records,
+//   the mesh name, and the records as in Record (48 bytes each).
+// Residuals that are not computed in the phase are -1.
+class ConvergenceTrace {
+ public:
+  enum Phase {
+    HEAT = 0,
+    ADMM = 1
+  };
+
+  struct Record {
+    std::int32_t phase;
+    std::int32_t iteration;
+    double seconds;  // Since start()
+    double heat_residual;
+    double primal_residual_sqr_norm;
+    double dual_residual_sqr_norm;
+    double penalty;
+  };
+
+  ConvergenceTrace();
+
+  // Clear the records and allocate room for capacity of them, 0 to disable
+  // recording; the times of the records start from here
+  void start(size_t capacity);
+
+  bool enabled() const {
+    return !records.empty();
+  }
+
+  void add(int phase, int iteration, double heat_residual,
+           double primal_residual_sqr_norm, double dual_residual_sqr_norm,
+           double penalty) {
+    if (records.empty()) {
+      return;
+    }
+
+    Record &record = records[n_added % records.size()];
+    record.phase = phase;
+    record.iteration = iteration;
+    record.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time).count();
+    record.heat_residual = heat_residual;
+    record.primal_residual_sqr_norm = primal_residual_sqr_norm;
+    record.dual_residual_sqr_norm = dual_residual_sqr_norm;
+    record.penalty = penalty;
+    n_added++;
+  }
+
+  // Number of records kept, and of records overwritten
+  size_t size() const;
+  unsigned long long n_overwritten() const;
+
+  // Record i of the kept records, from the oldest
+  const Record& record(size_t i) const;
+
+  // Append the records to the file, in the format given by its name
+  bool append(const std::string &file_name, const std::string &mesh) const;
+
+ private:
+  std::vector<Record> records;
+  unsigned long long n_added;
+  std::chrono::steady_clock::time_point start_time;
+
+  bool append_csv(const std::string &file_name, const std::string &mesh) const;
+  bool append_binary(const std::string &file_name,
+                     const std::string &mesh) const;
+};
+
+#endif /* CONVERGENCETRACE_H_ */
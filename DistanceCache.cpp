@@ -0,0 +1,158 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "DistanceCache.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+DistanceCache::DistanceCache(std::size_t max_bytes)
+    : max_bytes_(max_bytes),
+      bytes_held_(0),
+      n_hits_(0),
+      n_misses_(0),
+      n_evictions_(0) {
+}
+
+std::string DistanceCache::make_key(const std::string &mesh_id,
+                                    const std::vector<MeshIndex> &source_vertices,
+                                    const Parameters &param) {
+  std::vector<MeshIndex> sources = source_vertices;
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+  std::ostringstream ostr;
+  ostr.precision(17);
+  ostr << mesh_id << '\n' << param.solver_type << ' '
+       << param.heat_solver_max_iter << ' ' << param.heat_solver_eps << ' '
+       << param.heat_solver_convergence_check_frequency << ' '
+       << param.grad_solver_max_iter << ' ' << param.grad_solver_eps << ' '
+       << param.penalty << ' ' << param.grad_solver_convergence_check_frequency
+       << '\n';
+  for (int i = 0; i < static_cast<int>(sources.size()); ++i) {
+    ostr << sources[i] << ' ';
+  }
+
+  return ostr.str();
+}
+
+SharedDistance DistanceCache::find(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<std::string, EntryList::iterator>::iterator iter = index_
+      .find(key);
+  if (iter == index_.end()) {
+    n_misses_++;
+    return SharedDistance();
+  }
+
+  // Move the entry to the front of the LRU list
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  n_hits_++;
+  return iter->second->dist;
+}
+
+void DistanceCache::insert(const std::string &key, const SharedDistance &dist) {
+  if (!dist) {
+    return;
+  }
+
+  std::size_t bytes = dist->size() * sizeof(double) + key.size()
+      + sizeof(Entry);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<std::string, EntryList::iterator>::iterator iter = index_
+      .find(key);
+  if (iter != index_.end()) {
+    bytes_held_ -= iter->second->bytes;
+    entries_.erase(iter->second);
+    index_.erase(iter);
+  }
+
+  if (bytes > max_bytes_) {
+    return;
+  }
+
+  evict_until_fits(bytes);
+
+  Entry entry;
+  entry.key = key;
+  entry.dist = dist;
+  entry.bytes = bytes;
+  entries_.push_front(entry);
+  index_[key] = entries_.begin();
+  bytes_held_ += bytes;
+}
+
+void DistanceCache::evict_until_fits(std::size_t bytes) {
+  while (!entries_.empty() && bytes_held_ + bytes > max_bytes_) {
+    const Entry &lru_entry = entries_.back();
+    bytes_held_ -= lru_entry.bytes;
+    index_.erase(lru_entry.key);
+    entries_.pop_back();
+    n_evictions_++;
+  }
+}
+
+void DistanceCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  bytes_held_ = 0;
+}
+
+std::size_t DistanceCache::bytes_held() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_held_;
+}
+
+int DistanceCache::n_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+double DistanceCache::hit_ratio() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  long long n_lookups = n_hits_ + n_misses_;
+  return n_lookups > 0 ? double(n_hits_) / double(n_lookups) : 0.0;
+}
+
+void DistanceCache::print_statistics() const {
+  double ratio = hit_ratio();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::cout << std::endl;
+  std::cout << "====== Distance cache ======" << std::endl;
+  std::cout << "Hits: " << n_hits_ << ", misses: " << n_misses_
+            << ", hit ratio: " << (ratio * 100) << "%" << std::endl;
+  std::cout << "Entries: " << entries_.size() << ", evictions: "
+            << n_evictions_ << std::endl;
+  std::cout << "Bytes held: " << bytes_held_ << " of " << max_bytes_
+            << std::endl;
+}
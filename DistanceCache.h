@@ -0,0 +1,101 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef DISTANCECACHE_H_
+#define DISTANCECACHE_H_
+
+#include "EigenTypes.h"
+#include "Parameters.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Distance values shared between the cache and its users without copying
+typedef std::shared_ptr<const DenseVector> SharedDistance;
+
+// In-process cache of distance fields, keyed by mesh id, source set and
+// solver parameters, with least-recently-used eviction under a memory budget.
+// All methods are thread-safe.
+class DistanceCache {
+ public:
+  explicit DistanceCache(std::size_t max_bytes);
+
+  // Build the key of a query. Source vertices are sorted and deduplicated,
+  // and only the parameters that affect the result are included.
+  static std::string make_key(const std::string &mesh_id,
+                              const std::vector<MeshIndex> &source_vertices,
+                              const Parameters &param);
+
+  // Return the cached distance values for the key, or a null pointer on a miss
+  SharedDistance find(const std::string &key);
+
+  // Store distance values, evicting least recently used entries if needed.
+  // Values larger than the whole budget are not stored.
+  void insert(const std::string &key, const SharedDistance &dist);
+
+  void clear();
+
+  std::size_t bytes_held() const;
+  std::size_t max_bytes() const {
+    return max_bytes_;
+  }
+
+  int n_entries() const;
+  double hit_ratio() const;
+
+  void print_statistics() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    SharedDistance dist;
+    std::size_t bytes;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  std::size_t max_bytes_;
+  std::size_t bytes_held_;
+  long long n_hits_, n_misses_, n_evictions_;
+
+  EntryList entries_;  // Most recently used first
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  mutable std::mutex mutex_;
+
+  void evict_until_fits(std::size_t bytes);
+};
+
+#endif /* DISTANCECACHE_H_ */
@@ -0,0 +1,91 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef DISTANCEERROR_H_
+#define DISTANCEERROR_H_
+
+#include "EigenTypes.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class DistanceError {
+
+ public:
+
+  // Mean relative error of the distance values against the reference values,
+  // over the vertices other than the sources, as reported by CompareDistance.
+  // Both are first shifted such that their mean at the sources is zero, and
+  // scaled such that their maximum is one, so that distances of meshes with
+  // different scaling are comparable.
+  static double mean_relative_error(const DenseVector &dist_values,
+                                    const DenseVector &ref_values,
+                                    const std::vector<MeshIndex> &source_vtx) {
+    DenseVector distance = dist_values, ref_distance = ref_values;
+    shift_and_normalize(source_vtx, distance);
+    shift_and_normalize(source_vtx, ref_distance);
+
+    double err = 0;
+    double eps = 1e-14;
+    MeshIndex n_vtx = distance.size();
+    std::vector<bool> source_flag(n_vtx, false);
+    for (int i = 0; i < static_cast<int>(source_vtx.size()); ++i) {
+      source_flag[source_vtx[i]] = true;
+    }
+
+    for (MeshIndex i = 0; i < n_vtx; ++i) {
+      if ((!source_flag[i]) && (std::fabs(ref_distance(i)) > eps)) {
+        err += std::fabs(distance(i) - ref_distance(i))
+            / std::fabs(ref_distance(i));
+      }
+    }
+
+    return err / double(n_vtx - source_vtx.size());
+  }
+
+ private:
+
+  static void shift_and_normalize(const std::vector<MeshIndex> &source_vtx,
+                                  DenseVector &dist_values) {
+    double mean_source_dist = 0;
+    for (int i = 0; i < static_cast<int>(source_vtx.size()); ++i) {
+      mean_source_dist += dist_values(source_vtx[i]);
+    }
+    mean_source_dist /= double(source_vtx.size());
+
+    dist_values.array() -= mean_source_dist;
+    dist_values /= *std::max_element(dist_values.data(),
+                                     dist_values.data() + dist_values.size());
+  }
+};
+
+#endif /* DISTANCEERROR_H_ */
@@ -35,38 +35,51 @@
 #include "EigenTypes.h"
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 class DistanceFile {
 
  public:
 
   static bool save(const char *file_name, const DenseVector &dist_values) {
+    std::string buffer;
+    return encode(dist_values, buffer) && write_encoded(file_name, buffer);
+  }
+
+  // Format the distance values into a text buffer in the file layout used by save()
+  static bool encode(const DenseVector &dist_values, std::string &buffer) {
     int n_values = dist_values.size();
     if (n_values <= 0) {
       std::cerr << "Error: empty distance value vector" << std::endl;
       return false;
     }
 
+    std::ostringstream ostr;
+    ostr << n_values << '\n';
+    for (int i = 0; i < n_values; ++i) {
+      ostr << dist_values(i) << '\n';
+    }
+
+    buffer = ostr.str();
+    return true;
+  }
+
+  // Write a buffer produced by encode() to file
+  static bool write_encoded(const char *file_name, const std::string &buffer) {
     std::ofstream ofile(file_name);
     if (!ofile.is_open()) {
       std::cerr << "Unable to open file " << file_name << std::endl;
       return false;
     }
 
-    ofile << n_values << std::endl;
+    ofile.write(buffer.data(), buffer.size());
+    ofile.close();
     if (!ofile) {
       std::cerr << "Error writing to file " << file_name << std::endl;
       return false;
     }
 
-    for (int i = 0; i < n_values; ++i) {
-      ofile << dist_values(i) << std::endl;
-      if (!ofile) {
-        std::cerr << "Error writing to file " << file_name << std::endl;
-        return false;
-      }
-    }
-
     return true;
   }
 
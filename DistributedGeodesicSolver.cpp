@@ -0,0 +1,673 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "DistributedGeodesicSolver.h"
+#include "OMPHelper.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Local index of a global index: owned entries first, then the sorted ghosts
+int local_index(int global_id, int owned_begin, int n_owned,
+                const std::vector<int> &ghosts) {
+  if (global_id >= owned_begin && global_id < owned_begin + n_owned) {
+    return global_id - owned_begin;
+  }
+
+  return n_owned
+      + (std::lower_bound(ghosts.begin(), ghosts.end(), global_id)
+          - ghosts.begin());
+}
+
+void add_ghost(int global_id, int owned_begin, int n_owned,
+               std::vector<int> &ghosts) {
+  if (global_id >= 0
+      && (global_id < owned_begin || global_id >= owned_begin + n_owned)) {
+    ghosts.push_back(global_id);
+  }
+}
+
+void sort_unique(std::vector<int> &ids) {
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+}
+
+DistributedGeodesicSolver::DistributedGeodesicSolver()
+    : comm(MPI_COMM_NULL),
+      rank(0),
+      part(NULL),
+      n_owned_vertices(0),
+      n_owned_faces(0),
+      n_local_edges(0),
+      n_owned_edges(0),
+      vertex_begin(0),
+      prev_SG(NULL),
+      current_SG(NULL),
+      gs_iter(0),
+      iter_num(0),
+      primal_residual_sqr_norm_threshold(0),
+      dual_residual_sqr_norm_threshold(0),
+      setup_time(0),
+      heat_time(0),
+      admm_time(0),
+      integration_time(0) {
+}
+
+const DenseVector& DistributedGeodesicSolver::get_distance_values() {
+  return geod_dist_values;
+}
+
+bool DistributedGeodesicSolver::solve(MPI_Comm communicator,
+                                      const MeshPartition &partition,
+                                      const Parameters &para) {
+  comm = communicator;
+  MPI_Comm_rank(comm, &rank);
+  part = &partition;
+  param = para;
+  param.print_progress = para.print_progress && rank == 0;
+
+  double t0 = MPI_Wtime();
+  int status = setup() ? 1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, comm);
+  if (!status) {
+    return false;
+  }
+
+  double t1 = MPI_Wtime();
+  if (param.print_progress) {
+    std::cout << "Gauss-Seidel initilization of gradients......" << std::endl;
+  }
+  gauss_seidel_init_gradients();
+
+  double t2 = MPI_Wtime();
+  if (param.print_progress) {
+    std::cout << "ADMM solver for integrable gradients......" << std::endl;
+  }
+  prepare_integrable_gradients();
+  compute_integrable_gradients();
+
+  double t3 = MPI_Wtime();
+  if (param.print_progress) {
+    std::cout << "Recovery of geodesic distance......" << std::endl;
+  }
+  integrate_geodesic_distance();
+
+  double t4 = MPI_Wtime();
+  setup_time = t1 - t0;
+  heat_time = t2 - t1;
+  admm_time = t3 - t2;
+  integration_time = t4 - t3;
+
+  return true;
+}
+
+bool DistributedGeodesicSolver::setup() {
+  n_owned_vertices = part->n_owned_vertices();
+  n_owned_faces = part->n_owned_faces();
+  n_local_edges = part->n_local_edges();
+  n_owned_edges = part->n_owned_edges;
+  vertex_begin = part->vertex_offsets[rank];
+  int face_begin = part->face_offsets[rank];
+
+  // Ghost vertices are read by the Laplacian rows and the gradients of
+  // owned faces; ghost faces are neighbors across local edges and faces of
+  // transition edges
+  std::vector<int> ghost_vertices, ghost_faces;
+  for (int i = 0; i < static_cast<int>(part->laplacian_vertices.size()); ++i) {
+    add_ghost(part->laplacian_vertices[i], vertex_begin, n_owned_vertices,
+              ghost_vertices);
+  }
+  for (int i = 0; i < static_cast<int>(part->face_vertices.size()); ++i) {
+    add_ghost(part->face_vertices[i], vertex_begin, n_owned_vertices,
+              ghost_vertices);
+  }
+  for (int i = 0; i < static_cast<int>(part->edge_faces.size()); ++i) {
+    add_ghost(part->edge_faces[i], face_begin, n_owned_faces, ghost_faces);
+  }
+  for (int i = 0; i < static_cast<int>(part->transition_edge_faces.size());
+      ++i) {
+    add_ghost(part->transition_edge_faces[i], face_begin, n_owned_faces,
+              ghost_faces);
+  }
+  sort_unique(ghost_vertices);
+  sort_unique(ghost_faces);
+
+  if (!vertex_halo.setup(comm, part->vertex_offsets, ghost_vertices)
+      || !face_halo.setup(comm, part->face_offsets, ghost_faces)) {
+    return false;
+  }
+
+  // Convert global indices to local ones
+  int n_coefs = part->laplacian_vertices.size();
+  laplacian_coef.resize(n_coefs);
+  for (int i = 0; i < n_coefs; ++i) {
+    laplacian_coef[i] = std::pair<int, double>(
+        local_index(part->laplacian_vertices[i], vertex_begin,
+                    n_owned_vertices, ghost_vertices),
+        part->laplacian_weights[i]);
+  }
+
+  face_local_vertices.resize(3, n_owned_faces);
+  for (int i = 0; i < n_owned_faces; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      face_local_vertices(k, i) = local_index(part->face_vertices[3 * i + k],
+                                              vertex_begin, n_owned_vertices,
+                                              ghost_vertices);
+    }
+  }
+
+  S.resize(2, n_local_edges);
+  for (int i = 0; i < n_local_edges; ++i) {
+    for (int k = 0; k < 2; ++k) {
+      S(k, i) = local_index(part->edge_faces[2 * i + k], face_begin,
+                            n_owned_faces, ghost_faces);
+    }
+  }
+  e = Eigen::Map<const Matrix3X>(part->edge_unit_vectors.data(), 3,
+                                 n_local_edges);
+
+  transition_local_faces.resize(2, n_owned_vertices);
+  for (int i = 0; i < n_owned_vertices; ++i) {
+    for (int k = 0; k < 2; ++k) {
+      int f = part->transition_edge_faces[2 * i + k];
+      transition_local_faces(k, i) =
+          (f >= 0) ?
+              local_index(f, face_begin, n_owned_faces, ghost_faces) : -1;
+    }
+  }
+
+  return true;
+}
+
+DistributedGeodesicSolver::HeatScalar DistributedGeodesicSolver::global_norm(
+    const VectorHS &values) {
+  HeatScalar sqr_norm = values.squaredNorm();
+  MPI_Allreduce(MPI_IN_PLACE, &sqr_norm, 1, MPI_LONG_DOUBLE, MPI_SUM, comm);
+  return std::sqrt(sqr_norm);
+}
+
+void DistributedGeodesicSolver::compute_heatflow_residual(VectorHS &residuals) {
+  HeatScalar init_source_val = part->init_source_val;
+  int n_sources = part->layer_addr[1];
+
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_owned_vertices) {
+      int lap_coef_begin_addr = part->laplacian_addr[i];
+      int lap_coef_end_addr = part->laplacian_addr[i + 1];
+
+      HeatScalar res = 0;
+      if (i < n_sources) {
+        res += init_source_val;
+      }
+
+      for (int j = lap_coef_begin_addr; j < lap_coef_end_addr; ++j) {
+        const std::pair<int, double> &coef = laplacian_coef[j];
+        res += heat_values(coef.first) * coef.second
+            * ((j == (lap_coef_end_addr - 1)) ? (-1) : 1);
+      }
+
+      residuals(i) = res;
+    } PARALLEL_FOR_END
+  }
+}
+
+void DistributedGeodesicSolver::gauss_seidel_init_gradients() {
+  HeatScalar init_source_val = part->init_source_val;
+  const std::vector<int> &layer_addr = part->layer_addr;
+  int n_layers = part->n_layers;
+
+  heat_values.setZero(n_owned_vertices + vertex_halo.n_ghosts());
+  for (int i = 0; i < layer_addr[1]; ++i) {
+    heat_values(i) = init_source_val;
+  }
+  vertex_halo.exchange(heat_values.data(), 1);
+
+  VectorHS heatflow_residuals(n_owned_vertices);
+  compute_heatflow_residual(heatflow_residuals);
+  HeatScalar init_residual_norm = global_norm(heatflow_residuals);
+  HeatScalar eps = std::max(
+      HeatScalar(1e-16),
+      init_residual_norm * HeatScalar(param.heat_solver_eps));
+  if (param.print_progress) {
+    std::cout << "Initial residual: " << init_residual_norm << ", threshold: "
+              << eps << std::endl;
+  }
+
+  int buffer_size = 0;
+  for (int l = 0; l < n_layers; ++l) {
+    buffer_size = std::max(buffer_size, layer_addr[l + 1] - layer_addr[l]);
+  }
+  VectorHS temp_d(buffer_size);
+
+  // Gauss-Seidel sweeps over the owned vertices in BFS order, with the ghost
+  // values updated after each sweep
+  gs_iter = 0;
+  bool end_gs_loop = false;
+  while (!end_gs_loop) {
+    for (int l = 0; l < n_layers; ++l) {
+      int segment_begin_addr = layer_addr[l];
+      int segment_end_addr = layer_addr[l + 1];
+      if (segment_begin_addr == segment_end_addr) {
+        continue;
+      }
+
+      OMP_PARALLEL
+      {
+        PARALLEL_FOR(int, i, segment_begin_addr, segment_end_addr) {
+          int lap_coef_begin_addr = part->laplacian_addr[i];
+          int lap_coef_end_addr = part->laplacian_addr[i + 1];
+
+          HeatScalar new_heat_value = 0;
+          if (l == 0) {  // Sources
+            new_heat_value += init_source_val;
+          }
+
+          for (int j = lap_coef_begin_addr; j < lap_coef_end_addr - 1; ++j) {
+            const std::pair<int, double> &coef = laplacian_coef[j];
+            new_heat_value += heat_values(coef.first) * coef.second;
+          }
+
+          temp_d(i - segment_begin_addr) = new_heat_value
+              / laplacian_coef[lap_coef_end_addr - 1].second;
+        } PARALLEL_FOR_END
+
+        PARALLEL_FOR(int, i, segment_begin_addr, segment_end_addr) {
+          heat_values(i) = temp_d(i - segment_begin_addr);
+        } PARALLEL_FOR_END
+      }
+    }
+
+    gs_iter++;
+    vertex_halo.exchange(heat_values.data(), 1);
+
+    end_gs_loop = gs_iter >= param.heat_solver_max_iter;
+    if (end_gs_loop
+        || gs_iter % param.heat_solver_convergence_check_frequency == 0) {
+      compute_heatflow_residual(heatflow_residuals);
+      HeatScalar residual_norm = global_norm(heatflow_residuals);
+      if (param.print_progress) {
+        std::cout << "Gauss-Seidel iteration " << gs_iter
+                  << ", current residual: " << residual_norm
+                  << ", threshold: " << eps << std::endl;
+      }
+
+      if (residual_norm <= eps) {
+        end_gs_loop = true;
+      }
+    }
+  }
+
+  // Compute initial gradients of owned faces
+  init_grad.resize(3, n_owned_faces);
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_owned_faces) {
+      Matrix3HS edge_vecs;
+      Vector3HS heat_vals;
+
+      for (int k = 0; k < 3; ++k) {
+        const double *current_edge = &(part->face_halfedge_vectors[9 * i + 3 * k]);
+        edge_vecs(0, k) = HeatScalar(current_edge[0]);
+        edge_vecs(1, k) = HeatScalar(current_edge[1]);
+        edge_vecs(2, k) = HeatScalar(current_edge[2]);
+        heat_vals(k) = heat_values(face_local_vertices(k, i));
+      }
+
+      heat_vals.normalize();
+      edge_vecs.normalize();
+
+      Vector3HS N = edge_vecs.col(0).cross(edge_vecs.col(1)).normalized();
+      Vector3HS V = edge_vecs.col(0) * heat_vals(1)
+          + edge_vecs.col(1) * heat_vals(2) + edge_vecs.col(2) * heat_vals(0);
+      Vector3HS grad_vec = V.cross(N).normalized();
+      init_grad(0, i) = grad_vec(0);
+      init_grad(1, i) = grad_vec(1);
+      init_grad(2, i) = grad_vec(2);
+    } PARALLEL_FOR_END
+  }
+
+  heat_values.resize(0);
+}
+
+void DistributedGeodesicSolver::prepare_integrable_gradients() {
+  G.resize(3, n_owned_faces + face_halo.n_ghosts());
+  G.leftCols(n_owned_faces) = init_grad;
+  face_halo.exchange(G.data(), 3);
+
+  faces_Y_index.setConstant(3, n_owned_faces, -1);
+  IndexVector num_rows;
+  num_rows.setZero(n_owned_faces);
+  for (int i = 0; i < n_local_edges; ++i) {
+    for (int k = 0; k < 2; ++k) {
+      int f = S(k, i);
+      if (f < n_owned_faces) {
+        faces_Y_index(num_rows(f)++, f) = 2 * i + k;
+      }
+    }
+  }
+
+  D.setZero(3, 2 * n_local_edges);
+  Y.setZero(3, 2 * n_local_edges);
+  SG1.setZero(3, 2 * n_local_edges);
+  SG2.setZero(3, 2 * n_local_edges);
+  current_SG = &SG1;
+  prev_SG = &SG2;
+  Y_area = Eigen::Map<const DenseVector>(part->edge_face_areas.data(),
+                                         2 * n_local_edges);
+
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_local_edges) {
+      current_SG->col(2 * i) = G.col(S(0, i));
+      current_SG->col(2 * i + 1) = G.col(S(1, i));
+    } PARALLEL_FOR_END
+  }
+
+  // Normalize the areas by their global mean, and sum them over owned edges
+  // for the convergence thresholds
+  int n_owned_cols = 2 * n_owned_edges;
+  double area_sum = Y_area.head(n_owned_cols).sum();
+  MPI_Allreduce(MPI_IN_PLACE, &area_sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+  Y_area /= area_sum / double(2 * part->n_interior_edges);
+  Y_area_squared = Y_area.array().square().matrix();
+
+  double sums[2] = { Y_area.head(n_owned_cols).sum(), Y_area_squared.head(
+      n_owned_cols).sum() };
+  MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, comm);
+  primal_residual_sqr_norm_threshold = sums[0] * param.grad_solver_eps
+      * param.grad_solver_eps;
+  dual_residual_sqr_norm_threshold = sums[1] * param.grad_solver_eps
+      * param.grad_solver_eps;
+
+  (*prev_SG) = (*current_SG);
+}
+
+void DistributedGeodesicSolver::update_Y() {
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_local_edges) {
+      Matrix32 y = prev_SG->block(0, 2 * i, 3, 2) - D.block(0, 2 * i, 3, 2);
+      Eigen::Vector3d d = e.col(i) * (e.col(i).dot(y.col(1) - y.col(0)));
+      double a = Y_area(2 * i) / (Y_area(2 * i) + Y_area(2 * i + 1));
+      y.col(0) += (1.0 - a) * d;
+      y.col(1) -= a * d;
+      Y.block(0, 2 * i, 3, 2) = y;
+    } PARALLEL_FOR_END
+  }
+}
+
+void DistributedGeodesicSolver::update_G() {
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_owned_faces) {
+      int n_aux_var = 0;
+      Eigen::Vector3d R = Eigen::Vector3d::Zero();
+      for (int j = 0; j < 3; j++) {
+        int index = faces_Y_index(j, i);
+        if (index >= 0) {
+          R += (Y.col(index) + D.col(index));
+          n_aux_var++;
+        }
+      }
+
+      double w = 2.0 / param.penalty;
+      R += w * init_grad.col(i);
+      R /= (w + n_aux_var);
+      G.col(i) = R;
+    } PARALLEL_FOR_END
+  }
+
+  face_halo.exchange(G.data(), 3);
+}
+
+bool DistributedGeodesicSolver::update_dual_variables() {
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_local_edges) {
+      current_SG->col(2 * i) = G.col(S(0, i));
+      current_SG->col(2 * i + 1) = G.col(S(1, i));
+    } PARALLEL_FOR_END
+  }
+
+  bool need_compute_residual_norms = ((iter_num + 1)
+      % param.grad_solver_convergence_check_frequency == 0);
+
+  // Residuals of owned edges, summed over all ranks
+  double residual_sqr_norms[2] = { 0, 0 };
+  if (need_compute_residual_norms) {
+    int n_owned_cols = 2 * n_owned_edges;
+    residual_sqr_norms[0] = (Y - (*current_SG)).leftCols(n_owned_cols)
+        .colwise().squaredNorm().dot(Y_area.head(n_owned_cols));
+    residual_sqr_norms[1] = ((*current_SG) - (*prev_SG)).leftCols(n_owned_cols)
+        .colwise().squaredNorm().dot(Y_area_squared.head(n_owned_cols));
+    MPI_Allreduce(MPI_IN_PLACE, residual_sqr_norms, 2, MPI_DOUBLE, MPI_SUM,
+                  comm);
+  }
+
+  D += Y - (*current_SG);
+
+  iter_num++;
+  bool optimization_converge = need_compute_residual_norms
+      && (residual_sqr_norms[0] <= primal_residual_sqr_norm_threshold
+          && residual_sqr_norms[1] <= dual_residual_sqr_norm_threshold);
+  bool optimization_end = optimization_converge
+      || iter_num >= param.grad_solver_max_iter;
+  bool output_progress = need_compute_residual_norms
+      && (iter_num % param.grad_solver_output_frequency == 0);
+
+  if (param.print_progress && optimization_converge) {
+    std::cout << "Solver converged." << std::endl;
+  } else if (param.print_progress && optimization_end) {
+    std::cout << "Maximum number of iterations reached." << std::endl;
+  }
+
+  if (param.print_progress && (output_progress || optimization_end)) {
+    std::cout << "Iteration " << iter_num << ":" << std::endl;
+    std::cout << "Primal residual squared norm: " << residual_sqr_norms[0]
+              << ",  threshold:" << primal_residual_sqr_norm_threshold
+              << std::endl;
+    std::cout << "Dual residual squared norm: " << residual_sqr_norms[1]
+              << ",  threshold:" << dual_residual_sqr_norm_threshold
+              << std::endl;
+  }
+
+  std::swap(current_SG, prev_SG);
+  return optimization_end;
+}
+
+void DistributedGeodesicSolver::compute_integrable_gradients() {
+  iter_num = 0;
+  bool optimization_end = false;
+  while (!optimization_end) {
+    update_Y();
+    update_G();
+    optimization_end = update_dual_variables();
+  }
+}
+
+void DistributedGeodesicSolver::integrate_geodesic_distance() {
+  const std::vector<int> &from_vertex = part->transition_from_vertex;
+  Eigen::Map<const Matrix3X> transition_edge_vector(
+      part->transition_edge_vector.data(), 3, n_owned_vertices);
+
+  // Distance increment along the transition edge of each owned vertex
+  DenseVector increments(n_owned_vertices);
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(int, i, 0, n_owned_vertices) {
+      Eigen::Vector3d grad = Eigen::Vector3d::Zero();
+      int n_neighbor_faces = 0;
+      for (int k = 0; k < 2; ++k) {
+        if (transition_local_faces(k, i) >= 0) {
+          grad += G.col(transition_local_faces(k, i));
+          n_neighbor_faces++;
+        }
+      }
+
+      if (n_neighbor_faces > 0) {
+        grad /= double(n_neighbor_faces);
+      }
+      increments(i) = transition_edge_vector.col(i).dot(grad);
+    } PARALLEL_FOR_END
+  }
+
+  // The distance of each vertex is offset(i) plus the distance of link(i),
+  // where link(i) is -1 for no vertex. Accumulate along the BFS tree within
+  // this rank first; owned vertices are in BFS order, so parents come first.
+  DenseVector offset(n_owned_vertices);
+  std::vector<int> link(n_owned_vertices, -1);
+  for (int i = 0; i < n_owned_vertices; ++i) {
+    int p = from_vertex[i];
+    if (p < 0) {
+      offset(i) = 0;
+    } else if (p >= vertex_begin && p < vertex_begin + n_owned_vertices) {
+      offset(i) = offset(p - vertex_begin) + increments(i);
+      link[i] = link[p - vertex_begin];
+    } else {
+      offset(i) = increments(i);
+      link[i] = p;
+    }
+  }
+
+  // Pointer jumping over the links to other ranks: in each round, every
+  // vertex adds the offset of its link and takes over the link's link
+  int n_ranks = part->n_ranks;
+  const std::vector<int> &vertex_offsets = part->vertex_offsets;
+  while (true) {
+    std::vector<int> queries;
+    for (int i = 0; i < n_owned_vertices; ++i) {
+      if (link[i] >= 0) {
+        queries.push_back(link[i]);
+      }
+    }
+    sort_unique(queries);
+
+    int n_unresolved = queries.size();
+    MPI_Allreduce(MPI_IN_PLACE, &n_unresolved, 1, MPI_INT, MPI_SUM, comm);
+    if (n_unresolved == 0) {
+      break;
+    }
+
+    std::vector<int> query_counts(n_ranks, 0), request_counts(n_ranks, 0);
+    for (int i = 0; i < static_cast<int>(queries.size()); ++i) {
+      int owner = std::upper_bound(vertex_offsets.begin(), vertex_offsets.end(),
+                                   queries[i]) - vertex_offsets.begin() - 1;
+      query_counts[owner]++;
+    }
+    MPI_Alltoall(query_counts.data(), 1, MPI_INT, request_counts.data(), 1,
+                 MPI_INT, comm);
+
+    std::vector<int> query_displs(n_ranks + 1, 0), request_displs(n_ranks + 1,
+                                                                   0);
+    for (int r = 0; r < n_ranks; ++r) {
+      query_displs[r + 1] = query_displs[r] + query_counts[r];
+      request_displs[r + 1] = request_displs[r] + request_counts[r];
+    }
+
+    std::vector<int> requests(request_displs[n_ranks]);
+    MPI_Alltoallv(queries.data(), query_counts.data(), query_displs.data(),
+                  MPI_INT, requests.data(), request_counts.data(),
+                  request_displs.data(), MPI_INT, comm);
+
+    // Answer with the offsets and links at the start of this round
+    std::vector<double> answer_offsets(requests.size());
+    std::vector<int> answer_links(requests.size());
+    for (int i = 0; i < static_cast<int>(requests.size()); ++i) {
+      int v = requests[i] - vertex_begin;
+      answer_offsets[i] = offset(v);
+      answer_links[i] = link[v];
+    }
+
+    std::vector<double> query_offsets(queries.size());
+    std::vector<int> query_links(queries.size());
+    MPI_Alltoallv(answer_offsets.data(), request_counts.data(),
+                  request_displs.data(), MPI_DOUBLE, query_offsets.data(),
+                  query_counts.data(), query_displs.data(), MPI_DOUBLE, comm);
+    MPI_Alltoallv(answer_links.data(), request_counts.data(),
+                  request_displs.data(), MPI_INT, query_links.data(),
+                  query_counts.data(), query_displs.data(), MPI_INT, comm);
+
+    for (int i = 0; i < n_owned_vertices; ++i) {
+      if (link[i] >= 0) {
+        int k = std::lower_bound(queries.begin(), queries.end(), link[i])
+            - queries.begin();
+        offset(i) += query_offsets[k];
+        link[i] = query_links[k];
+      }
+    }
+  }
+
+  // Recover geodesic distance in the original scale
+  geod_dist_values = offset * part->model_scaling_factor;
+}
+
+void DistributedGeodesicSolver::print_statistics() {
+  double times[4] = { setup_time, heat_time, admm_time, integration_time };
+  double max_times[4];
+  MPI_Reduce(times, max_times, 4, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  double counts[4] = { double(n_owned_faces), double(vertex_halo.n_ghosts()),
+      double(face_halo.n_ghosts()), vertex_halo.received_bytes()
+          + face_halo.received_bytes() };
+  double sum_counts[4], max_counts[4];
+  MPI_Reduce(counts, sum_counts, 4, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(counts, max_counts, 4, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  if (rank != 0) {
+    return;
+  }
+
+  int n_ranks = part->n_ranks;
+  std::cout << std::endl;
+  std::cout << "====== Distributed solver (" << n_ranks << " ranks) ======"
+            << std::endl;
+  std::cout << "Gauss-Seidel iterations: " << gs_iter
+            << ", ADMM iterations: " << iter_num << std::endl;
+  std::cout << "Face imbalance (max / mean): "
+            << max_counts[0] / (sum_counts[0] / n_ranks) << std::endl;
+  std::cout << "Ghost vertices: " << sum_counts[1] << ", ghost faces: "
+            << sum_counts[2] << std::endl;
+  std::cout << "Halo exchange volume: " << sum_counts[3] / (1 << 20)
+            << " MB in total, " << max_counts[3] / (1 << 20)
+            << " MB on the busiest rank" << std::endl;
+  std::cout << "Maximum time over ranks:" << std::endl;
+  std::cout << "Setup of halo exchanges: " << max_times[0] << " seconds"
+            << std::endl;
+  std::cout << "Gauss-Seidel initialization of gradients: " << max_times[1]
+            << " seconds" << std::endl;
+  std::cout << "ADMM solver for integrable gradients: " << max_times[2]
+            << " seconds" << std::endl;
+  std::cout << "Integration of gradients: " << max_times[3] << " seconds"
+            << std::endl;
+}
@@ -0,0 +1,134 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef DISTRIBUTEDGEODESICSOLVER_H_
+#define DISTRIBUTEDGEODESICSOLVER_H_
+
+#include "EigenTypes.h"
+#include "Parameters.h"
+#include "MeshPartition.h"
+#include "HaloExchange.h"
+#include <mpi.h>
+#include <utility>
+#include <vector>
+
+// Face-based geodesic distance solver for a mesh distributed over MPI ranks.
+//
+// Each rank holds one MeshPartition, with ghost copies of the vertices and
+// faces of neighboring ranks that its computation reads:
+// - The heat flow is solved with Gauss-Seidel sweeps over the owned vertices
+//   in BFS layer order, followed by a halo exchange of the heat values after
+//   each sweep.
+// - In the ADMM solver, the auxiliary and dual variables of an edge between
+//   faces of two ranks are updated by both ranks from the same data, so that
+//   they stay identical; only the gradients of ghost faces are exchanged in
+//   each iteration. Residual norms are summed over the edges owned by each
+//   rank.
+// - Distances are integrated along the BFS tree within each rank, and the
+//   offsets of tree paths crossing rank boundaries are resolved by pointer
+//   jumping, which needs a logarithmic number of communication rounds.
+//
+// With one rank, the result is identical to FaceBasedGeodesicSolver.
+class DistributedGeodesicSolver {
+ public:
+  DistributedGeodesicSolver();
+
+  // Solve on the part of this rank. Collective over comm.
+  bool solve(MPI_Comm comm, const MeshPartition &partition,
+             const Parameters &para);
+
+  // Distances of the owned vertices
+  const DenseVector& get_distance_values();
+
+  // Print timing, iteration counts and communication volume on rank 0.
+  // Collective over the communicator used by solve().
+  void print_statistics();
+
+ private:
+  typedef long double HeatScalar;
+  typedef Eigen::Matrix<HeatScalar, Eigen::Dynamic, 1> VectorHS;
+  typedef Eigen::Matrix<HeatScalar, 3, 1> Vector3HS;
+  typedef Eigen::Matrix<HeatScalar, 3, 3> Matrix3HS;
+
+  MPI_Comm comm;
+  int rank;
+  const MeshPartition *part;
+  Parameters param;
+
+  int n_owned_vertices;
+  int n_owned_faces;
+  int n_local_edges;
+  int n_owned_edges;
+  int vertex_begin;  // Global index of the first owned vertex
+
+  HaloExchange vertex_halo, face_halo;
+
+  // Laplacian rows of owned vertices, with local vertex indices
+  std::vector<std::pair<int, double> > laplacian_coef;
+
+  Matrix3Xi face_local_vertices;  // Local indices of the vertices of each owned face
+  Matrix2Xi transition_local_faces;  // Local indices of the faces of each transition edge, or -1
+
+  VectorHS heat_values;  // Owned vertices, then ghost vertices
+
+  Matrix2Xi S;  // Local indices of the two faces of each local edge
+  Matrix3X e;  // Unit vectors of local edges
+  Matrix3X init_grad;  // Owned faces
+  Matrix3X G;  // Owned faces, then ghost faces
+  Matrix3X Y, D;
+  Matrix3X SG1, SG2;
+  Matrix3X *prev_SG, *current_SG;
+  DenseVector Y_area, Y_area_squared;
+  Matrix3Xi faces_Y_index;  // Columns of Y associated with each owned face
+
+  DenseVector geod_dist_values;
+
+  int gs_iter;
+  int iter_num;
+  double primal_residual_sqr_norm_threshold, dual_residual_sqr_norm_threshold;
+
+  // Wall-clock time of each phase
+  double setup_time, heat_time, admm_time, integration_time;
+
+  bool setup();
+  void gauss_seidel_init_gradients();
+  void compute_heatflow_residual(VectorHS &residuals);
+  HeatScalar global_norm(const VectorHS &values);
+  void prepare_integrable_gradients();
+  void compute_integrable_gradients();
+  void integrate_geodesic_distance();
+
+  void update_Y();
+  void update_G();
+  bool update_dual_variables();
+};
+
+#endif /* DISTRIBUTEDGEODESICSOLVER_H_ */
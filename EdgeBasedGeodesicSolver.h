@@ -29,100 +29,83 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
-
 #ifndef EDGEBASEDGEODESICSOLVER_H_
 #define EDGEBASEDGEODESICSOLVER_H_
 
-#include "EigenTypes.h"
-#include "surface_mesh/Surface_mesh.h"
-#include "Parameters.h"
+#include "GeodesicSolverCore.h"
 
-class EdgeBasedGeodesicSolver {
+class EdgeBasedGeodesicSolver : public GeodesicSolverCore<
+    EdgeBasedGeodesicSolver, long double> {
  public:
   EdgeBasedGeodesicSolver();
 
-  bool solve(const char* mesh_file, const Parameters &para);
-
-  const DenseVector& get_distance_values();
-
   const DenseVector& get_heat_solution();
 
  private:
+  friend class GeodesicSolverCore<EdgeBasedGeodesicSolver, long double>;
+  template<typename Solver> friend class KernelBenchmark;
 
-  typedef surface_mesh::Surface_mesh MeshType;
-  MeshType mesh;
-  double model_scaling_factor;
-
-  Parameters param;
-
-  IndexVector bfs_vertex_list;  // Non-source vertex indices stored according to their BFS order
-  IndexVector bfs_segment_addr;  // Addresses within bfs_vertex_list for the first vertex in each BFS layer
-
-  std::pair<int, double>* bfs_laplacian_coef;  // Vertices and their weights for evaluating cotan Laplacian
-  IndexVector bfs_laplacian_coef_addr;  // Starting addresses for the segment of each Laplacian within bfs_laplacian_vtx
+  static const int init_grad_last_phase = ADMM_PHASE;  // As the storage of Z
 
   //
-  DenseVector X;  // Paper: X  variables of difference value on each edge
-  DenseVector Z;  // Paper: Z  variables of target difference value on each halfedge.
-  DenseVector Y;  // Paper: Y  auxiliary variable
-  DenseVector D;  // Paper: D  scaled dual variable
-
-  Matrix3Xi S;  // Paper: S  selection matrix, each column storing the three indices associated with an face
-  Matrix3Xi Q;  // paper: Q  orientation matrix, each column storing the three indices (-1 or 1)
-  Matrix2Xi edges_Y_index;  // the set of rows in Vector Y that corresponding to each edge
-
-  DenseVector SX1, SX2;  // Storage for S * X
-  DenseVector *current_SX, *prev_SX;  // Pointer to current and previous S * X buffers.
+  VectorBuffer X;  // Paper: X  variables of difference value on each edge
+  VectorBuffer Z;  // Paper: Z  variables of target difference value on each halfedge.
+  VectorBuffer Y;  // Paper: Y  auxiliary variable
+  VectorBuffer D;  // Paper: D  scaled dual variable
 
-  IndexVector transition_halfedge_idx;
-  IndexVector transition_from_vtx;
-  IndexVector transition_edge_idx;
-  IndexVector transition_edge_orientation;
-
-  Matrix3X edge_vector;
-  DenseVector face_area;
-  Matrix3X init_grad;   // initial gradients computed from heat flow
-
-  bool need_compute_residual_norms;
-
-  DenseVector geod_dist_values;
+  Matrix3XiBuffer S;  // Paper: S  selection matrix, each column storing the three indices associated with an face
+  Matrix3XiBuffer Q;  // paper: Q  orientation matrix, each column storing the three indices (-1 or 1)
+  Matrix2XiBuffer edges_Y_index;  // the set of rows in Vector Y that corresponding to each edge
+  IndexVectorBuffer edges_Y_count;  // Number of faces of each edge, while setting up edges_Y_index
 
-  int n_vertices;         // number of vertices
-  int n_faces;            // number of faces
-  int n_edges;            // number of edges
-  int n_halfedges;        // number of halfedges;
-  int n_interior_edges;            // number of interior edges
+  VectorBuffer SX1, SX2;  // Storage for S * X
+  VectorBuffer *current_SX, *prev_SX;  // Pointer to current and previous S * X buffers.
 
-  int iter_num;
+  // Whether S * X is stored in SX1 and SX2, or gathered from X when needed
+  // in the lower-memory variant of ADMM
+  bool store_SX;
+  VectorBuffer prev_X;  // X of the previous iteration in the lower-memory variant, for the dual residual
 
-  // Variables for primal and dual residuals
-  double primal_residual_sqr_norm, dual_residual_sqr_norm;
-  double primal_residual_sqr_norm_threshold, dual_residual_sqr_norm_threshold;
-
-  // Variables for the progress of the solver
-  bool output_progress;
-  bool optimization_converge, optimization_end;
-
-  bool load_input(const char* mesh_file);
-  void normalize_mesh();
+  IndexVectorBuffer transition_edge_idx;
+  IndexVector transition_edge_orientation;
 
-  void init_bfs_paths();
+  // Steps called by GeodesicSolverCore
+  void prepare_layout() {
+  }
+  void select_admm_variant(bool store_products) {
+    store_SX = store_products;
+  }
+  void layout_admm_buffers();
   void prepare_integrate_geodesic_distance();
-  void gauss_seidel_init_gradients();
-  void compute_integrable_gradients();
-  void integrate_geodesic_distance();
+  void init_admm_variables();
+  void stream_admm_buffers();
+  void add_admm_placement(NumaPlacement::Report &placement);
+  void print_admm_memory();
+
+  void admm_iteration() {
+    update_Y();
+    update_X();
+    update_dual_variables();
+  }
+
+  void prefetch_transitions(MeshIndex begin, MeshIndex n) {
+    arena.prefetch(&transition_edge_idx(begin), n * sizeof(MeshIndex));
+  }
+
+  // Difference of distance along the transition edge, with the sign of its
+  // orientation
+  double transition_difference(MeshIndex i) {
+    MeshIndex edge_index = transition_edge_idx(i);
+    if (edge_index >= 0) {
+      return X(edge_index);
+    } else {
+      return -X(-(edge_index + 1));
+    }
+  }
 
   void update_Y();                          // update Y
   void update_X();                          // update X
   void update_dual_variables();  // update dual variables and check if the solver converges
-
-  typedef long double HeatScalar;
-  typedef Eigen::Matrix<HeatScalar, Eigen::Dynamic, 1> VectorHS;
-  typedef Eigen::Matrix<HeatScalar, 3, 1> Vector3HS;
-  typedef Eigen::Matrix<HeatScalar, 3, 3> Matrix3HS;
-  void compute_heatflow_residual(const VectorHS &heat_values,
-                                 HeatScalar init_source_val,
-                                 VectorHS &residuals);
 };
 
 #endif /* GEODESICDISTANCESOLVER_H_ */
@@ -33,18 +33,30 @@
 
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
+#include <cstdint>
+
+// Index of mesh elements (vertices, faces, edges, halfedges) and of entries
+// in per-element arrays. int is the default; builds with WITH_64BIT_INDICES
+// use 64-bit indices, for meshes whose halfedge count or Laplacian size does
+// not fit in int (about 600M faces or more).
+#ifdef USE_64BIT_INDICES
+typedef std::int64_t MeshIndex;
+#else
+typedef int MeshIndex;
+#endif
 
 // Define eigen matrix types
 typedef Eigen::Matrix<double, 3, Eigen::Dynamic> Matrix3X;
 typedef Eigen::Matrix<double, 2, Eigen::Dynamic> Matrix2X;
-typedef Eigen::Matrix<int, 2, Eigen::Dynamic> Matrix2Xi;
+typedef Eigen::Matrix<MeshIndex, 2, Eigen::Dynamic> Matrix2Xi;
 typedef Eigen::Matrix<double, Eigen::Dynamic, 3> MatrixX3;
 typedef Eigen::Matrix<double, Eigen::Dynamic, 2> MatrixX2;
 typedef Eigen::Matrix<double, 3, 2> Matrix32;
-typedef Eigen::Matrix<int, 3, Eigen::Dynamic> Matrix3Xi;
+typedef Eigen::Matrix<MeshIndex, 3, Eigen::Dynamic> Matrix3Xi;
 typedef Eigen::VectorXd DenseVector;
-typedef Eigen::VectorXi IndexVector;
-typedef Eigen::Vector2i IndexPair;
+typedef Eigen::Matrix<MeshIndex, Eigen::Dynamic, 1> IndexVector;
+typedef Eigen::Matrix<MeshIndex, 2, 1> IndexPair;
+typedef Eigen::Matrix<MeshIndex, 3, 1> IndexTriple;
 
 // Conversion between a 3d vector type to Eigen::Vector3d
 template<typename Vec_T>
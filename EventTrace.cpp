@@ -0,0 +1,242 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "EventTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <process.h>
+#endif
+
+namespace {
+
+const char* const kCategoryNames[EventTrace::CATEGORY_COUNT] = { "phase",
+    "layer", "iteration", "chunk" };
+
+// Names of the arguments of the events of each category, NULL if not used
+const char* const kArgNames[EventTrace::CATEGORY_COUNT][2] = { { NULL, NULL }, {
+    "sweep", "layer" }, { "iteration", NULL }, { "first_row", "end_row" } };
+
+// Serializes the traces appended by concurrent solves in this process
+std::mutex append_mutex;
+
+void write_string(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = str[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      const char *hex = "0123456789abcdef";
+      out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+// Microseconds of the monotonic clock, with nanosecond digits
+void write_microseconds(std::ostream &out, long long ns) {
+  char digits[32];
+  std::snprintf(digits, sizeof(digits), "%lld.%03lld", ns / 1000, ns % 1000);
+  out << digits;
+}
+
+long long nanoseconds(const EventTrace::TimePoint &t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      t.time_since_epoch()).count();
+}
+
+int process_id() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+}
+
+EventTrace::EventTrace()
+    : layer_sampling(1) {
+}
+
+void EventTrace::start(size_t capacity, int n_threads, int sampling) {
+  buffers.clear();
+  layer_sampling = sampling > 0 ? sampling : 1;
+  if (capacity == 0) {
+    return;
+  }
+
+  buffers.resize(n_threads > 0 ? n_threads : 1);
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    buffers[i].events.assign(capacity, Event());
+    buffers[i].n_added = 0;
+  }
+}
+
+size_t EventTrace::size() const {
+  size_t n = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    n += std::min<unsigned long long>(buffers[i].n_added,
+                                      buffers[i].events.size());
+  }
+  return n;
+}
+
+unsigned long long EventTrace::n_overwritten() const {
+  unsigned long long n = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    n += buffers[i].n_added;
+  }
+  return n - size();
+}
+
+int EventTrace::current_thread_id() {
+#ifdef __linux__
+  static thread_local int id = static_cast<int>(syscall(SYS_gettid));
+#else
+  // Ids of this process, which are only used to tell threads apart
+  static std::atomic<int> next_id(1);
+  static thread_local int id = next_id++;
+#endif
+  return id;
+}
+
+void EventTrace::write_events(std::ostream &out,
+                              const std::string &mesh) const {
+  int pid = process_id();
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    const ThreadBuffer &buffer = buffers[i];
+    unsigned long long n = std::min<unsigned long long>(buffer.n_added,
+                                                        buffer.events.size());
+    if (n == 0) {
+      continue;
+    }
+
+    // Name the thread after its number in the solver
+    const Event &first = buffer.events[(buffer.n_added - n)
+        % buffer.events.size()];
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << first.thread_id
+        << ",\"args\":{\"name\":\"solver thread " << i << "\"}},\n";
+
+    for (unsigned long long k = buffer.n_added - n; k < buffer.n_added; ++k) {
+      const Event &event = buffer.events[k % buffer.events.size()];
+      long long begin_ns = nanoseconds(event.begin);
+      out << "{\"name\":";
+      write_string(out, event.name);
+      out << ",\"cat\":\"" << kCategoryNames[event.category]
+          << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":"
+          << event.thread_id << ",\"ts\":";
+      write_microseconds(out, begin_ns);
+      out << ",\"dur\":";
+      write_microseconds(out, nanoseconds(event.end) - begin_ns);
+      out << ",\"args\":{";
+      if (event.category == PHASE) {
+        out << "\"mesh\":";
+        write_string(out, mesh);
+      }
+      for (int a = 0; a < 2; ++a) {
+        const char *arg_name = kArgNames[event.category][a];
+        if (arg_name != NULL) {
+          out << (a > 0 ? "," : "") << "\"" << arg_name << "\":"
+              << event.args[a];
+        }
+      }
+      out << "}},\n";
+    }
+  }
+
+  if (n_overwritten() > 0) {
+    out << "{\"name\":\"overwritten_events\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"args\":{\"count\":" << n_overwritten() << "}},\n";
+  }
+}
+
+bool EventTrace::append(const std::string &file_name,
+                        const std::string &mesh) const {
+  // Format the events first, so that the file is only written once
+  std::ostringstream events;
+  write_events(events, mesh);
+  std::string text = events.str();
+  if (text.empty()) {
+    return true;
+  }
+  text.erase(text.size() - 2);  // The last comma and newline
+
+  std::lock_guard<std::mutex> lock(append_mutex);
+  std::fstream file(file_name.c_str(),
+                    std::ios::in | std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::ofstream new_file(file_name.c_str(), std::ios::binary);
+    new_file << "[\n" << text << "\n]\n" << std::flush;
+    if (!new_file) {
+      std::cerr << "Error: unable to write event trace file " << file_name
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Replace the closing bracket of the array with the new events
+  file.seekg(0, std::ios::end);
+  long long length = file.tellg();
+  long long tail_begin = std::max(0LL, length - 16);
+  std::string tail(length - tail_begin, '\0');
+  file.seekg(tail_begin);
+  file.read(&tail[0], tail.size());
+  std::string::size_type bracket = tail.rfind(']');
+  if (!file || bracket == std::string::npos) {
+    std::cerr << "Error: " << file_name << " is not an event trace file"
+              << std::endl;
+    return false;
+  }
+
+  file.seekp(tail_begin + bracket);
+  file << ",\n" << text << "\n]\n" << std::flush;
+  if (!file) {
+    std::cerr << "Error: unable to write event trace file " << file_name
+              << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,146 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef EVENTTRACE_H_
+#define EVENTTRACE_H_
+
+#include "OMPHelper.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Begin and end times of the phases of a solve, of sampled BFS layers, of the
+// iterations of the solvers and of the share of each thread in the heat
+// solver loops, for finding where the time of a slow run goes. The events are
+// recorded into buffers allocated before the solve, one for each thread of
+// the solver, so that threads record them without synchronization. When the
+// buffer of a thread is full, its oldest events are overwritten.
+//
+// The events are written at the end of the solve in the JSON array format of
+// Chrome traces, which Perfetto and chrome://tracing open, as complete ("X")
+// events with the process and thread ids of the system and timestamps in
+// microseconds of the monotonic clock. The events of later solves are added
+// to the array of an existing file, which remains valid JSON.
+class EventTrace {
+ public:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  enum Category {
+    PHASE = 0,  // Phase of the solve
+    LAYER = 1,  // BFS layer; args: sweep, layer
+    ITERATION = 2,  // Iteration of a solver; args: iteration
+    CHUNK = 3,  // Share of a thread in a loop; args: first row, end row
+    CATEGORY_COUNT = 4
+  };
+
+  struct Event {
+    const char *name;  // Not copied
+    int category;
+    int thread_id;  // Of the system
+    TimePoint begin;
+    TimePoint end;
+    long long args[2];  // -1 if not used
+  };
+
+  EventTrace();
+
+  // Clear the events and allocate room for capacity of them for each of
+  // n_threads threads, 0 to disable recording. Every layer_sampling-th BFS
+  // layer is recorded, with the shares of the threads in its loops.
+  void start(size_t capacity, int n_threads, int layer_sampling);
+
+  bool enabled() const {
+    return !buffers.empty();
+  }
+
+  // Whether the BFS layer counted as layer is recorded
+  bool sampled(long long layer) const {
+    return !buffers.empty() && layer % layer_sampling == 0;
+  }
+
+  static TimePoint now() {
+    return std::chrono::steady_clock::now();
+  }
+
+  // Record an event of the calling thread from begin until now
+  void add(const char *name, int category, TimePoint begin,
+           long long arg0 = -1, long long arg1 = -1) {
+    int slot = thread_slot();
+    if (slot >= static_cast<int>(buffers.size())) {
+      return;
+    }
+
+    ThreadBuffer &buffer = buffers[slot];
+    Event &event = buffer.events[buffer.n_added % buffer.events.size()];
+    event.name = name;
+    event.category = category;
+    event.thread_id = current_thread_id();
+    event.begin = begin;
+    event.end = now();
+    event.args[0] = arg0;
+    event.args[1] = arg1;
+    buffer.n_added++;
+  }
+
+  // Number of events kept, and of events overwritten, over all threads
+  size_t size() const;
+  unsigned long long n_overwritten() const;
+
+  // Add the events to the trace in the file, creating it if needed; the mesh
+  // name is stored with the phases
+  bool append(const std::string &file_name, const std::string &mesh) const;
+
+ private:
+  struct ThreadBuffer {
+    std::vector<Event> events;
+    unsigned long long n_added;
+    char padding[64];  // Keeps the counters of threads in separate lines
+  };
+
+  std::vector<ThreadBuffer> buffers;
+  int layer_sampling;
+
+  static int thread_slot() {
+#if defined(USE_OPENMP) && !defined(USE_TASK_SCHEDULER)
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+  }
+
+  static int current_thread_id();
+
+  // The events as elements of the JSON array, with a comma after each
+  void write_events(std::ostream &out, const std::string &mesh) const;
+};
+
+#endif /* EVENTTRACE_H_ */
@@ -0,0 +1,78 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "MeshGenerator.h"
+#include "surface_mesh/IO.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: GenerateMesh KIND:FACES[:shuffled] OUTPUT_MESH_FILE"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<MeshGenerator::Spec> specs;
+  if (!MeshGenerator::parse(argv[1], specs) || specs.size() != 1) {
+    std::cerr << "Error: invalid mesh specification " << argv[1] << std::endl;
+    return 1;
+  }
+
+  Matrix3X points;
+  Matrix3Xi faces;
+  MeshGenerator::generate(specs[0], points, faces);
+  std::cout << "Generated " << MeshGenerator::name(specs[0]) << ": "
+            << points.cols() << " vertices, " << faces.cols() << " faces"
+            << std::endl;
+
+  // OFF files are written in binary, other formats through surface_mesh
+  std::string file_name = argv[2];
+  std::string::size_type dot = file_name.rfind('.');
+  std::string extension =
+      (dot == std::string::npos) ? "" : file_name.substr(dot + 1);
+  bool success = false;
+  if (extension == "off" || extension == "OFF") {
+    success = MeshGenerator::write_binary_off(points, faces, file_name);
+  } else {
+    surface_mesh::Surface_mesh mesh;
+    success = MeshGenerator::build(points, faces, mesh)
+        && surface_mesh::write_mesh(mesh, file_name);
+  }
+
+  if (!success) {
+    std::cerr << "Error: unable to write mesh file " << file_name << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,584 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "GeodesicOperator.h"
+#include "surface_mesh/IO.h"
+#include "OMPHelper.h"
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdint.h>
+#include <thread>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Layout of the storage block: this header, followed by the arrays in the
+// order of ArrayId, each starting at a multiple of kArrayAlignment bytes.
+struct GeodesicOperator::StoreHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t state;
+  uint64_t index_size;  // sizeof(MeshIndex) of the building process
+  int64_t n_vertices;
+  int64_t n_faces;
+  int64_t n_edges;
+  int64_t n_halfedges;
+  int64_t n_vertex_halfedges;
+  double model_scaling_factor;
+  double heat_step_length;
+  uint64_t total_size;
+  uint64_t offsets[N_ARRAYS];
+  char mesh_file[1024];  // Canonical path of the mesh the operator is built from
+};
+
+namespace {
+
+const uint64_t kStoreMagic = 0x504f4854415248ULL;
+const uint32_t kStoreVersion = 2;
+
+enum StoreState {
+  STORE_BUILDING = 0,
+  STORE_READY = 1,
+  STORE_FAILED = 2
+};
+
+const std::size_t kArrayAlignment = 64;
+
+// How long a process waits for another process to finish building a store
+const int kAttachTimeoutSeconds = 3600;
+
+std::size_t align_size(std::size_t size) {
+  return (size + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+}
+
+// The state is written by the building process after all arrays are filled,
+// and polled by attaching processes.
+void store_state(uint32_t *state, uint32_t value) {
+#if defined(__GNUC__)
+  __atomic_store_n(state, value, __ATOMIC_RELEASE);
+#else
+  *static_cast<volatile uint32_t*>(state) = value;
+#endif
+}
+
+uint32_t load_state(const uint32_t *state) {
+#if defined(__GNUC__)
+  return __atomic_load_n(state, __ATOMIC_ACQUIRE);
+#else
+  return *static_cast<const volatile uint32_t*>(state);
+#endif
+}
+
+// Return the free pages of the heap to the system. glibc keeps the memory of
+// a freed mesh for later allocations, where it would add to the peak memory
+// of the solve.
+void trim_heap() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+std::string canonical_path(const char *file) {
+#ifndef _WIN32
+  char buffer[PATH_MAX];
+  if (realpath(file, buffer) != NULL) {
+    return std::string(buffer);
+  }
+#endif
+  return std::string(file);
+}
+
+}
+
+GeodesicOperator::GeodesicOperator()
+    : n_vertices(0),
+      n_faces(0),
+      n_edges(0),
+      n_halfedges(0),
+      model_scaling_factor(1.0),
+      heat_step_length(0),
+      halfedge_to_vertex(NULL, 0),
+      halfedge_face(NULL, 0),
+      vertex_halfedges(NULL, 0),
+      vertex_halfedge_addr(NULL, 0),
+      face_halfedges(NULL, 3, 0),
+      edge_vector(NULL, 3, 0),
+      face_area(NULL, 0),
+      vertex_area(NULL, 0),
+      edge_laplacian_weight(NULL, 0),
+      attached_(false) {
+}
+
+bool GeodesicOperator::read_mesh(surface_mesh::Surface_mesh &mesh,
+                                 const char* mesh_file) {
+  if (!surface_mesh::read_mesh(mesh, mesh_file)) {
+    std::cerr << "Error: unable to read input mesh from the file " << mesh_file
+              << std::endl;
+    return false;
+  }
+
+  mesh.free_memory();  // Free unused memory
+  trim_heap();
+  return true;
+}
+
+bool GeodesicOperator::build(const char* mesh_file) {
+  clear();
+  surface_mesh::Surface_mesh mesh;
+  return read_mesh(mesh, mesh_file) && build_arrays(mesh, NULL, true);
+}
+
+bool GeodesicOperator::build(surface_mesh::Surface_mesh &mesh) {
+  clear();
+  return build_arrays(mesh, NULL, false);
+}
+
+bool GeodesicOperator::build(const char* mesh_file, const std::string &store) {
+  if (store.empty()) {
+    return build(mesh_file);
+  }
+
+  MappedRegion::Kind kind;
+  std::string name;
+  if (!parse_store(store, kind, name)) {
+    return false;
+  }
+
+  clear();
+  bool already_exists = false;
+  if (storage.create(kind, name, already_exists)) {
+    // This is the first process using the store: build the operator into it
+    surface_mesh::Surface_mesh mesh;
+    if (!(read_mesh(mesh, mesh_file) && build_arrays(mesh, mesh_file, true))) {
+      abandon_store(name);
+      return false;
+    }
+
+    return true;
+  }
+
+  if (!already_exists || !storage.open(kind, name)) {
+    return false;
+  }
+
+  if (!attach(mesh_file)) {
+    clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool GeodesicOperator::build_in_directory(const char* mesh_file,
+                                          const std::string &directory) {
+  clear();
+  surface_mesh::Surface_mesh mesh;
+  if (!(storage.create_temporary(directory) && read_mesh(mesh, mesh_file)
+      && build_arrays(mesh, NULL, true))) {
+    clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool GeodesicOperator::build_arrays(surface_mesh::Surface_mesh &mesh,
+                                    const char* mesh_file, bool release_mesh) {
+  typedef surface_mesh::Surface_mesh MeshType;
+
+  if (mesh.n_vertices() == 0 || mesh.n_faces() == 0 || mesh.n_edges() == 0) {
+    std::cerr << "Error: zero mesh element count " << std::endl;
+    return false;
+  }
+
+  normalize_mesh(mesh);
+
+  MeshIndex nv = mesh.n_vertices();
+  MeshIndex nf = mesh.n_faces();
+  MeshIndex ne = mesh.n_edges();
+  MeshIndex nh = mesh.n_halfedges();
+
+  IndexVector halfedge_addr(nv + 1);
+  halfedge_addr(0) = 0;
+  for (MeshIndex i = 0; i < nv; ++i) {
+    halfedge_addr(i + 1) = halfedge_addr(i)
+        + mesh.valence(MeshType::Vertex(i));
+  }
+
+  // Compute the layout of the storage block and allocate it
+  StoreHeader layout;
+  std::memset(&layout, 0, sizeof(StoreHeader));
+  layout.magic = kStoreMagic;
+  layout.version = kStoreVersion;
+  layout.state = STORE_BUILDING;
+  layout.index_size = sizeof(MeshIndex);
+  layout.n_vertices = nv;
+  layout.n_faces = nf;
+  layout.n_edges = ne;
+  layout.n_halfedges = nh;
+  layout.n_vertex_halfedges = halfedge_addr(nv);
+  if (mesh_file != NULL) {
+    std::strncpy(layout.mesh_file, canonical_path(mesh_file).c_str(),
+                 sizeof(layout.mesh_file) - 1);
+  }
+
+  std::size_t array_sizes[N_ARRAYS];
+  array_sizes[HALFEDGE_TO_VERTEX] = sizeof(MeshIndex) * nh;
+  array_sizes[HALFEDGE_FACE] = sizeof(MeshIndex) * nh;
+  array_sizes[VERTEX_HALFEDGES] = sizeof(MeshIndex) * layout.n_vertex_halfedges;
+  array_sizes[VERTEX_HALFEDGE_ADDR] = sizeof(MeshIndex) * (nv + 1);
+  array_sizes[FACE_HALFEDGES] = sizeof(MeshIndex) * 3 * nf;
+  array_sizes[EDGE_VECTOR] = sizeof(double) * 3 * ne;
+  array_sizes[FACE_AREA] = sizeof(double) * nf;
+  array_sizes[VERTEX_AREA] = sizeof(double) * nv;
+  array_sizes[EDGE_LAPLACIAN_WEIGHT] = sizeof(double) * ne;
+
+  std::size_t offset = align_size(sizeof(StoreHeader));
+  for (int i = 0; i < N_ARRAYS; ++i) {
+    layout.offsets[i] = offset;
+    offset += align_size(array_sizes[i]);
+  }
+  layout.total_size = offset;
+
+  bool allocated =
+      (storage.kind() == MappedRegion::HEAP) ?
+          storage.allocate(offset) : storage.map_writable(offset);
+  if (!allocated) {
+    return false;
+  }
+  std::memcpy(header(), &layout, sizeof(StoreHeader));
+
+  // Writable views of the arrays, shadowing the read-only members
+  Eigen::Map<IndexVector> halfedge_to_vertex(
+      array_data<MeshIndex>(HALFEDGE_TO_VERTEX), nh);
+  Eigen::Map<IndexVector> halfedge_face(array_data<MeshIndex>(HALFEDGE_FACE),
+                                        nh);
+  Eigen::Map<IndexVector> vertex_halfedges(
+      array_data<MeshIndex>(VERTEX_HALFEDGES), layout.n_vertex_halfedges);
+  Eigen::Map<IndexVector> vertex_halfedge_addr(
+      array_data<MeshIndex>(VERTEX_HALFEDGE_ADDR), nv + 1);
+  Eigen::Map<Matrix3Xi> face_halfedges(array_data<MeshIndex>(FACE_HALFEDGES),
+                                       3, nf);
+  Eigen::Map<Matrix3X> edge_vector(array_data<double>(EDGE_VECTOR), 3, ne);
+  Eigen::Map<DenseVector> face_area(array_data<double>(FACE_AREA), nf);
+  Eigen::Map<DenseVector> vertex_area(array_data<double>(VERTEX_AREA), nv);
+  Eigen::Map<DenseVector> edge_laplacian_weight(
+      array_data<double>(EDGE_LAPLACIAN_WEIGHT), ne);
+
+  DenseVector edge_sqr_length(ne);
+  vertex_halfedge_addr = halfedge_addr;
+
+  // Arrays read from the mesh
+  OMP_PARALLEL
+  {
+    PARALLEL_FOR(MeshIndex, i, 0, nh) {
+      MeshType::Halfedge heh(i);
+      halfedge_to_vertex(i) = mesh.to_vertex(heh).idx();
+      halfedge_face(i) = mesh.face(heh).idx();
+    } PARALLEL_FOR_END
+
+    PARALLEL_FOR(MeshIndex, i, 0, nv) {
+      MeshIndex k = vertex_halfedge_addr(i);
+      MeshType::Halfedge_around_vertex_circulator vhc, vhc_end;
+      vhc = vhc_end = mesh.halfedges(MeshType::Vertex(i));
+      do {
+        vertex_halfedges(k++) = (*vhc).idx();
+      } while (++vhc != vhc_end);
+    } PARALLEL_FOR_END
+
+    PARALLEL_FOR(MeshIndex, i, 0, ne) {
+      // Precompute edge vectors and squared edge length,
+      // to be used later for computing cotan weights and areas
+      MeshType::Halfedge heh = mesh.halfedge(MeshType::Edge(i), 0);
+      Eigen::Vector3d edge_vec = to_eigen_vec3d(
+          mesh.position(mesh.to_vertex(heh))
+              - mesh.position(mesh.from_vertex(heh)));
+      edge_vector.col(i) = edge_vec;
+      edge_sqr_length(i) = edge_vec.squaredNorm();
+    } PARALLEL_FOR_END
+
+    PARALLEL_FOR(MeshIndex, i, 0, nf) {
+      int k = 0;
+      MeshType::Halfedge_around_face_circulator fhc, fhc_end;
+      fhc = fhc_end = mesh.halfedges(MeshType::Face(i));
+      do {
+        face_halfedges(k++, i) = (*fhc).idx();
+      } while (++fhc != fhc_end);
+    } PARALLEL_FOR_END
+  }
+
+  // The remaining arrays only need the ones above, so a mesh read by the
+  // operator is released before they are written, to lower the peak memory
+  if (release_mesh) {
+    mesh.clear();
+    trim_heap();
+  }
+
+  OMP_PARALLEL
+  {
+    OMP_SINGLE
+    {
+      // Compute heat flow step size
+      double h = edge_sqr_length.array().sqrt().mean();
+      heat_step_length = h * h;
+    }
+
+    PARALLEL_FOR(MeshIndex, i, 0, nf) {
+      // Edges of the face; halfedges 2*e and 2*e+1 belong to edge e
+      double area = edge_vector.col(face_halfedges(0, i) >> 1).cross(
+          edge_vector.col(face_halfedges(1, i) >> 1)).norm() * 0.5;
+      face_area(i) = area;
+    } PARALLEL_FOR_END
+
+    PARALLEL_FOR(MeshIndex, i, 0, ne) {
+      // Half cotan value of the angle opposite to each halfedge of the edge,
+      // from the squared lengths of the edges of its face
+      double halfcot[2] = { 0, 0 };
+      for (int k = 0; k < 2; ++k) {
+        MeshIndex heh = 2 * i + k;
+        MeshIndex f = halfedge_face(heh);
+        if (f < 0) {
+          continue;
+        }
+
+        int j = 0;
+        while (face_halfedges(j, f) != heh) {
+          j++;
+        }
+        Eigen::Vector3d edge_l2;
+        for (int m = 0; m < 3; ++m) {
+          edge_l2(m) = edge_sqr_length(face_halfedges(m, f) >> 1);
+        }
+        halfcot[k] = 0.125
+            * (edge_l2((j + 1) % 3) + edge_l2((j + 2) % 3) - edge_l2(j))
+            / face_area(f);
+      }
+
+      edge_laplacian_weight(i) = halfcot[0] + halfcot[1];
+    } PARALLEL_FOR_END
+
+    PARALLEL_FOR(MeshIndex, i, 0, nv) {
+      double A = 0;
+      for (MeshIndex j = vertex_halfedge_addr(i);
+          j < vertex_halfedge_addr(i + 1); ++j) {
+        MeshIndex f = halfedge_face(vertex_halfedges(j));
+        if (f >= 0) {
+          A += face_area(f);
+        }
+      }
+
+      vertex_area(i) = A / 3.0;
+    } PARALLEL_FOR_END
+  }
+
+  header()->heat_step_length = heat_step_length;
+  header()->model_scaling_factor = model_scaling_factor;
+  store_state(&header()->state, STORE_READY);
+
+  map_arrays();
+  return true;
+}
+
+bool GeodesicOperator::attach(const char* mesh_file) {
+  // Wait until the building process has sized the store and marked it ready
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now()
+          + std::chrono::seconds(kAttachTimeoutSeconds);
+  while (true) {
+    if (storage.data() == NULL && storage.current_size() >= sizeof(StoreHeader)) {
+      if (!storage.map_readonly()) {
+        return false;
+      }
+    }
+
+    if (storage.data() != NULL) {
+      uint32_t state = load_state(&header()->state);
+      if (state == STORE_READY) {
+        break;
+      } else if (state == STORE_FAILED) {
+        std::cerr << "Error: the process building the operator store failed"
+                  << std::endl;
+        return false;
+      }
+    }
+
+    if (std::chrono::steady_clock::now() > deadline) {
+      std::cerr << "Error: timeout while waiting for the operator store"
+                << std::endl;
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  const StoreHeader *h = header();
+  if (h->magic != kStoreMagic || h->version != kStoreVersion
+      || h->total_size > storage.size()) {
+    std::cerr << "Error: invalid operator store" << std::endl;
+    return false;
+  }
+
+  if (h->index_size != sizeof(MeshIndex)) {
+    std::cerr << "Error: the operator store is built with "
+              << 8 * h->index_size << "-bit indices, and this program uses "
+              << 8 * sizeof(MeshIndex) << "-bit indices" << std::endl;
+    return false;
+  }
+
+  if (canonical_path(mesh_file) != h->mesh_file) {
+    std::cerr << "Error: the operator store is built from mesh " << h->mesh_file
+              << ", remove it before using another mesh" << std::endl;
+    return false;
+  }
+
+  model_scaling_factor = h->model_scaling_factor;
+  heat_step_length = h->heat_step_length;
+  attached_ = true;
+  map_arrays();
+  return true;
+}
+
+void GeodesicOperator::abandon_store(const std::string &name) {
+  // Let waiting processes know that the store will not become ready
+  if (storage.data() != NULL || storage.map_writable(sizeof(StoreHeader))) {
+    store_state(&header()->state, STORE_FAILED);
+  }
+
+  MappedRegion::remove(storage.kind(), name);
+  clear();
+}
+
+void GeodesicOperator::map_arrays() {
+  const StoreHeader *h = header();
+  n_vertices = h->n_vertices;
+  n_faces = h->n_faces;
+  n_edges = h->n_edges;
+  n_halfedges = h->n_halfedges;
+
+  // Re-seat the maps in place, as recommended by the Eigen documentation
+  new (&halfedge_to_vertex) IndexArray(
+      array_data<MeshIndex>(HALFEDGE_TO_VERTEX), n_halfedges);
+  new (&halfedge_face) IndexArray(array_data<MeshIndex>(HALFEDGE_FACE),
+                                  n_halfedges);
+  new (&vertex_halfedges) IndexArray(array_data<MeshIndex>(VERTEX_HALFEDGES),
+                                     h->n_vertex_halfedges);
+  new (&vertex_halfedge_addr) IndexArray(
+      array_data<MeshIndex>(VERTEX_HALFEDGE_ADDR), n_vertices + 1);
+  new (&face_halfedges) Index3Array(array_data<MeshIndex>(FACE_HALFEDGES), 3,
+                                    n_faces);
+  new (&edge_vector) Vector3Array(array_data<double>(EDGE_VECTOR), 3, n_edges);
+  new (&face_area) ScalarArray(array_data<double>(FACE_AREA), n_faces);
+  new (&vertex_area) ScalarArray(array_data<double>(VERTEX_AREA), n_vertices);
+  new (&edge_laplacian_weight) ScalarArray(
+      array_data<double>(EDGE_LAPLACIAN_WEIGHT), n_edges);
+}
+
+GeodesicOperator::StoreHeader* GeodesicOperator::header() {
+  return reinterpret_cast<StoreHeader*>(storage.data());
+}
+
+template<typename T>
+T* GeodesicOperator::array_data(ArrayId id) {
+  return reinterpret_cast<T*>(storage.data() + header()->offsets[id]);
+}
+
+void GeodesicOperator::clear() {
+  n_vertices = 0;
+  n_faces = 0;
+  n_edges = 0;
+  n_halfedges = 0;
+  attached_ = false;
+  new (&halfedge_to_vertex) IndexArray(NULL, 0);
+  new (&halfedge_face) IndexArray(NULL, 0);
+  new (&vertex_halfedges) IndexArray(NULL, 0);
+  new (&vertex_halfedge_addr) IndexArray(NULL, 0);
+  new (&face_halfedges) Index3Array(NULL, 3, 0);
+  new (&edge_vector) Vector3Array(NULL, 3, 0);
+  new (&face_area) ScalarArray(NULL, 0);
+  new (&vertex_area) ScalarArray(NULL, 0);
+  new (&edge_laplacian_weight) ScalarArray(NULL, 0);
+  storage.release();
+}
+
+bool GeodesicOperator::parse_store(const std::string &store,
+                                   MappedRegion::Kind &kind,
+                                   std::string &name) {
+  std::string::size_type pos = store.find(':');
+  std::string prefix = store.substr(0, pos);
+  name = (pos == std::string::npos) ? std::string() : store.substr(pos + 1);
+  if (prefix == "shm" && !name.empty()) {
+    kind = MappedRegion::SHARED_MEMORY;
+    if (name[0] != '/') {
+      name = "/" + name;
+    }
+    return true;
+  } else if (prefix == "file" && !name.empty()) {
+    kind = MappedRegion::MAPPED_FILE;
+    return true;
+  }
+
+  std::cerr << "Error: invalid operator store " << store
+            << ", must be shm:NAME or file:PATH" << std::endl;
+  return false;
+}
+
+bool GeodesicOperator::remove_store(const std::string &store) {
+  MappedRegion::Kind kind;
+  std::string name;
+  return parse_store(store, kind, name) && MappedRegion::remove(kind, name);
+}
+
+void GeodesicOperator::normalize_mesh(surface_mesh::Surface_mesh &mesh) {
+  std::vector<surface_mesh::Point> &pos = mesh.points();
+
+  surface_mesh::Point min_coord = pos.front(), max_coord = pos.front();
+  std::vector<surface_mesh::Point>::iterator iter = pos.begin(), iter_end = pos
+      .end();
+
+  for (++iter; iter != iter_end; ++iter) {
+    surface_mesh::Point &coord = *iter;
+    min_coord.minimize(coord);
+    max_coord.maximize(coord);
+  }
+
+  model_scaling_factor = surface_mesh::norm(max_coord - min_coord);
+  surface_mesh::Point center_pos = (min_coord + max_coord) * 0.5;
+
+  for (iter = pos.begin(); iter != iter_end; ++iter) {
+    surface_mesh::Point &coord = *iter;
+    coord -= center_pos;
+    coord /= model_scaling_factor;
+  }
+}
@@ -0,0 +1,170 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef GEODESICOPERATOR_H_
+#define GEODESICOPERATOR_H_
+
+#include "EigenTypes.h"
+#include "MappedRegion.h"
+#include "surface_mesh/Surface_mesh.h"
+#include <string>
+
+// Mesh data shared by all distance queries on the same mesh: normalized
+// geometry, connectivity, and cotan Laplacian weights. It does not depend on
+// source vertices or solver parameters, and is only read by the solvers, so
+// that one operator can serve concurrent queries.
+//
+// Halfedges follow the surface_mesh convention: halfedges 2*i and 2*i+1 belong
+// to edge i and are opposite to each other.
+//
+// All arrays live in one contiguous block, which is either on the heap or in a
+// shared-memory object / mapped file that several processes can attach to.
+// The arrays are exposed as read-only Eigen maps into this block.
+class GeodesicOperator {
+ public:
+  typedef Eigen::Map<const IndexVector> IndexArray;
+  typedef Eigen::Map<const Matrix3Xi> Index3Array;
+  typedef Eigen::Map<const DenseVector> ScalarArray;
+  typedef Eigen::Map<const Matrix3X> Vector3Array;
+
+  GeodesicOperator();
+
+  // Read a mesh from file and build the operator
+  bool build(const char* mesh_file);
+
+  // Build the operator in a shared store ("shm:NAME" or "file:PATH"), or
+  // attach to it read-only if another process has already built it there.
+  // An empty store builds a private operator on the heap.
+  bool build(const char* mesh_file, const std::string &store);
+
+  // Build a private operator in a temporary file in the directory, whose
+  // pages can be written back and dropped under memory pressure
+  bool build_in_directory(const char* mesh_file, const std::string &directory);
+
+  // Build the operator from a mesh; the mesh is normalized in place
+  bool build(surface_mesh::Surface_mesh &mesh);
+
+  // Release all arrays. A shared store is detached but stays in the system.
+  void clear();
+
+  // Remove a shared store from the system
+  static bool remove_store(const std::string &store);
+
+  // Whether the arrays are attached from a store built by another process
+  bool attached() const {
+    return attached_;
+  }
+
+  bool empty() const {
+    return n_vertices == 0;
+  }
+
+  // Size of the storage block of the arrays
+  std::size_t storage_bytes() const {
+    return storage.size();
+  }
+
+  int valence(MeshIndex v) const {
+    return vertex_halfedge_addr(v + 1) - vertex_halfedge_addr(v);
+  }
+
+  MeshIndex from_vertex(MeshIndex h) const {
+    return halfedge_to_vertex(h ^ 1);
+  }
+
+  bool is_boundary_edge(MeshIndex e) const {
+    return halfedge_face(2 * e) < 0 || halfedge_face(2 * e + 1) < 0;
+  }
+
+  MeshIndex n_vertices;
+  MeshIndex n_faces;
+  MeshIndex n_edges;
+  MeshIndex n_halfedges;
+
+  double model_scaling_factor;  // Bounding box diagonal of the original mesh
+  double heat_step_length;  // Time step for heat flow, set to the squared mean edge length
+
+  IndexArray halfedge_to_vertex;
+  IndexArray halfedge_face;  // -1 for boundary halfedges
+  IndexArray vertex_halfedges;  // Outgoing halfedges of each vertex in counter-clockwise order
+  IndexArray vertex_halfedge_addr;  // Starting addresses for the segment of each vertex within vertex_halfedges
+  Index3Array face_halfedges;  // Halfedges of each face
+
+  Vector3Array edge_vector;  // Vector of the first halfedge of each edge
+  ScalarArray face_area;
+  ScalarArray vertex_area;  // One third of the total area of incident faces
+  ScalarArray edge_laplacian_weight;  // Cotan Laplacian weight of each edge
+
+ private:
+  // Arrays in the order of their placement within the storage block
+  enum ArrayId {
+    HALFEDGE_TO_VERTEX,
+    HALFEDGE_FACE,
+    VERTEX_HALFEDGES,
+    VERTEX_HALFEDGE_ADDR,
+    FACE_HALFEDGES,
+    EDGE_VECTOR,
+    FACE_AREA,
+    VERTEX_AREA,
+    EDGE_LAPLACIAN_WEIGHT,
+    N_ARRAYS
+  };
+
+  struct StoreHeader;
+
+  MappedRegion storage;
+  bool attached_;
+
+  static bool read_mesh(surface_mesh::Surface_mesh &mesh,
+                        const char* mesh_file);
+  static bool parse_store(const std::string &store, MappedRegion::Kind &kind,
+                          std::string &name);
+
+  // Build the arrays from the mesh, which is cleared along the way if
+  // release_mesh is set
+  bool build_arrays(surface_mesh::Surface_mesh &mesh, const char* mesh_file,
+                    bool release_mesh);
+  bool attach(const char* mesh_file);
+  void abandon_store(const std::string &name);
+  void map_arrays();
+
+  StoreHeader* header();
+
+  template<typename T>
+  T* array_data(ArrayId id);
+
+  void normalize_mesh(surface_mesh::Surface_mesh &mesh);
+
+  GeodesicOperator(const GeodesicOperator&);
+  GeodesicOperator& operator=(const GeodesicOperator&);
+};
+
+#endif /* GEODESICOPERATOR_H_ */
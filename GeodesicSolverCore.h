@@ -0,0 +1,1741 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef GEODESICSOLVERCORE_H_
+#define GEODESICSOLVERCORE_H_
+
+#include "EigenTypes.h"
+#include "GeodesicOperator.h"
+#include "Parameters.h"
+#include "BufferArena.h"
+#include "IndexDelta.h"
+#include "OMPHelper.h"
+#include "NumaPlacement.h"
+#include "PerfCounters.h"
+#include "ScheduleProfile.h"
+#include "SolveMetrics.h"
+#include "ConvergenceTrace.h"
+#include "EventTrace.h"
+#include "AccuracyTrace.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <limits>
+
+// Steps shared by the face-based and edge-based solvers: the BFS order, the
+// Gauss-Seidel heat solver with the initial gradients, the buffer layout, the
+// ADMM loop and the integration of the distances along the BFS tree.
+//
+// Formulation is the derived solver class, which holds the ADMM variables and
+// provides the steps that depend on them. They are called through static
+// dispatch, so that they are inlined into the loops of the core:
+//   void prepare_layout();  // Count the variables before the buffer layout
+//   void select_admm_variant(bool store_products);  // Store or gather S * G
+//   void layout_admm_buffers();
+//   void prepare_integrate_geodesic_distance();  // Set-up that reads the operator
+//   void init_admm_variables();  // Set-up after the operator is released
+//   void stream_admm_buffers();  // Advise the out-of-core access pattern
+//   void add_admm_placement(NumaPlacement::Report &placement);
+//   void print_admm_memory();
+//   void admm_iteration();  // One iteration, inside a parallel region
+//   void prefetch_transitions(MeshIndex begin, MeshIndex n);
+//   double transition_difference(MeshIndex i);  // From the transition vertex
+// together with the phase up to which the initial gradients are used:
+//   static const int init_grad_last_phase;
+//
+// HeatScalarT is the scalar type of the heat values.
+template<typename Formulation, typename HeatScalarT>
+class GeodesicSolverCore {
+ public:
+  GeodesicSolverCore();
+
+  bool solve(const char* mesh_file, const Parameters &para);
+
+  // Split version of solve(): load() reads and normalizes the mesh, and
+  // compute() runs the solver on it. Used for overlapping mesh loading with
+  // solving in batch runs.
+  bool load(const char* mesh_file, const Parameters &para);
+  bool compute();
+
+  // Solve with a precomputed operator, which may be shared by other solvers
+  // running concurrently. The operator must remain valid during the call.
+  bool solve(const GeodesicOperator &shared_op, const Parameters &para);
+
+  const DenseVector& get_distance_values();
+
+  // Timing, convergence and memory use of the last solve
+  const SolveMetrics& get_metrics() const;
+
+ protected:
+  typedef HeatScalarT HeatScalar;
+  typedef Eigen::Matrix<HeatScalar, Eigen::Dynamic, 1> VectorHS;
+  typedef Eigen::Matrix<HeatScalar, 3, 1> Vector3HS;
+  typedef Eigen::Matrix<HeatScalar, 3, 3> Matrix3HS;
+
+  // Views of buffers in the solver arena
+  typedef Eigen::Map<VectorHS> VectorHSBuffer;
+  typedef Eigen::Map<IndexVector> IndexVectorBuffer;
+  typedef Eigen::Map<DenseVector> VectorBuffer;
+  typedef Eigen::Map<Matrix3X> Matrix3XBuffer;
+  typedef Eigen::Map<Matrix2Xi> Matrix2XiBuffer;
+  typedef Eigen::Map<Matrix3Xi> Matrix3XiBuffer;
+
+  // Phases of the solver, which bound the lifetimes of the buffers
+  enum Phase {
+    HEAT_PHASE = 0,  // Heat flow and initial gradients
+    SETUP_PHASE = 1,  // Set-up of ADMM and of the integration
+    ADMM_PHASE = 2,
+    INTEGRATION_PHASE = 3
+  };
+
+  GeodesicOperator own_op;  // Operator built by load()
+  const GeodesicOperator *op;  // Operator used by compute()
+  double model_scaling_factor;
+
+  Parameters param;
+
+  BufferArena arena;  // Storage of the large per-solve arrays
+
+  IndexVector bfs_vertex_list;  // Non-source vertex indices stored according to their BFS order
+  IndexVector bfs_segment_addr;  // Addresses within bfs_vertex_list for the first vertex in each BFS layer
+
+  double* bfs_laplacian_weight;  // Weights of the vertices for evaluating cotan Laplacian, with the vertex of the row last
+  IndexDelta* bfs_laplacian_delta;  // The vertices, stored as offsets from the vertex of the row
+  MeshIndex* bfs_laplacian_escape;  // The vertices whose offsets do not fit in an IndexDelta
+  IndexVector bfs_laplacian_coef_addr;  // Starting addresses for the segment of each Laplacian within bfs_laplacian_weight
+  IndexVector bfs_laplacian_escape_addr;  // Starting addresses for the escaped vertices of each Laplacian
+  std::vector<MeshIndex> bfs_long_rows;  // Laplacian rows longer than kLongRowNonzeros, in increasing order
+  IndexVector bfs_row_work_addr;  // Prefix sums of the Laplacian row lengths with long rows counted as one, if there are long rows
+
+  VectorHSBuffer current_d;  // Heat values
+  VectorHSBuffer temp_d;  // New heat values of a BFS layer
+  VectorHSBuffer heatflow_residuals;
+
+  IndexVector transition_halfedge_idx;
+  IndexVectorBuffer transition_from_vtx;
+
+  Matrix3XBuffer init_grad;   // initial gradients computed from heat flow
+
+  DenseVector geod_dist_values;
+
+  MeshIndex n_vertices;         // number of vertices
+  MeshIndex n_faces;            // number of faces
+  MeshIndex n_edges;            // number of edges
+
+  int iter_num;
+  bool need_compute_residual_norms;
+
+  // Variables for primal and dual residuals
+  double primal_residual_sqr_norm, dual_residual_sqr_norm;
+  double primal_residual_sqr_norm_threshold, dual_residual_sqr_norm_threshold;
+
+  // Variables for the progress of the solver
+  bool output_progress;
+  bool optimization_converge, optimization_end;
+
+  // Storage I/O at the last progress output of an out-of-core solve
+  long long storage_read_mark, storage_written_mark;
+  int storage_iter_mark;
+
+  Formulation& formulation() {
+    return static_cast<Formulation&>(*this);
+  }
+
+  // Loop schedules of the phases, and where they come from if they are not
+  // the default static schedule
+  LoopSchedule phase_schedules[ScheduleProfile::PHASE_COUNT];
+  std::string schedule_source;
+
+  // Number of iterations of the heat solver and of ADMM in the runs for
+  // tuning the loop schedules
+  static const int kTuneHeatIterations = 10;
+  static const int kTuneADMMIterations = 20;
+
+  // Whether an own operator is kept after set-up, for the next tuning run
+  bool keep_operator;
+
+  // Record of the last solve, written to param.metrics_file, and the number
+  // of sweeps of the heat solver over the Laplacian for it
+  SolveMetrics metrics;
+  long long heat_sweeps;
+
+  // Residuals of the last solve, written to param.convergence_trace_file
+  ConvergenceTrace trace;
+
+  // Events of the last solve, written to param.event_trace_file, whether the
+  // threads record their shares of the current balanced loops, and the start
+  // of the current BFS layer (or residual check) and ADMM iteration
+  EventTrace event_trace;
+  bool trace_loop_chunks;
+  EventTrace::TimePoint layer_start, admm_iteration_start;
+
+  // Errors of the last solve against the reference distances, written to
+  // param.accuracy_trace_file, and whether ADMM stops for a sample after the
+  // current iteration
+  AccuracyTrace accuracy;
+  bool accuracy_sample_due;
+
+  // Laplacian rows with more nonzeros than this are split among the threads
+  // by the heat solver loops
+  static const int kLongRowNonzeros = 1024;
+
+  // Time spent by each thread in the balanced heat solver loops, empty if
+  // they are not used, and the partial sums of a split row
+  std::vector<double> thread_busy_seconds;
+  std::vector<HeatScalar> long_row_partial_sums;
+
+  bool check_input();
+  void release_own_operator();
+  bool map_buffers();
+  void layout_buffers();
+  void count_external_arrays();
+
+  // Tune the loop schedules or read them from the profile, as set in param
+  bool select_schedules(ScheduleScope &schedules);
+  bool tune_schedules(ScheduleScope &schedules);
+
+  // Run all phases with the loop schedules, printing the timing if asked and
+  // storing the time of the phases with tuned schedules if phase_seconds is
+  // not NULL
+  bool run_phases(ScheduleScope &schedules, bool print_timing,
+                  double *phase_seconds);
+
+  // Complete the metrics of the solve and write them, if asked
+  void record_metrics(bool success);
+
+  void init_bfs_paths();
+  void gauss_seidel_init_gradients();
+  void compute_integrable_gradients();
+  void integrate_geodesic_distance();
+
+  // Integrate the current gradients and add their error to the accuracy
+  // samples, outside of parallel regions
+  void sample_accuracy();
+
+  // Count the ADMM iteration and check convergence, in a single thread after
+  // the residual norms of the iteration are computed
+  void update_convergence();
+
+  // Gauss-Seidel update of the heat values of a BFS layer, inside a parallel
+  // region
+  void update_heat_layer(int segment, HeatScalar init_source_val);
+
+  // Initial gradient of each face from the heat values
+  void compute_init_gradients();
+
+  void compute_heatflow_residual(const VectorHSBuffer &heat_values,
+                                 HeatScalar init_source_val,
+                                 VectorHSBuffer &residuals);
+
+  // Number of threads of the balanced heat solver loops, 0 if the loops use
+  // the schedule of the heat phase instead
+  int balanced_loop_threads() const;
+
+  // Loop over the Laplacian rows [begin, end) like scheduled_parallel_for(),
+  // but with balancing each thread takes a contiguous range of rows with
+  // about the same number of nonzeros, and records its busy time
+  template<typename RowBody>
+  void balanced_row_loop(MeshIndex begin, MeshIndex end,
+                         const RowBody &row_body);
+
+  // Like above, but with balancing the long rows are split among the threads:
+  // partial_sum(i, j_begin, j_end) returns the sum over the Laplacian vertices
+  // [j_begin, j_end) of row i, and one thread calls finish_row(i, sum) with
+  // the sum of the parts
+  template<typename RowBody, typename PartialSum, typename FinishRow>
+  void balanced_row_loop(MeshIndex begin, MeshIndex end,
+                         const RowBody &row_body,
+                         const PartialSum &partial_sum,
+                         const FinishRow &finish_row);
+
+  // Rows of the calling thread in a balanced loop, skipping the long rows if
+  // asked; false if the loop is not balanced
+  template<typename RowBody>
+  bool run_balanced_rows(MeshIndex begin, MeshIndex end, bool skip_long_rows,
+                         const RowBody &row_body);
+
+  // Escaped vertices of row i from its Laplacian vertex j on
+  const MeshIndex* laplacian_escaped_from(MeshIndex i, MeshIndex j) const;
+
+  // Print the storage I/O per iteration since the last call, out of core
+  void print_storage_io(int iter);
+};
+
+// Definitions of the constants that are bound to references, e.g. by
+// std::min()
+template<typename Formulation, typename HeatScalarT>
+const int GeodesicSolverCore<Formulation, HeatScalarT>::kTuneHeatIterations;
+template<typename Formulation, typename HeatScalarT>
+const int GeodesicSolverCore<Formulation, HeatScalarT>::kTuneADMMIterations;
+
+template<typename Formulation, typename HeatScalarT>
+GeodesicSolverCore<Formulation, HeatScalarT>::GeodesicSolverCore()
+    : op(NULL),
+      model_scaling_factor(1.0),
+      bfs_laplacian_weight(NULL),
+      bfs_laplacian_delta(NULL),
+      bfs_laplacian_escape(NULL),
+      current_d(NULL, 0),
+      temp_d(NULL, 0),
+      heatflow_residuals(NULL, 0),
+      transition_from_vtx(NULL, 0),
+      init_grad(NULL, 3, 0),
+      n_vertices(0),
+      n_faces(0),
+      n_edges(0),
+      iter_num(0),
+      need_compute_residual_norms(false),
+      primal_residual_sqr_norm(0),
+      dual_residual_sqr_norm(0),
+      primal_residual_sqr_norm_threshold(0),
+      dual_residual_sqr_norm_threshold(0),
+      output_progress(false),
+      optimization_converge(false),
+      optimization_end(false),
+      storage_read_mark(0),
+      storage_written_mark(0),
+      storage_iter_mark(0),
+      keep_operator(false),
+      heat_sweeps(0),
+      trace_loop_chunks(false),
+      accuracy_sample_due(false) {
+}
+
+template<typename Formulation, typename HeatScalarT>
+const Eigen::VectorXd&
+GeodesicSolverCore<Formulation, HeatScalarT>::get_distance_values() {
+  return geod_dist_values;
+}
+
+template<typename Formulation, typename HeatScalarT>
+const SolveMetrics&
+GeodesicSolverCore<Formulation, HeatScalarT>::get_metrics() const {
+  return metrics;
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::solve(
+    const char *mesh_file, const Parameters& para) {
+  return load(mesh_file, para) && compute();
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::load(
+    const char *mesh_file, const Parameters& para) {
+  param = para;
+
+  if (param.print_progress) {
+    std::cout << "Reading triangle mesh......" << std::endl;
+  }
+
+  Timer timer;
+  Timer::EventID start = timer.get_time();
+
+  op = &own_op;
+  bool success;
+  if (param.operator_store.empty() && !param.out_of_core_directory.empty()) {
+    success = own_op.build_in_directory(mesh_file, param.out_of_core_directory);
+  } else {
+    success = own_op.build(mesh_file, param.operator_store);
+  }
+
+  Timer::EventID end = timer.get_time();
+  metrics.mesh = mesh_file;
+  SolveMetrics::Phase &load_metrics = metrics.phases[SolveMetrics::LOAD];
+  load_metrics = SolveMetrics::Phase(load_metrics.name);
+  load_metrics.wall_seconds = timer.elapsed_time(start, end);
+  load_metrics.cpu_seconds = timer.elapsed_cpu_time(start, end);
+  load_metrics.n_threads = 1;
+  PerfCounters::Sample sample = PerfCounters().sample();
+  load_metrics.resident_bytes = sample.resident_bytes;
+  load_metrics.peak_resident_bytes = sample.peak_resident_bytes;
+
+  if (!success) {
+    metrics.reset();
+    record_metrics(false);
+  }
+  return success;
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::solve(
+    const GeodesicOperator &shared_op, const Parameters& para) {
+  param = para;
+  op = &shared_op;
+  metrics.mesh.clear();
+  metrics.phases[SolveMetrics::LOAD] = SolveMetrics::Phase(
+      metrics.phases[SolveMetrics::LOAD].name);
+  return compute();
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::compute() {
+  metrics.reset();
+  if (!check_input()) {
+    record_metrics(false);
+    return false;
+  }
+  metrics.n_vertices = n_vertices;
+  metrics.n_faces = n_faces;
+  metrics.n_edges = n_edges;
+  if (!param.accuracy_trace_file.empty()
+      && !accuracy.load_reference(param.accuracy_reference_file, n_vertices)) {
+    record_metrics(false);
+    return false;
+  }
+
+  // Small meshes are solved by this thread alone, and only the timing is
+  // printed at the end, since starting and synchronizing threads and console
+  // output would take longer than the solve
+  bool small_mesh = n_vertices < param.small_mesh_vertices;
+  bool print_timing = param.print_progress;
+  bool numa_first_touch = param.numa_first_touch;
+  if (small_mesh) {
+    param.print_progress = false;
+    param.numa_first_touch = false;
+  }
+  SerialScope serial(small_mesh);
+
+  // Loop schedules of the phases, tuned on this mesh or from the profile
+  ScheduleScope schedules;
+  for (int i = 0; i < ScheduleProfile::PHASE_COUNT; ++i) {
+    phase_schedules[i] = LoopSchedule();
+  }
+  schedule_source.clear();
+
+  bool success = (small_mesh || select_schedules(schedules))
+      && run_phases(schedules, print_timing, NULL);
+  metrics.n_threads = available_threads();
+  if (!param.convergence_trace_file.empty()) {
+    trace.append(param.convergence_trace_file, metrics.mesh);
+  }
+  if (!param.event_trace_file.empty()) {
+    event_trace.append(param.event_trace_file, metrics.mesh);
+  }
+  if (success && accuracy.enabled()) {
+    accuracy.append(param.accuracy_trace_file, metrics.mesh, param,
+                    metrics.n_threads);
+  }
+
+  param.print_progress = print_timing;
+  param.numa_first_touch = numa_first_touch;
+  record_metrics(success);
+  return success;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::record_metrics(
+    bool success) {
+  if (param.metrics_file.empty()) {
+    return;
+  }
+
+  metrics.success = success;
+  metrics.solver_type = param.solver_type;
+  metrics.append(param.metrics_file);
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::select_schedules(
+    ScheduleScope &schedules) {
+  if (!param.autotune && param.schedule_profile.empty()) {
+    return true;
+  }
+
+  if (!ScheduleScope::supported()) {
+    if (param.print_progress) {
+      std::cout << "Loop schedules are only set with the OpenMP backend"
+                << std::endl;
+    }
+    return true;
+  }
+
+  // First-touch placement relies on the same static partition in all phases
+  if (param.numa_first_touch) {
+    if (param.print_progress) {
+      std::cout << "Loop schedules are not tuned with NumaFirstTouch"
+                << std::endl;
+    }
+    return true;
+  }
+
+  ScheduleProfile profile;
+  int bucket = ScheduleProfile::size_bucket(n_vertices);
+  if (!param.schedule_profile.empty()
+      && !profile.load(param.schedule_profile)) {
+    return false;
+  }
+
+  if (!param.autotune) {
+    if (profile.find(param.solver_type, bucket, phase_schedules)) {
+      schedule_source = "from " + param.schedule_profile;
+    }
+    return true;
+  }
+
+  if (!tune_schedules(schedules)) {
+    return false;
+  }
+  schedule_source = "tuned on this mesh";
+
+  if (!param.schedule_profile.empty()) {
+    profile.set(param.solver_type, bucket, phase_schedules);
+    if (!profile.save(param.schedule_profile)) {
+      std::cerr << "Warning: tuned loop schedules not saved" << std::endl;
+    }
+  }
+
+  return true;
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::tune_schedules(
+    ScheduleScope &schedules) {
+  // Candidates with doubling numbers of threads, up to all threads
+  std::vector<LoopSchedule> candidates;
+  int max_threads = schedules.max_threads();
+  for (int n = 1;; n *= 2) {
+    n = std::min(n, max_threads);
+    candidates.push_back(LoopSchedule(n, LoopSchedule::STATIC, 0));
+    candidates.push_back(LoopSchedule(n, LoopSchedule::DYNAMIC, 64));
+    candidates.push_back(LoopSchedule(n, LoopSchedule::DYNAMIC, 512));
+    candidates.push_back(LoopSchedule(n, LoopSchedule::GUIDED, 64));
+    if (n == max_threads) {
+      break;
+    }
+  }
+
+  if (param.print_progress) {
+    std::cout << "Tuning loop schedules with " << candidates.size()
+              << " short runs......" << std::endl;
+  }
+
+  // Run a few iterations of each phase with each candidate, and keep the
+  // fastest candidate of each phase
+  Parameters saved_param = param;
+  param.print_progress = false;
+  param.accuracy_trace_file.clear();
+  param.heat_solver_max_iter = std::min(param.heat_solver_max_iter,
+                                        kTuneHeatIterations);
+  param.grad_solver_max_iter = std::min(param.grad_solver_max_iter,
+                                        kTuneADMMIterations);
+  keep_operator = true;
+
+  double best_seconds[ScheduleProfile::PHASE_COUNT];
+  LoopSchedule best_schedules[ScheduleProfile::PHASE_COUNT];
+  for (int i = 0; i < ScheduleProfile::PHASE_COUNT; ++i) {
+    best_seconds[i] = std::numeric_limits<double>::max();
+  }
+
+  bool success = true;
+  for (int k = 0; k < static_cast<int>(candidates.size()) && success; ++k) {
+    for (int i = 0; i < ScheduleProfile::PHASE_COUNT; ++i) {
+      phase_schedules[i] = candidates[k];
+    }
+
+    double seconds[ScheduleProfile::PHASE_COUNT];
+    success = run_phases(schedules, false, seconds);
+    for (int i = 0; i < ScheduleProfile::PHASE_COUNT && success; ++i) {
+      if (seconds[i] < best_seconds[i]) {
+        best_seconds[i] = seconds[i];
+        best_schedules[i] = candidates[k];
+      }
+    }
+  }
+
+  param = saved_param;
+  keep_operator = false;
+  for (int i = 0; i < ScheduleProfile::PHASE_COUNT; ++i) {
+    phase_schedules[i] = best_schedules[i];
+  }
+
+  return success;
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::run_phases(
+    ScheduleScope &schedules, bool print_timing, double *phase_seconds) {
+  if (param.print_progress) {
+    std::cout << "Initialize BFS path......" << std::endl;
+  }
+
+  if (param.numa_first_touch) {
+    NumaPlacement::prepare_first_touch();
+  }
+
+  // Page faults and hardware events of each phase, reported with the timing
+  // and in the metrics, and the resident memory at the end of each phase
+  PerfCounters counters;
+  std::vector<PerfCounters::Sample> counter_samples;
+  PerfCounters::Sample setup_sample = PerfCounters::Sample();
+  bool sample_counters = param.print_progress || !param.metrics_file.empty();
+  bool per_thread_counters = param.hardware_counters > 1;
+  if (param.print_progress || param.hardware_counters > 0) {
+    counters.open(param.hardware_counters > 0);
+  }
+  if (sample_counters) {
+    counter_samples.push_back(counters.sample(per_thread_counters));
+  }
+
+  trace.start(param.convergence_trace_file.empty() ?
+                  0 : param.convergence_trace_capacity);
+  event_trace.start(
+      param.event_trace_file.empty() ? 0 : param.event_trace_capacity,
+      std::max(schedules.max_threads(), available_threads()),
+      param.event_trace_layer_sampling);
+  accuracy.start(!param.accuracy_trace_file.empty());
+
+  Timer timer;
+  Timer::EventID start = timer.get_time();
+  EventTrace::TimePoint phase_start = EventTrace::now();
+
+  // Precompute breadth-first propagation order
+  init_bfs_paths();
+  if (!map_buffers()) {
+    return false;
+  }
+
+  if (param.print_progress) {
+    std::cout << "Gauss-Seidel initilization of gradients......" << std::endl;
+  }
+
+  Timer::EventID before_GS = timer.get_time();
+  event_trace.add("bfs", EventTrace::PHASE, phase_start);
+  phase_start = EventTrace::now();
+  if (sample_counters) {
+    counter_samples.push_back(counters.sample(per_thread_counters));
+  }
+
+  schedules.apply(phase_schedules[HEAT_PHASE]);
+  gauss_seidel_init_gradients();
+
+  // The Laplacian addresses are only used by the heat solver
+  MeshIndex n_escaped_laplacian_vertices = bfs_laplacian_escape_addr(n_vertices);
+  MeshIndex n_long_rows = bfs_long_rows.size();
+  bfs_laplacian_coef_addr.resize(0);
+  bfs_laplacian_escape_addr.resize(0);
+  bfs_long_rows.clear();
+  bfs_row_work_addr.resize(0);
+  arena.retire(HEAT_PHASE);
+
+  Timer::EventID before_ADMM = timer.get_time();
+  event_trace.add("heat", EventTrace::PHASE, phase_start);
+  phase_start = EventTrace::now();
+  if (sample_counters) {
+    counter_samples.push_back(counters.sample(per_thread_counters));
+  }
+  if (param.print_progress) {
+    std::cout << "ADMM solver for integrable gradients......" << std::endl;
+  }
+
+  // Buffers of the next phases can reuse the pages of earlier ones; return
+  // them so that they are placed by the threads that initialize them
+  if (param.numa_first_touch) {
+    arena.discard(SETUP_PHASE);
+  }
+
+  schedules.apply(phase_schedules[SETUP_PHASE]);
+  formulation().prepare_integrate_geodesic_distance();
+
+  // The operator and the transition halfedges are not used after set-up,
+  // except by the next runs when tuning the loop schedules. They are released
+  // before the ADMM variables are first written, which then take the pages
+  // of the set-up arrays.
+  if (!keep_operator) {
+    release_own_operator();
+  }
+  transition_halfedge_idx.resize(0);
+  arena.retire(SETUP_PHASE);
+  if (param.numa_first_touch) {
+    arena.discard(ADMM_PHASE);
+  }
+  formulation().init_admm_variables();
+
+  // Out of core, the ADMM loops sweep over their arrays in order
+  formulation().stream_admm_buffers();
+
+  // Placement of the ADMM variables, which carry most of the memory traffic
+  NumaPlacement::Report placement;
+  bool report_placement = param.print_progress
+      && (param.numa_first_touch || NumaPlacement::n_nodes() > 1);
+  if (report_placement) {
+    placement.add_threads();
+    formulation().add_admm_placement(placement);
+  }
+
+  Timer::EventID after_setup = timer.get_time();
+  event_trace.add("setup", EventTrace::PHASE, phase_start);
+  phase_start = EventTrace::now();
+  if (sample_counters) {
+    setup_sample = counters.sample(per_thread_counters);
+  }
+  schedules.apply(phase_schedules[ADMM_PHASE]);
+  compute_integrable_gradients();
+  arena.retire(ADMM_PHASE);
+
+  Timer::EventID after_ADMM = timer.get_time();
+  event_trace.add("admm", EventTrace::PHASE, phase_start);
+  phase_start = EventTrace::now();
+  if (sample_counters) {
+    counter_samples.push_back(counters.sample(per_thread_counters));
+  }
+  if (param.print_progress) {
+    std::cout << "Recovery of geodesic distance......" << std::endl;
+  }
+
+  schedules.apply(phase_schedules[INTEGRATION_PHASE]);
+  if (accuracy.enabled()) {
+    accuracy.begin_sample();
+  }
+  integrate_geodesic_distance();
+
+  Timer::EventID end = timer.get_time();
+  event_trace.add("integration", EventTrace::PHASE, phase_start);
+  if (accuracy.enabled()) {
+    accuracy.add(iter_num, geod_dist_values, param.source_vertices);
+  }
+  if (sample_counters) {
+    counter_samples.push_back(counters.sample(per_thread_counters));
+  }
+
+  // Metrics of the phases, with the samples taken at their ends
+  Timer::EventID phase_events[SolveMetrics::PHASE_COUNT] = { start, start,
+      before_GS, before_ADMM, after_setup, after_ADMM };
+  const PerfCounters::Sample *phase_samples[SolveMetrics::PHASE_COUNT] = {
+      NULL, NULL, NULL, &setup_sample, NULL, NULL };
+  const PerfCounters::Sample *phase_start_samples[SolveMetrics::PHASE_COUNT] =
+      { NULL, NULL, NULL, NULL, &setup_sample, NULL };
+  if (sample_counters) {
+    phase_samples[SolveMetrics::BFS] = &counter_samples[1];
+    phase_samples[SolveMetrics::HEAT] = &counter_samples[2];
+    phase_samples[SolveMetrics::ADMM] = &counter_samples[3];
+    phase_samples[SolveMetrics::INTEGRATION] = &counter_samples[4];
+    phase_start_samples[SolveMetrics::BFS] = &counter_samples[0];
+    phase_start_samples[SolveMetrics::HEAT] = &counter_samples[1];
+    phase_start_samples[SolveMetrics::SETUP] = &counter_samples[2];
+    phase_start_samples[SolveMetrics::INTEGRATION] = &counter_samples[3];
+  }
+  if (per_thread_counters) {
+    metrics.thread_ids = counters.thread_ids();
+  }
+  int n_threads = available_threads();
+  for (int i = SolveMetrics::BFS; i < SolveMetrics::PHASE_COUNT; ++i) {
+    SolveMetrics::Phase &phase = metrics.phases[i];
+    Timer::EventID phase_end =
+        (i + 1 < SolveMetrics::PHASE_COUNT) ? phase_events[i + 1] : end;
+    phase.wall_seconds = timer.elapsed_time(phase_events[i], phase_end);
+    phase.cpu_seconds = timer.elapsed_cpu_time(phase_events[i], phase_end);
+    if (phase_samples[i]) {
+      phase.resident_bytes = phase_samples[i]->resident_bytes;
+      phase.peak_resident_bytes = phase_samples[i]->peak_resident_bytes;
+    }
+    if (phase_samples[i] && phase_start_samples[i]) {
+      phase.set_events(*phase_start_samples[i], *phase_samples[i]);
+    }
+
+    // The solver phases, after the serial set-up of the BFS paths
+    int solver_phase = i - SolveMetrics::HEAT;
+    if (solver_phase < 0) {
+      phase.n_threads = 1;
+      continue;
+    }
+    int phase_threads = phase_schedules[solver_phase].n_threads;
+    phase.n_threads =
+        (phase_threads > 0 && phase_threads < n_threads) ?
+            phase_threads : n_threads;
+    phase.buffer_bytes = arena.live_bytes(solver_phase);
+    phase.sweeps = 1;
+  }
+  metrics.phases[SolveMetrics::HEAT].sweeps = heat_sweeps;
+  metrics.phases[SolveMetrics::ADMM].sweeps = iter_num;
+  metrics.buffer_bytes = arena.capacity();
+  metrics.admm_iterations = iter_num;
+  metrics.primal_residual = std::sqrt(primal_residual_sqr_norm);
+  metrics.dual_residual = std::sqrt(dual_residual_sqr_norm);
+  metrics.admm_converged = optimization_converge;
+
+  if (phase_seconds) {
+    phase_seconds[HEAT_PHASE] = timer.elapsed_time(before_GS, before_ADMM);
+    phase_seconds[SETUP_PHASE] = timer.elapsed_time(before_ADMM, after_setup);
+    phase_seconds[ADMM_PHASE] = timer.elapsed_time(after_setup, after_ADMM);
+    phase_seconds[INTEGRATION_PHASE] = timer.elapsed_time(after_ADMM, end);
+  }
+
+  if (print_timing) {
+    std::cout << std::endl;
+    std::cout << "====== Timing ======" << std::endl;
+    if (!schedule_source.empty()) {
+      std::cout << "Loop schedules " << schedule_source << ":";
+      for (int i = 0; i < ScheduleProfile::PHASE_COUNT; ++i) {
+        const LoopSchedule &schedule = phase_schedules[i];
+        std::cout << (i > 0 ? ", " : " ") << ScheduleProfile::phase_name(i)
+                  << " " << schedule.n_threads
+                  << (schedule.n_threads == 1 ? " thread " : " threads ")
+                  << LoopSchedule::kind_name(schedule.kind);
+        if (schedule.chunk_size > 0) {
+          std::cout << " " << schedule.chunk_size;
+        }
+      }
+      std::cout << std::endl;
+    }
+    std::cout << "Pre-computation of BFS paths: "
+              << timer.elapsed_time(start, before_GS) << " seconds"
+              << std::endl;
+    std::cout << "Gauss-Seidel initialization of gradients: "
+              << timer.elapsed_time(before_GS, before_ADMM) << " seconds"
+              << std::endl;
+    if (!thread_busy_seconds.empty()) {
+      // Time of each thread in the balanced heat solver loops, whose
+      // maximum over the mean shows the load imbalance
+      double total_busy = 0, max_busy = 0;
+      std::cout << "Busy time of the threads in the heat solver loops:";
+      for (size_t t = 0; t < thread_busy_seconds.size(); ++t) {
+        std::cout << " " << thread_busy_seconds[t];
+        total_busy += thread_busy_seconds[t];
+        max_busy = std::max(max_busy, thread_busy_seconds[t]);
+      }
+      std::cout << " seconds";
+      if (total_busy > 0) {
+        std::cout << " (maximum over mean "
+                  << max_busy * thread_busy_seconds.size() / total_busy << ")";
+      }
+      std::cout << std::endl;
+      if (n_long_rows > 0) {
+        std::cout << "Laplacian rows longer than " << kLongRowNonzeros
+                  << " split among the threads: " << n_long_rows << std::endl;
+      }
+    }
+    std::cout << "ADMM solver for integrable gradients: "
+              << timer.elapsed_time(before_ADMM, after_ADMM) << " seconds"
+              << std::endl;
+    std::cout << "Integration of gradients: "
+              << timer.elapsed_time(after_ADMM, end) << " seconds" << std::endl;
+    std::cout << "Total time: " << timer.elapsed_time(start, end) << " seconds"
+              << std::endl;
+
+    std::cout << "====== Memory ======" << std::endl;
+    std::cout << "Solver buffers: " << arena.capacity() << " bytes ("
+              << arena.unshared_size() << " bytes without reuse between phases), ";
+    if (arena.file_backed()) {
+      std::cout << "mapped from a file in " << param.out_of_core_directory
+                << std::endl;
+    } else {
+      std::cout << BufferArena::page_mode_name(arena.page_mode()) << std::endl;
+    }
+    std::cout << "Planned peak with the mesh operator and the BFS arrays: "
+              << arena.peak_bytes() << " bytes" << std::endl;
+    MeshIndex n_laplacian_vertices = n_edges * 2 + n_vertices;
+    std::cout << "Laplacian vertices stored as 16-bit offsets: "
+              << n_laplacian_vertices - n_escaped_laplacian_vertices << " of "
+              << n_laplacian_vertices << std::endl;
+    formulation().print_admm_memory();
+    std::vector<const char*> phase_names;
+    phase_names.push_back("Pre-computation of BFS paths");
+    phase_names.push_back("Gauss-Seidel initialization of gradients");
+    phase_names.push_back("ADMM solver for integrable gradients");
+    phase_names.push_back("Integration of gradients");
+    if (param.print_progress) {
+      PerfCounters::print(phase_names, counter_samples);
+    }
+
+    if (report_placement) {
+      placement.print();
+    }
+  }
+
+  return true;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::init_bfs_paths() {
+  bfs_vertex_list.resize(n_vertices);
+  bfs_vertex_list.fill(-1);
+  transition_halfedge_idx.setConstant(n_vertices, -1);
+
+  bfs_laplacian_coef_addr.resize(n_vertices + 1);
+  bfs_laplacian_coef_addr(0) = 0;
+
+  // Store source vertices as the first layer
+  std::vector<bool> visited(n_vertices, false);
+  std::vector<MeshIndex> front1 = param.source_vertices, front2;
+  std::vector<MeshIndex> *current_front = &front1, *next_front = &front2;
+
+  int n_sources = param.source_vertices.size();
+
+  std::vector<MeshIndex> bfs_segment_addr_vec;
+  bfs_segment_addr_vec.push_back(0);
+  bfs_segment_addr_vec.push_back(n_sources);
+
+  MeshIndex id = 0;
+  for (; id < n_sources; ++id) {
+    MeshIndex current_source_vtx = param.source_vertices[id];
+    visited[current_source_vtx] = true;
+    bfs_vertex_list(id) = current_source_vtx;
+    bfs_laplacian_coef_addr(id + 1) = bfs_laplacian_coef_addr(id)
+        + op->valence(current_source_vtx) + 1;
+  }
+
+  while (!current_front->empty()) {
+
+    next_front->clear();
+
+    for (MeshIndex k = 0; k < static_cast<MeshIndex>(current_front->size()); ++k) {
+      MeshIndex v = current_front->at(k);
+      MeshIndex he_begin_addr = op->vertex_halfedge_addr(v);
+      MeshIndex he_end_addr = op->vertex_halfedge_addr(v + 1);
+
+      for (MeshIndex j = he_begin_addr; j < he_end_addr; ++j) {
+        MeshIndex heh = op->vertex_halfedges(j);
+        MeshIndex next_v = op->halfedge_to_vertex(heh);
+
+        if (!visited[next_v]) {
+          next_front->push_back(next_v);
+          bfs_vertex_list(id) = next_v;
+          // Each segment stores the weights for neighbors and the current vertex for GS update
+          bfs_laplacian_coef_addr(id + 1) = bfs_laplacian_coef_addr(id)
+              + op->valence(next_v) + 1;
+          transition_halfedge_idx(id) = heh;
+          id++;
+        }
+
+        visited[next_v] = true;
+      }
+    }
+
+    bfs_segment_addr_vec.push_back(
+        bfs_segment_addr_vec.back() + next_front->size());
+    std::swap(current_front, next_front);
+  }
+
+  bfs_segment_addr = Eigen::Map < IndexVector
+      > (bfs_segment_addr_vec.data(), bfs_segment_addr_vec.size());
+
+  // Count the Laplacian vertices too far from the vertex of their row to be
+  // stored as offsets
+  bfs_laplacian_escape_addr.resize(n_vertices + 1);
+  bfs_laplacian_escape_addr(0) = 0;
+  for (MeshIndex i = 0; i < n_vertices; ++i) {
+    MeshIndex v = bfs_vertex_list(i);
+    MeshIndex n_escaped = 0;
+    for (MeshIndex j = op->vertex_halfedge_addr(v);
+        j < op->vertex_halfedge_addr(v + 1); ++j) {
+      if (!index_delta_fits(op->halfedge_to_vertex(op->vertex_halfedges(j)),
+                            v)) {
+        n_escaped++;
+      }
+    }
+    bfs_laplacian_escape_addr(i + 1) = bfs_laplacian_escape_addr(i)
+        + n_escaped;
+  }
+
+  // Rows of fan vertices are split among the threads by the heat solver,
+  // so they count as one row when the other rows are balanced
+  bfs_long_rows.clear();
+  for (MeshIndex i = 0; i < n_vertices; ++i) {
+    if (bfs_laplacian_coef_addr(i + 1) - bfs_laplacian_coef_addr(i)
+        > kLongRowNonzeros) {
+      bfs_long_rows.push_back(i);
+    }
+  }
+
+  bfs_row_work_addr.resize(0);
+  if (!bfs_long_rows.empty()) {
+    bfs_row_work_addr.resize(n_vertices + 1);
+    bfs_row_work_addr(0) = 0;
+    for (MeshIndex i = 0; i < n_vertices; ++i) {
+      MeshIndex n = bfs_laplacian_coef_addr(i + 1) - bfs_laplacian_coef_addr(i);
+      bfs_row_work_addr(i + 1) = bfs_row_work_addr(i)
+          + (n > kLongRowNonzeros ? 1 : n);
+    }
+  }
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::check_input() {
+  if (op == NULL || op->empty()) {
+    std::cerr << "Error: no mesh loaded for the solver" << std::endl;
+    return false;
+  }
+
+  n_vertices = op->n_vertices;
+  n_faces = op->n_faces;
+  n_edges = op->n_edges;
+  model_scaling_factor = op->model_scaling_factor;
+
+  for (int i = 0; i < static_cast<int>(param.source_vertices.size()); ++i) {
+    if (param.source_vertices[i] < 0
+        || param.source_vertices[i] >= n_vertices) {
+      std::cerr << "Error: invalid source vertex index "
+                << param.source_vertices[i] << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::release_own_operator() {
+  // A shared operator is left untouched for other queries
+  if (op == &own_op) {
+    own_op.clear();
+  }
+
+  op = NULL;
+}
+
+template<typename Formulation, typename HeatScalarT>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::map_buffers() {
+  formulation().prepare_layout();
+
+  // Plan the buffers with S * G (or S * X) stored, and fall back to gathering
+  // it from G (or X)
+  // if they do not fit in the memory budget
+  size_t budget = param.max_memory_bytes;
+  size_t region_size = 0;
+  for (int variant = 0; variant < 2; ++variant) {
+    formulation().select_admm_variant(variant == 0);
+    arena.begin_layout();
+    layout_buffers();
+    count_external_arrays();
+    region_size = arena.plan_layout();
+    if (budget == 0 || arena.peak_bytes() <= budget) {
+      break;
+    }
+  }
+
+  // Out of core, the budget only selects the variant with less I/O
+  bool out_of_core = !param.out_of_core_directory.empty();
+  if (budget > 0 && arena.peak_bytes() > budget && !out_of_core) {
+    std::cerr << "Error: solver needs " << arena.peak_bytes()
+              << " bytes, more than MaxMemoryBytes; set OutOfCoreDirectory"
+              << " to keep its buffers in a file" << std::endl;
+    return false;
+  }
+
+  bool reserved =
+      out_of_core ?
+          arena.reserve_file(region_size, param.out_of_core_directory) :
+          arena.reserve(region_size, param.huge_pages);
+  if (!reserved) {
+    return false;
+  }
+
+  layout_buffers();
+  return true;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::count_external_arrays() {
+  // The operator is released after set-up unless it is shared or kept for
+  // the next runs
+  bool release_op = (op == &own_op && !keep_operator);
+  arena.count_external(op->storage_bytes(), HEAT_PHASE,
+                       release_op ? SETUP_PHASE : INTEGRATION_PHASE);
+
+  arena.count_external(
+      sizeof(MeshIndex)
+          * (bfs_vertex_list.size() + bfs_segment_addr.size()),
+      HEAT_PHASE, INTEGRATION_PHASE);
+  arena.count_external(
+      sizeof(MeshIndex)
+          * (bfs_laplacian_coef_addr.size()
+              + bfs_laplacian_escape_addr.size() + bfs_row_work_addr.size()),
+      HEAT_PHASE, HEAT_PHASE);
+  arena.count_external(sizeof(MeshIndex) * transition_halfedge_idx.size(),
+                       HEAT_PHASE, SETUP_PHASE);
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::layout_buffers() {
+  MeshIndex n_segments = bfs_segment_addr.size() - 1;
+  MeshIndex buffer_size = (Eigen::Map < IndexVector
+      > (&(bfs_segment_addr[1]), n_segments) - Eigen::Map < IndexVector
+      > (&(bfs_segment_addr[0]), n_segments)).maxCoeff();
+  MeshIndex n_laplacian_vertices = n_edges * 2 + n_vertices;
+
+  bfs_laplacian_weight = arena.allocate<double>(n_laplacian_vertices,
+                                                HEAT_PHASE, HEAT_PHASE);
+  bfs_laplacian_delta = arena.allocate<IndexDelta>(n_laplacian_vertices,
+                                                   HEAT_PHASE, HEAT_PHASE);
+  bfs_laplacian_escape = arena.allocate<MeshIndex>(
+      bfs_laplacian_escape_addr(n_vertices), HEAT_PHASE, HEAT_PHASE);
+  arena.map(current_d, n_vertices, HEAT_PHASE, HEAT_PHASE);
+  arena.map(temp_d, buffer_size, HEAT_PHASE, HEAT_PHASE);
+  arena.map(heatflow_residuals, n_vertices, HEAT_PHASE, HEAT_PHASE);
+  arena.map(init_grad, 3, n_faces, HEAT_PHASE,
+            Formulation::init_grad_last_phase);
+  arena.map(transition_from_vtx, n_vertices, SETUP_PHASE, INTEGRATION_PHASE);
+
+  formulation().layout_admm_buffers();
+}
+
+template<typename Formulation, typename HeatScalarT>
+void
+GeodesicSolverCore<Formulation, HeatScalarT>::gauss_seidel_init_gradients() {
+  double step_length = op->heat_step_length;
+  HeatScalar init_source_val = 1;
+  int gs_iter = 0;
+  int segment_count = 0;
+  MeshIndex n_segments = 0;
+  bool end_gs_loop = false;
+  bool reset_iter = true;
+  bool need_check_residual = false;
+  HeatScalar eps = 0;
+  storage_iter_mark = 0;
+  print_storage_io(0);
+
+  heat_sweeps = 0;
+  metrics.heat_converged = false;
+  thread_busy_seconds.assign(balanced_loop_threads(), 0.0);
+  long_row_partial_sums.assign(thread_busy_seconds.size(), HeatScalar(0));
+  trace_loop_chunks = event_trace.enabled();
+
+  OMP_PARALLEL
+  {
+    // The Laplacian coefficient buffer is uninitialized; each entry is
+    // constructed by the thread that computes it, which also places its page
+    // with first-touch placement
+    SCHEDULED_PARALLEL_FOR(MeshIndex, i, 0, n_vertices) {
+      // Compute and store vertex indices and weights for Laplacian operators
+      MeshIndex start_addr = bfs_laplacian_coef_addr(i), end_addr =
+          bfs_laplacian_coef_addr(i + 1);
+
+      DenseVector weights;
+      IndexVector vtx_idx;
+      MeshIndex n = end_addr - start_addr;
+      weights.setZero(n);
+      vtx_idx.setZero(n);
+
+      MeshIndex v_idx = bfs_vertex_list(i);
+      int k = 0;
+      for (MeshIndex j = op->vertex_halfedge_addr(v_idx);
+          j < op->vertex_halfedge_addr(v_idx + 1); ++j) {
+        MeshIndex heh = op->vertex_halfedges(j);
+        vtx_idx(k) = op->halfedge_to_vertex(heh);
+        weights(k) = op->edge_laplacian_weight(heh >> 1);
+        k++;
+      }
+
+      vtx_idx(k) = v_idx;
+      weights(k) = weights.head(k).sum();  // Store the sum of neighbor weights, to be used for Gauss-Seidel update
+      weights *= step_length;
+      weights(k) += op->vertex_area(v_idx);
+
+      MeshIndex *escaped = bfs_laplacian_escape + bfs_laplacian_escape_addr(i);
+      for (MeshIndex j = start_addr; j < end_addr; ++j) {
+        bfs_laplacian_weight[j] = weights(j - start_addr);
+        bfs_laplacian_delta[j] = encode_index_delta(vtx_idx(j - start_addr),
+                                                    v_idx, escaped);
+      }
+    } PARALLEL_FOR_END
+
+    // Zero the heat values and residuals with the partition of the residual
+    // loop, so that their pages are placed near the threads using them
+    if (param.numa_first_touch) {
+      balanced_row_loop(0, n_vertices, [&](MeshIndex i) {
+        current_d(i) = 0;
+        heatflow_residuals(i) = 0;
+      });
+    }
+
+    OMP_SINGLE
+    {
+      // Set up heat value arrays
+      int n_sources = param.source_vertices.size();
+      HeatScalar total_source_area = 0;
+      for (int i = 0; i < n_sources; ++i) {
+        total_source_area += op->vertex_area(param.source_vertices[i]);
+      }
+      init_source_val = std::sqrt(
+          std::min(HeatScalar(n_vertices) / HeatScalar(n_sources),
+                   op->vertex_area.cast<HeatScalar>().sum() / total_source_area));
+
+      if (!param.numa_first_touch) {
+        current_d.setZero();
+      }
+      for (int i = 0; i < n_sources; ++i) {
+        current_d(param.source_vertices[i]) = init_source_val;
+      }
+
+      n_segments = bfs_segment_addr.size() - 1;
+      temp_d.setZero();
+
+      if (!param.numa_first_touch) {
+        heatflow_residuals.setZero();
+      }
+      layer_start = EventTrace::now();
+    }
+
+    compute_heatflow_residual(current_d, init_source_val, heatflow_residuals);
+
+    OMP_SINGLE
+    {
+      // Rescale heat source values to make the initial residual norm close to 1
+      HeatScalar init_residual_norm = heatflow_residuals.norm();
+      eps = std::max(HeatScalar(1e-16),
+                     init_residual_norm * HeatScalar(param.heat_solver_eps));
+      heat_sweeps++;
+      metrics.heat_residual = double(init_residual_norm);
+      metrics.heat_threshold = double(eps);
+      event_trace.add("heat residual", EventTrace::ITERATION, layer_start, 0);
+      trace.add(ConvergenceTrace::HEAT, 0, double(init_residual_norm), -1, -1,
+                -1);
+      if (param.print_progress) {
+        std::cout << "Initial residual: " << init_residual_norm
+                  << ", threshold: " << eps << std::endl;
+      }
+    }
+
+  }
+
+  while (!end_gs_loop) {
+
+    OMP_PARALLEL
+    {
+      // Gauss-Seidel update of heat values in breadth-first order
+      OMP_SINGLE
+      {
+        trace_loop_chunks = event_trace.sampled(
+            (long long) gs_iter * n_segments + segment_count);
+        if (trace_loop_chunks) {
+          layer_start = EventTrace::now();
+        }
+
+        // Out of core, read the coefficients of the next layer in the
+        // background while this layer is updated
+        if (arena.file_backed()) {
+          int next_segment = (segment_count + 1) % n_segments;
+          MeshIndex next_begin = bfs_laplacian_coef_addr(
+              bfs_segment_addr(next_segment));
+          MeshIndex next_end = bfs_laplacian_coef_addr(
+              bfs_segment_addr(next_segment + 1));
+          arena.prefetch(bfs_laplacian_weight + next_begin,
+                         (next_end - next_begin) * sizeof(double));
+          arena.prefetch(bfs_laplacian_delta + next_begin,
+                         (next_end - next_begin) * sizeof(IndexDelta));
+        }
+      }
+
+      update_heat_layer(segment_count, init_source_val);
+
+      OMP_SINGLE
+      {
+        if (trace_loop_chunks) {
+          event_trace.add("heat layer", EventTrace::LAYER, layer_start,
+                          gs_iter, segment_count);
+        }
+
+        segment_count++;
+        reset_iter = (segment_count == n_segments);
+        if (reset_iter) {
+          gs_iter++;
+          heat_sweeps++;
+          segment_count = 0;
+        }
+
+        end_gs_loop = gs_iter >= param.heat_solver_max_iter;
+        need_check_residual =
+            end_gs_loop
+                || (reset_iter
+                    && (gs_iter % param.heat_solver_convergence_check_frequency
+                        == 0));
+        trace_loop_chunks = need_check_residual && event_trace.enabled();
+        if (trace_loop_chunks) {
+          layer_start = EventTrace::now();
+        }
+      }
+
+      if (need_check_residual) {
+        compute_heatflow_residual(current_d, init_source_val,
+                                  heatflow_residuals);
+
+        OMP_SINGLE
+        {
+          HeatScalar residual_norm = heatflow_residuals.norm();
+          heat_sweeps++;
+          metrics.heat_residual = double(residual_norm);
+          event_trace.add("heat residual", EventTrace::ITERATION, layer_start,
+                          gs_iter);
+          trace.add(ConvergenceTrace::HEAT, gs_iter, double(residual_norm), -1,
+                    -1, -1);
+          if (param.print_progress) {
+            std::cout << "Gauss-Seidel iteration " << gs_iter
+                      << ", current residual: " << residual_norm
+                      << ", threshold: " << eps << std::endl;
+            print_storage_io(gs_iter);
+          }
+
+          if (residual_norm <= eps) {
+            end_gs_loop = true;
+            metrics.heat_converged = true;
+          }
+        }
+      }
+    }
+  }
+
+  metrics.heat_iterations = gs_iter;
+  compute_init_gradients();
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::update_heat_layer(
+    int segment, HeatScalar init_source_val) {
+  MeshIndex layer_begin = bfs_segment_addr(segment);
+  MeshIndex layer_end = bfs_segment_addr(segment + 1);
+
+  balanced_row_loop(layer_begin, layer_end, [&](MeshIndex i) {
+    MeshIndex lap_coef_begin_addr = bfs_laplacian_coef_addr(i);
+    MeshIndex lap_coef_end_addr = bfs_laplacian_coef_addr(i + 1);
+
+    HeatScalar new_heat_value = 0;
+    if (segment == 0) {  // Check whether the current vertex is a source
+      new_heat_value += init_source_val;
+    }
+
+    MeshIndex v = bfs_vertex_list(i);
+    const MeshIndex *escaped = bfs_laplacian_escape
+        + bfs_laplacian_escape_addr(i);
+    for (MeshIndex j = lap_coef_begin_addr; j < lap_coef_end_addr - 1; ++j) {
+      MeshIndex u = decode_index_delta(bfs_laplacian_delta[j], v, escaped);
+      new_heat_value += current_d(u) * bfs_laplacian_weight[j];
+    }
+
+    temp_d(i - layer_begin) = new_heat_value
+        / bfs_laplacian_weight[lap_coef_end_addr - 1];
+  }, [&](MeshIndex i, MeshIndex j_begin, MeshIndex j_end) {
+    // Part of the sum over the neighbors, without the vertex of the row
+    j_end = std::min(j_end, bfs_laplacian_coef_addr(i + 1) - 1);
+    HeatScalar sum = 0;
+    MeshIndex v = bfs_vertex_list(i);
+    const MeshIndex *escaped = laplacian_escaped_from(i, j_begin);
+    for (MeshIndex j = j_begin; j < j_end; ++j) {
+      MeshIndex u = decode_index_delta(bfs_laplacian_delta[j], v, escaped);
+      sum += current_d(u) * bfs_laplacian_weight[j];
+    }
+    return sum;
+  }, [&](MeshIndex i, HeatScalar sum) {
+    if (segment == 0) {
+      sum += init_source_val;
+    }
+    temp_d(i - layer_begin) = sum
+        / bfs_laplacian_weight[bfs_laplacian_coef_addr(i + 1) - 1];
+  });
+
+  SCHEDULED_PARALLEL_FOR(MeshIndex, i, layer_begin, layer_end) {
+    current_d(bfs_vertex_list(i)) = temp_d(i - layer_begin);
+  } PARALLEL_FOR_END
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::compute_init_gradients() {
+  OMP_PARALLEL
+  {
+    // Compute initial gradient
+    SCHEDULED_PARALLEL_FOR(MeshIndex, i, 0, n_faces) {
+      Matrix3HS edge_vecs;
+      Vector3HS heat_vals;
+      int k = 0;
+
+      for (; k < 3; ++k) {
+        MeshIndex heh = op->face_halfedges(k, i);
+        Eigen::Vector3d current_edge = op->edge_vector.col(heh >> 1);
+        if (heh & 1) {  // Opposite to the first halfedge of the edge
+          current_edge *= -1;
+        }
+
+        edge_vecs(0, k) = HeatScalar(current_edge[0]);
+        edge_vecs(1, k) = HeatScalar(current_edge[1]);
+        edge_vecs(2, k) = HeatScalar(current_edge[2]);
+        heat_vals(k) = current_d(op->halfedge_to_vertex(heh));
+      }
+
+      heat_vals.normalize();
+      edge_vecs.normalize();
+
+      Vector3HS N = edge_vecs.col(0).cross(edge_vecs.col(1)).normalized();
+      Vector3HS V = edge_vecs.col(0) * heat_vals(1)
+          + edge_vecs.col(1) * heat_vals(2) + edge_vecs.col(2) * heat_vals(0);
+      Vector3HS grad_vec = V.cross(N).normalized();
+      init_grad(0, i) = grad_vec(0);
+      init_grad(1, i) = grad_vec(1);
+      init_grad(2, i) = grad_vec(2);
+    } PARALLEL_FOR_END
+  }
+
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::compute_heatflow_residual(
+    const VectorHSBuffer &heat_values, HeatScalar init_source_val,
+    VectorHSBuffer &residuals) {
+  balanced_row_loop(0, n_vertices, [&](MeshIndex i) {
+    MeshIndex lap_coef_begin_addr = bfs_laplacian_coef_addr(i);
+    MeshIndex lap_coef_end_addr = bfs_laplacian_coef_addr(i + 1);
+
+    HeatScalar res = 0;
+    if (i < static_cast<MeshIndex>(param.source_vertices.size())) {  // Check whether the current vertex is a source
+      res += init_source_val;
+    }
+
+    MeshIndex v = bfs_vertex_list(i);
+    const MeshIndex *escaped = bfs_laplacian_escape
+        + bfs_laplacian_escape_addr(i);
+    for (MeshIndex j = lap_coef_begin_addr; j < lap_coef_end_addr; ++j) {
+      MeshIndex u = decode_index_delta(bfs_laplacian_delta[j], v, escaped);
+      res += heat_values(u) * bfs_laplacian_weight[j]
+          * ((j == (lap_coef_end_addr - 1)) ? (-1) : 1);
+    }
+
+    residuals(i) = res;
+  }, [&](MeshIndex i, MeshIndex j_begin, MeshIndex j_end) {
+    MeshIndex lap_coef_end_addr = bfs_laplacian_coef_addr(i + 1);
+    HeatScalar res = 0;
+    MeshIndex v = bfs_vertex_list(i);
+    const MeshIndex *escaped = laplacian_escaped_from(i, j_begin);
+    for (MeshIndex j = j_begin; j < j_end; ++j) {
+      MeshIndex u = decode_index_delta(bfs_laplacian_delta[j], v, escaped);
+      res += heat_values(u) * bfs_laplacian_weight[j]
+          * ((j == (lap_coef_end_addr - 1)) ? (-1) : 1);
+    }
+    return res;
+  }, [&](MeshIndex i, HeatScalar res) {
+    if (i < static_cast<MeshIndex>(param.source_vertices.size())) {
+      res += init_source_val;
+    }
+    residuals(i) = res;
+  });
+}
+
+template<typename Formulation, typename HeatScalarT>
+int GeodesicSolverCore<Formulation, HeatScalarT>::balanced_loop_threads() const {
+#if defined(USE_OPENMP) && !defined(USE_TASK_SCHEDULER)
+  if (phase_schedules[HEAT_PHASE].kind == LoopSchedule::STATIC) {
+    return omp_get_max_threads();
+  }
+#endif
+  return 0;
+}
+
+template<typename Formulation, typename HeatScalarT>
+template<typename RowBody>
+void GeodesicSolverCore<Formulation, HeatScalarT>::balanced_row_loop(
+    MeshIndex begin, MeshIndex end, const RowBody &row_body) {
+  if (!run_balanced_rows(begin, end, false, row_body)) {
+    scheduled_parallel_for(begin, end, row_body);
+    return;
+  }
+
+  OMP_BARRIER
+}
+
+template<typename Formulation, typename HeatScalarT>
+template<typename RowBody, typename PartialSum, typename FinishRow>
+void GeodesicSolverCore<Formulation, HeatScalarT>::balanced_row_loop(
+    MeshIndex begin, MeshIndex end, const RowBody &row_body,
+    const PartialSum &partial_sum, const FinishRow &finish_row) {
+  if (!run_balanced_rows(begin, end, true, row_body)) {
+    scheduled_parallel_for(begin, end, row_body);
+    return;
+  }
+
+#if defined(USE_OPENMP) && !defined(USE_TASK_SCHEDULER)
+  int n_threads = omp_get_num_threads();
+  int thread = omp_get_thread_num();
+  std::vector<MeshIndex>::const_iterator long_row = std::lower_bound(
+      bfs_long_rows.begin(), bfs_long_rows.end(), begin);
+  for (; long_row != bfs_long_rows.end() && *long_row < end; ++long_row) {
+    MeshIndex i = *long_row;
+    double start_time = omp_get_wtime();
+    EventTrace::TimePoint part_start;
+    if (trace_loop_chunks) {
+      part_start = EventTrace::now();
+    }
+    long long row_begin = bfs_laplacian_coef_addr(i);
+    long long row_length = bfs_laplacian_coef_addr(i + 1) - row_begin;
+    long_row_partial_sums[thread] = partial_sum(
+        i, MeshIndex(row_begin + row_length * thread / n_threads),
+        MeshIndex(row_begin + row_length * (thread + 1) / n_threads));
+    thread_busy_seconds[thread] += omp_get_wtime() - start_time;
+    if (trace_loop_chunks) {
+      event_trace.add("long row part", EventTrace::CHUNK, part_start, i,
+                      i + 1);
+    }
+
+    OMP_BARRIER
+    OMP_SINGLE
+    {
+      HeatScalar sum = 0;
+      for (int t = 0; t < n_threads; ++t) {
+        sum += long_row_partial_sums[t];
+      }
+      finish_row(i, sum);
+    }
+  }
+#else
+  (void) partial_sum;
+  (void) finish_row;
+#endif
+
+  OMP_BARRIER
+}
+
+template<typename Formulation, typename HeatScalarT>
+template<typename RowBody>
+bool GeodesicSolverCore<Formulation, HeatScalarT>::run_balanced_rows(
+    MeshIndex begin, MeshIndex end, bool skip_long_rows,
+    const RowBody &row_body) {
+#if defined(USE_OPENMP) && !defined(USE_TASK_SCHEDULER)
+  if (thread_busy_seconds.empty()) {
+    return false;
+  }
+
+  int n_threads = omp_get_num_threads();
+  int thread = omp_get_thread_num();
+  double start_time = omp_get_wtime();
+  EventTrace::TimePoint chunk_start;
+  if (trace_loop_chunks) {
+    chunk_start = EventTrace::now();
+  }
+
+  // The rows whose work starts within the share of this thread
+  const MeshIndex *work_addr =
+      bfs_long_rows.empty() ?
+          bfs_laplacian_coef_addr.data() : bfs_row_work_addr.data();
+  long long work_begin = work_addr[begin];
+  long long work = work_addr[end] - work_begin;
+  MeshIndex share_begin = work_begin + work * thread / n_threads;
+  MeshIndex share_end = work_begin + work * (thread + 1) / n_threads;
+  MeshIndex row_begin = std::lower_bound(work_addr + begin, work_addr + end,
+                                         share_begin) - work_addr;
+  MeshIndex row_end = std::lower_bound(work_addr + begin, work_addr + end,
+                                       share_end) - work_addr;
+
+  for (MeshIndex i = row_begin; i < row_end; ++i) {
+    if (!skip_long_rows
+        || bfs_laplacian_coef_addr(i + 1) - bfs_laplacian_coef_addr(i)
+            <= kLongRowNonzeros) {
+      row_body(i);
+    }
+  }
+
+  thread_busy_seconds[thread] += omp_get_wtime() - start_time;
+  if (trace_loop_chunks) {
+    event_trace.add("rows", EventTrace::CHUNK, chunk_start, row_begin,
+                    row_end);
+  }
+  return true;
+#else
+  (void) begin;
+  (void) end;
+  (void) skip_long_rows;
+  (void) row_body;
+  return false;
+#endif
+}
+
+template<typename Formulation, typename HeatScalarT>
+const MeshIndex*
+GeodesicSolverCore<Formulation, HeatScalarT>::laplacian_escaped_from(
+    MeshIndex i, MeshIndex j) const {
+  const MeshIndex *escaped = bfs_laplacian_escape
+      + bfs_laplacian_escape_addr(i);
+  for (MeshIndex k = bfs_laplacian_coef_addr(i); k < j; ++k) {
+    if (bfs_laplacian_delta[k] == kIndexDeltaEscape) {
+      escaped++;
+    }
+  }
+  return escaped;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void
+GeodesicSolverCore<Formulation, HeatScalarT>::integrate_geodesic_distance() {
+  geod_dist_values.setZero(n_vertices);
+  MeshIndex n_segments = bfs_segment_addr.size() - 1;
+  int segment_count = 1;  // We update the distance values starting from the second layer of BFS vertex list
+  MeshIndex segment_begin_addr, segment_end_addr;
+  bool end_propagation = false;
+
+  OMP_PARALLEL
+  {
+    while (!end_propagation) {
+      OMP_SINGLE
+      {
+        segment_begin_addr = bfs_segment_addr(segment_count);
+        segment_end_addr = bfs_segment_addr(segment_count + 1);
+        if (event_trace.sampled(segment_count)) {
+          layer_start = EventTrace::now();
+        }
+
+        // Out of core, read the transitions of the next layer in the
+        // background while this layer is integrated
+        if (arena.file_backed() && segment_count + 1 < n_segments) {
+          MeshIndex next_begin = segment_end_addr;
+          MeshIndex n = bfs_segment_addr(segment_count + 2) - next_begin;
+          arena.prefetch(&transition_from_vtx(next_begin),
+                         n * sizeof(MeshIndex));
+          formulation().prefetch_transitions(next_begin, n);
+        }
+      }
+
+      SCHEDULED_PARALLEL_FOR(MeshIndex, i, segment_begin_addr,
+                             segment_end_addr) {
+        double from_d = geod_dist_values(transition_from_vtx(i));
+        geod_dist_values(bfs_vertex_list(i)) = from_d
+            + formulation().transition_difference(i);
+      } PARALLEL_FOR_END
+
+      OMP_SINGLE
+      {
+        if (event_trace.sampled(segment_count)) {
+          event_trace.add("integration layer", EventTrace::LAYER, layer_start,
+                          -1, segment_count);
+        }
+
+        segment_count++;
+        end_propagation = segment_count >= n_segments;
+      }
+    }
+  }
+
+  // Recover geodesic distance in the original scale
+  geod_dist_values *= model_scaling_factor;
+}
+
+template<typename Formulation, typename HeatScalarT>
+void
+GeodesicSolverCore<Formulation, HeatScalarT>::compute_integrable_gradients() {
+
+  optimization_end = false;
+  iter_num = 0;
+  storage_iter_mark = 0;
+  print_storage_io(0);
+
+  // The accuracy samples leave the parallel region to integrate the
+  // distances, starting with those of the initial gradients
+  if (accuracy.enabled()) {
+    sample_accuracy();
+  }
+
+  while (!optimization_end) {
+    accuracy_sample_due = false;
+
+    OMP_PARALLEL
+    {
+      while (!optimization_end && !accuracy_sample_due) {
+        OMP_SINGLE
+        {
+          need_compute_residual_norms = ((iter_num + 1)
+              % param.grad_solver_convergence_check_frequency == 0);
+          if (event_trace.enabled()) {
+            admm_iteration_start = EventTrace::now();
+          }
+        }
+
+        formulation().admm_iteration();
+      }
+    }
+
+    if (accuracy_sample_due) {
+      sample_accuracy();
+    }
+  }
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::sample_accuracy() {
+  accuracy.begin_sample();
+  integrate_geodesic_distance();
+  accuracy.add(iter_num, geod_dist_values, param.source_vertices);
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::update_convergence() {
+  iter_num++;
+  event_trace.add("admm iteration", EventTrace::ITERATION,
+                  admm_iteration_start, iter_num);
+  optimization_converge = need_compute_residual_norms
+      && (primal_residual_sqr_norm <= primal_residual_sqr_norm_threshold
+          && dual_residual_sqr_norm <= dual_residual_sqr_norm_threshold);
+  optimization_end = optimization_converge
+      || iter_num >= param.grad_solver_max_iter;
+  accuracy_sample_due = accuracy.enabled() && !optimization_end
+      && iter_num % param.accuracy_sample_interval == 0;
+  output_progress = need_compute_residual_norms
+      && (iter_num % param.grad_solver_output_frequency == 0);
+  if (need_compute_residual_norms) {
+    trace.add(ConvergenceTrace::ADMM, iter_num, -1, primal_residual_sqr_norm,
+              dual_residual_sqr_norm, param.penalty);
+  }
+
+  if (param.print_progress && optimization_converge) {
+    std::cout << "Solver converged." << std::endl;
+  } else if (param.print_progress && optimization_end) {
+    std::cout << "Maximum number of iterations reached." << std::endl;
+  }
+
+  if (param.print_progress && (output_progress || optimization_end)) {
+    std::cout << "Iteration " << iter_num << ":" << std::endl;
+    std::cout << "Primal residual squared norm: " << primal_residual_sqr_norm
+              << ",  threshold:" << primal_residual_sqr_norm_threshold
+              << std::endl;
+    std::cout << "Dual residual squared norm: " << dual_residual_sqr_norm
+              << ",  threshold:" << dual_residual_sqr_norm_threshold
+              << std::endl;
+    print_storage_io(iter_num);
+  }
+}
+
+template<typename Formulation, typename HeatScalarT>
+void GeodesicSolverCore<Formulation, HeatScalarT>::print_storage_io(int iter) {
+  long long read_bytes = 0, written_bytes = 0;
+  if (!arena.file_backed()
+      || !PerfCounters::storage_io(read_bytes, written_bytes)) {
+    return;
+  }
+
+  if (iter > storage_iter_mark) {
+    int n_iters = iter - storage_iter_mark;
+    std::cout << "Storage I/O per iteration: read "
+              << (read_bytes - storage_read_mark) / n_iters
+              << " bytes, written "
+              << (written_bytes - storage_written_mark) / n_iters << " bytes"
+              << std::endl;
+  }
+
+  storage_read_mark = read_bytes;
+  storage_written_mark = written_bytes;
+  storage_iter_mark = iter;
+}
+
+#endif /* GEODESICSOLVERCORE_H_ */
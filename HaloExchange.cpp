@@ -0,0 +1,136 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "HaloExchange.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+HaloExchange::HaloExchange()
+    : comm_(MPI_COMM_NULL),
+      n_owned_(0),
+      n_ghosts_(0),
+      received_bytes_(0) {
+}
+
+bool HaloExchange::setup(MPI_Comm comm, const std::vector<int> &owned_offsets,
+                         const std::vector<int> &ghost_ids) {
+  int rank = 0, n_ranks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &n_ranks);
+
+  comm_ = comm;
+  n_owned_ = owned_offsets[rank + 1] - owned_offsets[rank];
+  n_ghosts_ = ghost_ids.size();
+  received_bytes_ = 0;
+
+  // The ghost list is sorted, so that the ghosts owned by each rank are consecutive
+  std::vector<int> recv_counts(n_ranks, 0);
+  for (int i = 0; i < n_ghosts_; ++i) {
+    int owner = std::upper_bound(owned_offsets.begin(), owned_offsets.end(),
+                                 ghost_ids[i]) - owned_offsets.begin() - 1;
+    if (owner < 0 || owner >= n_ranks || owner == rank) {
+      std::cerr << "Error: invalid ghost index " << ghost_ids[i] << std::endl;
+      return false;
+    }
+    recv_counts[owner]++;
+  }
+
+  // Tell each owner which of its entries we need
+  std::vector<int> send_counts(n_ranks, 0);
+  MPI_Alltoall(recv_counts.data(), 1, MPI_INT, send_counts.data(), 1, MPI_INT,
+               comm);
+
+  std::vector<int> recv_displs(n_ranks + 1, 0), send_displs(n_ranks + 1, 0);
+  for (int r = 0; r < n_ranks; ++r) {
+    recv_displs[r + 1] = recv_displs[r] + recv_counts[r];
+    send_displs[r + 1] = send_displs[r] + send_counts[r];
+  }
+
+  send_indices_.resize(send_displs[n_ranks]);
+  MPI_Alltoallv(const_cast<int*>(ghost_ids.data()), recv_counts.data(),
+                recv_displs.data(), MPI_INT, send_indices_.data(),
+                send_counts.data(), send_displs.data(), MPI_INT, comm);
+
+  for (int i = 0; i < static_cast<int>(send_indices_.size()); ++i) {
+    send_indices_[i] -= owned_offsets[rank];
+  }
+
+  recv_ranks_.clear();
+  recv_addr_.assign(1, 0);
+  send_ranks_.clear();
+  send_addr_.assign(1, 0);
+  for (int r = 0; r < n_ranks; ++r) {
+    if (recv_counts[r] > 0) {
+      recv_ranks_.push_back(r);
+      recv_addr_.push_back(recv_displs[r + 1]);
+    }
+
+    if (send_counts[r] > 0) {
+      send_ranks_.push_back(r);
+      send_addr_.push_back(send_displs[r + 1]);
+    }
+  }
+
+  return true;
+}
+
+void HaloExchange::exchange_bytes(char *data, int entry_size) {
+  const int tag = 101;
+  send_buffer_.resize(std::size_t(send_indices_.size()) * entry_size);
+  recv_buffer_.resize(std::size_t(n_ghosts_) * entry_size);
+
+  for (int i = 0; i < static_cast<int>(send_indices_.size()); ++i) {
+    std::memcpy(&send_buffer_[std::size_t(i) * entry_size],
+                data + std::size_t(send_indices_[i]) * entry_size, entry_size);
+  }
+
+  int n_recv = recv_ranks_.size(), n_send = send_ranks_.size();
+  std::vector<MPI_Request> requests(n_recv + n_send);
+  for (int i = 0; i < n_recv; ++i) {
+    MPI_Irecv(&recv_buffer_[std::size_t(recv_addr_[i]) * entry_size],
+              (recv_addr_[i + 1] - recv_addr_[i]) * entry_size, MPI_BYTE,
+              recv_ranks_[i], tag, comm_, &requests[i]);
+  }
+
+  for (int i = 0; i < n_send; ++i) {
+    MPI_Isend(&send_buffer_[std::size_t(send_addr_[i]) * entry_size],
+              (send_addr_[i + 1] - send_addr_[i]) * entry_size, MPI_BYTE,
+              send_ranks_[i], tag, comm_, &requests[n_recv + i]);
+  }
+
+  MPI_Waitall(n_recv + n_send, requests.data(), MPI_STATUSES_IGNORE);
+
+  if (n_ghosts_ > 0) {
+    std::memcpy(data + std::size_t(n_owned_) * entry_size, recv_buffer_.data(),
+                recv_buffer_.size());
+  }
+  received_bytes_ += recv_buffer_.size();
+}
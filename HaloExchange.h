@@ -0,0 +1,94 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef HALOEXCHANGE_H_
+#define HALOEXCHANGE_H_
+
+#include <mpi.h>
+#include <vector>
+
+// Exchange of ghost values between MPI ranks.
+//
+// Each rank owns a contiguous range of global indices, given by
+// owned_offsets: rank r owns [owned_offsets[r], owned_offsets[r + 1]). A local
+// array stores the values of the owned indices first, followed by the values
+// of the ghost indices in the order of the sorted ghost list. exchange()
+// copies the values of the owned entries to the ghost entries of other ranks.
+class HaloExchange {
+ public:
+  HaloExchange();
+
+  // Set up the communication pattern. ghost_ids must be sorted and must not
+  // contain owned indices. Collective over comm.
+  bool setup(MPI_Comm comm, const std::vector<int> &owned_offsets,
+             const std::vector<int> &ghost_ids);
+
+  // Update the ghost entries of a local array, where each entry consists of
+  // width consecutive values. Collective over the ranks in the pattern.
+  template<typename Scalar>
+  void exchange(Scalar *data, int width) {
+    exchange_bytes(reinterpret_cast<char*>(data), sizeof(Scalar) * width);
+  }
+
+  int n_owned() const {
+    return n_owned_;
+  }
+
+  int n_ghosts() const {
+    return n_ghosts_;
+  }
+
+  // Total number of bytes received by this rank in all exchanges
+  double received_bytes() const {
+    return received_bytes_;
+  }
+
+ private:
+  MPI_Comm comm_;
+  int n_owned_;
+  int n_ghosts_;
+
+  // Ranks that send us ghost values, and the segments of the ghost list they fill
+  std::vector<int> recv_ranks_;
+  std::vector<int> recv_addr_;
+
+  // Ranks that need our values, and the segments of send_indices_ for them
+  std::vector<int> send_ranks_;
+  std::vector<int> send_addr_;
+  std::vector<int> send_indices_;  // Local indices of the owned entries to send
+
+  std::vector<char> send_buffer_, recv_buffer_;
+  double received_bytes_;
+
+  void exchange_bytes(char *data, int entry_size);
+};
+
+#endif /* HALOEXCHANGE_H_ */
@@ -0,0 +1,71 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef INDEXDELTA_H_
+#define INDEXDELTA_H_
+
+#include "EigenTypes.h"
+#include <cstdint>
+#include <limits>
+
+// Compact storage of index arrays whose entries are mostly close to a
+// reference index known when they are read, e.g. the neighbors of a vertex.
+// Each index is stored as a 16-bit offset from the reference. An index whose
+// offset does not fit is marked by kIndexDeltaEscape, and stored in full in a
+// separate array of escaped indices, in the order of the entries.
+typedef std::int16_t IndexDelta;
+
+const IndexDelta kIndexDeltaEscape = std::numeric_limits<IndexDelta>::min();
+
+inline bool index_delta_fits(MeshIndex idx, MeshIndex ref) {
+  MeshIndex delta = idx - ref;
+  return delta > kIndexDeltaEscape
+      && delta <= std::numeric_limits<IndexDelta>::max();
+}
+
+// Encode idx relative to ref, appending it to the escaped indices if needed
+inline IndexDelta encode_index_delta(MeshIndex idx, MeshIndex ref,
+                                     MeshIndex *&escaped) {
+  if (index_delta_fits(idx, ref)) {
+    return static_cast<IndexDelta>(idx - ref);
+  }
+
+  *escaped++ = idx;
+  return kIndexDeltaEscape;
+}
+
+// Decode an entry, taking the next escaped index if it is escaped
+inline MeshIndex decode_index_delta(IndexDelta delta, MeshIndex ref,
+                                    const MeshIndex *&escaped) {
+  return (delta != kIndexDeltaEscape) ? ref + delta : *escaped++;
+}
+
+#endif /* INDEXDELTA_H_ */
@@ -0,0 +1,243 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef KERNELBENCHMARK_H_
+#define KERNELBENCHMARK_H_
+
+#include "FaceBasedGeodesicSolver.h"
+#include "EdgeBasedGeodesicSolver.h"
+#include "OMPHelper.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Timing of the hot loops of a solver in isolation, for catching regressions
+// in a kernel that the end-to-end timing of a solve hides.
+//
+// The state of the solver is set up as in a solve up to each kernel, which is
+// then run repeatedly on it: the warm-up runs are not timed, and the timed
+// runs give the statistics of the kernel. Each run does the work of one step
+// of the solve and updates the state as it does (e.g. the heat values in a
+// Gauss-Seidel sweep), so that the data are as in a solve.
+//
+// The kernels are a Gauss-Seidel sweep over all BFS layers, the residual of
+// the heat flow, the initial gradients of the faces, the ADMM updates of Y,
+// of G (face-based) or X (edge-based) and of the dual variables (without and
+// with the residual norms of a convergence check), and one integration pass.
+//
+// Solver is FaceBasedGeodesicSolver or EdgeBasedGeodesicSolver, which let it
+// call their steps.
+template<typename Solver>
+class KernelBenchmark {
+ public:
+  struct Result {
+    std::string kernel;
+    int repetitions;
+    double min_seconds;
+    double median_seconds;
+    double mean_seconds;
+    double stddev_seconds;  // Sample standard deviation
+    double max_seconds;
+  };
+
+  KernelBenchmark(int warmup, int repetitions)
+      : warmup_(warmup),
+        repetitions_(std::max(repetitions, 1)) {
+  }
+
+  // Time the kernels of the solver on the operator with the parameters
+  bool run(const GeodesicOperator &op, const Parameters &param);
+
+  const std::vector<Result>& results() const {
+    return results_;
+  }
+
+ private:
+  typedef typename Solver::HeatScalar HeatScalar;
+
+  int warmup_;
+  int repetitions_;
+  std::vector<Result> results_;
+
+  template<typename Kernel>
+  void time_kernel(const char *name, const Kernel &kernel);
+
+  // The update of the gradient variables of ADMM, G or X
+  static const char* gradient_update_name(const FaceBasedGeodesicSolver&) {
+    return "update_G";
+  }
+  static const char* gradient_update_name(const EdgeBasedGeodesicSolver&) {
+    return "update_X";
+  }
+  static void update_gradients(FaceBasedGeodesicSolver &solver) {
+    solver.update_G();
+  }
+  static void update_gradients(EdgeBasedGeodesicSolver &solver) {
+    solver.update_X();
+  }
+};
+
+template<typename Solver>
+bool KernelBenchmark<Solver>::run(const GeodesicOperator &op,
+                                  const Parameters &param) {
+  results_.clear();
+
+  // Set up the state as run_phases() does, without output or records, and
+  // with one sweep of the heat solver for the heat values and gradients
+  Solver solver;
+  solver.param = param;
+  solver.param.print_progress = false;
+  solver.param.heat_solver_max_iter = 1;
+  solver.param.metrics_file.clear();
+  solver.param.convergence_trace_file.clear();
+  solver.param.event_trace_file.clear();
+  solver.op = &op;
+  if (!solver.check_input()) {
+    return false;
+  }
+
+  ScheduleScope schedules;
+  solver.init_bfs_paths();
+  if (!solver.map_buffers()) {
+    return false;
+  }
+  solver.gauss_seidel_init_gradients();
+
+  // Heat solver kernels, whose buffers are reused by the later phases
+  int n_segments = solver.bfs_segment_addr.size() - 1;
+  time_kernel("gauss_seidel_sweep", [&]() {
+    for (int segment = 0; segment < n_segments; ++segment) {
+      OMP_PARALLEL
+      {
+        solver.update_heat_layer(segment, HeatScalar(1));
+      }
+    }
+  });
+
+  time_kernel("heatflow_residual", [&]() {
+    OMP_PARALLEL
+    {
+      solver.compute_heatflow_residual(solver.current_d, HeatScalar(1),
+                                       solver.heatflow_residuals);
+    }
+  });
+
+  time_kernel("init_gradients", [&]() {
+    solver.compute_init_gradients();
+  });
+
+  // ADMM kernels
+  solver.prepare_integrate_geodesic_distance();
+  solver.init_admm_variables();
+  solver.need_compute_residual_norms = false;
+  time_kernel("update_Y", [&]() {
+    OMP_PARALLEL
+    {
+      solver.update_Y();
+    }
+  });
+
+  time_kernel(gradient_update_name(solver), [&]() {
+    OMP_PARALLEL
+    {
+      update_gradients(solver);
+    }
+  });
+
+  time_kernel("update_dual_variables", [&]() {
+    OMP_PARALLEL
+    {
+      solver.update_dual_variables();
+    }
+  });
+
+  solver.need_compute_residual_norms = true;
+  time_kernel("update_dual_variables_with_residuals", [&]() {
+    OMP_PARALLEL
+    {
+      solver.update_dual_variables();
+    }
+  });
+  solver.need_compute_residual_norms = false;
+
+  time_kernel("integration", [&]() {
+    solver.integrate_geodesic_distance();
+  });
+
+  return true;
+}
+
+template<typename Solver>
+template<typename Kernel>
+void KernelBenchmark<Solver>::time_kernel(const char *name,
+                                          const Kernel &kernel) {
+  for (int i = 0; i < warmup_; ++i) {
+    kernel();
+  }
+
+  std::vector<double> seconds(repetitions_);
+  for (int i = 0; i < repetitions_; ++i) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    kernel();
+    seconds[i] = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+
+  Result result;
+  result.kernel = name;
+  result.repetitions = repetitions_;
+  result.mean_seconds = 0;
+  for (int i = 0; i < repetitions_; ++i) {
+    result.mean_seconds += seconds[i] / repetitions_;
+  }
+  double sum_sqr_deviation = 0;
+  for (int i = 0; i < repetitions_; ++i) {
+    sum_sqr_deviation += (seconds[i] - result.mean_seconds)
+        * (seconds[i] - result.mean_seconds);
+  }
+  result.stddev_seconds =
+      repetitions_ > 1 ?
+          std::sqrt(sum_sqr_deviation / (repetitions_ - 1)) : 0.0;
+
+  std::sort(seconds.begin(), seconds.end());
+  result.min_seconds = seconds.front();
+  result.max_seconds = seconds.back();
+  result.median_seconds =
+      (repetitions_ % 2 == 1) ?
+          seconds[repetitions_ / 2] :
+          0.5 * (seconds[repetitions_ / 2 - 1] + seconds[repetitions_ / 2]);
+  results_.push_back(result);
+}
+
+#endif /* KERNELBENCHMARK_H_ */
@@ -0,0 +1,134 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "MeshPartition.h"
+#include "DistributedGeodesicSolver.h"
+#include "DistanceFile.h"
+#include "GetRSS.h"
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+
+static int run(int argc, char* argv[]) {
+  int rank = 0, n_ranks = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+  if (argc != 4) {
+    if (rank == 0) {
+      std::cerr
+          << "Usage: MPIGeodDistSolver PARAMETERS_FILE MESH_FILE DISTANCE_FILE"
+          << std::endl;
+    }
+    return 1;
+  }
+
+  Parameters param;
+  if (!param.load(argv[1])) {
+    if (rank == 0) {
+      std::cerr << "Error: unable to load parameter file" << std::endl;
+    }
+    return 1;
+  }
+
+  if (rank == 0) {
+    param.output_options();
+    if (param.solver_type != 0) {
+      std::cerr
+          << "Warning: the distributed solver only implements the face-based formulation"
+          << std::endl;
+    }
+  }
+
+  MeshPartition part;
+  IndexVector original_vertex;
+  if (!MeshPartition::distribute(MPI_COMM_WORLD, argv[2], param, part,
+                                 original_vertex)) {
+    return 1;
+  }
+
+  DistributedGeodesicSolver solver;
+  if (!solver.solve(MPI_COMM_WORLD, part, param)) {
+    if (rank == 0) {
+      std::cerr << "Error in solving geodesic distance by using Distributed Geodesic Distance Solver"
+                << std::endl;
+    }
+    return 1;
+  }
+  solver.print_statistics();
+
+  // Gather the distances on rank 0 and restore the original vertex order
+  const DenseVector &local_dist = solver.get_distance_values();
+  std::vector<int> counts(n_ranks);
+  for (int r = 0; r < n_ranks; ++r) {
+    counts[r] = part.vertex_offsets[r + 1] - part.vertex_offsets[r];
+  }
+
+  DenseVector gathered_dist;
+  if (rank == 0) {
+    gathered_dist.resize(part.n_vertices);
+  }
+  MPI_Gatherv(local_dist.data(), local_dist.size(), MPI_DOUBLE,
+              gathered_dist.data(), counts.data(), part.vertex_offsets.data(),
+              MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  int status = 1;
+  if (rank == 0) {
+    DenseVector dist_values(part.n_vertices);
+    for (int i = 0; i < part.n_vertices; ++i) {
+      dist_values(original_vertex(i)) = gathered_dist(i);
+    }
+
+    if (!DistanceFile::save(argv[3], dist_values)) {
+      std::cerr << "Error in saving geodesic distance" << std::endl;
+      status = 0;
+    }
+  }
+
+  // Peak memory of each rank, reported for the largest one
+  double peak_mem = getPeakRSS(), max_peak_mem = 0;
+  MPI_Reduce(&peak_mem, &max_peak_mem, 1, MPI_DOUBLE, MPI_MAX, 0,
+             MPI_COMM_WORLD);
+  if (rank == 0) {
+    std::cout << "Peak memory usage in bytes (max over ranks): "
+              << size_t(max_peak_mem) << std::endl;
+  }
+
+  return status ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  // MPI is only called outside of OpenMP parallel regions
+  int provided = 0;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  int result = run(argc, argv);
+  MPI_Finalize();
+  return result;
+}
@@ -0,0 +1,267 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "MappedRegion.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedRegion::MappedRegion()
+    : kind_(HEAP),
+      data_(NULL),
+      size_(0),
+      fd_(-1) {
+}
+
+MappedRegion::~MappedRegion() {
+  release();
+}
+
+bool MappedRegion::allocate(std::size_t size) {
+  release();
+  kind_ = HEAP;
+  data_ = static_cast<char*>(std::malloc(size));
+  if (data_ == NULL) {
+    std::cerr << "Error: unable to allocate " << size << " bytes" << std::endl;
+    return false;
+  }
+
+  size_ = size;
+  return true;
+}
+
+#ifndef _WIN32
+
+static int open_named(MappedRegion::Kind kind, const std::string &name,
+                      int flags) {
+  if (kind == MappedRegion::SHARED_MEMORY) {
+    return shm_open(name.c_str(), flags, 0644);
+  } else {
+    return ::open(name.c_str(), flags, 0644);
+  }
+}
+
+bool MappedRegion::create(Kind kind, const std::string &name,
+                          bool &already_exists) {
+  release();
+  already_exists = false;
+  kind_ = kind;
+  name_ = name;
+  fd_ = open_named(kind, name, O_RDWR | O_CREAT | O_EXCL);
+  if (fd_ < 0) {
+    already_exists = (errno == EEXIST);
+    if (!already_exists) {
+      std::cerr << "Error: unable to create " << name << ": "
+                << std::strerror(errno) << std::endl;
+    }
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedRegion::create_temporary(const std::string &directory) {
+  release();
+  kind_ = MAPPED_FILE;
+  name_ = directory + "/paraheat.XXXXXX";
+  std::vector<char> path(name_.begin(), name_.end());
+  path.push_back('\0');
+  fd_ = mkstemp(path.data());
+  if (fd_ < 0) {
+    std::cerr << "Error: unable to create a file in " << directory << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  name_ = path.data();
+  unlink(path.data());
+  return true;
+}
+
+bool MappedRegion::map_writable(std::size_t size) {
+  if (fd_ < 0 || data_ != NULL) {
+    return false;
+  }
+
+  int err = 0;
+  if (kind_ == MAPPED_FILE) {
+    err = posix_fallocate(fd_, 0, size);
+  } else if (ftruncate(fd_, size) != 0) {
+    err = errno;
+  }
+
+  if (err != 0) {
+    std::cerr << "Error: unable to resize " << name_ << " to " << size
+              << " bytes: " << std::strerror(err) << std::endl;
+    return false;
+  }
+
+  void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Error: unable to map " << name_ << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<char*>(addr);
+  size_ = size;
+  return true;
+}
+
+bool MappedRegion::open(Kind kind, const std::string &name) {
+  release();
+  kind_ = kind;
+  name_ = name;
+  fd_ = open_named(kind, name, O_RDONLY);
+  if (fd_ < 0) {
+    std::cerr << "Error: unable to open " << name << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+std::size_t MappedRegion::current_size() const {
+  struct stat st;
+  if (fd_ < 0 || fstat(fd_, &st) != 0) {
+    return 0;
+  }
+
+  return st.st_size;
+}
+
+bool MappedRegion::map_readonly() {
+  std::size_t size = current_size();
+  if (fd_ < 0 || data_ != NULL || size == 0) {
+    return false;
+  }
+
+  void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    std::cerr << "Error: unable to map " << name_ << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<char*>(addr);
+  size_ = size;
+  return true;
+}
+
+void MappedRegion::release() {
+  if (kind_ == HEAP) {
+    std::free(data_);
+  } else {
+    if (data_ != NULL) {
+      munmap(data_, size_);
+    }
+
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  kind_ = HEAP;
+  data_ = NULL;
+  size_ = 0;
+  fd_ = -1;
+  name_.clear();
+}
+
+bool MappedRegion::remove(Kind kind, const std::string &name) {
+  if (kind == SHARED_MEMORY) {
+    return shm_unlink(name.c_str()) == 0;
+  } else if (kind == MAPPED_FILE) {
+    return unlink(name.c_str()) == 0;
+  }
+
+  return false;
+}
+
+#else
+
+bool MappedRegion::create(Kind, const std::string&, bool &already_exists) {
+  already_exists = false;
+  std::cerr << "Error: shared regions are not supported on this system"
+            << std::endl;
+  return false;
+}
+
+bool MappedRegion::create_temporary(const std::string&) {
+  std::cerr << "Error: mapped files are not supported on this system"
+            << std::endl;
+  return false;
+}
+
+bool MappedRegion::map_writable(std::size_t) {
+  return false;
+}
+
+bool MappedRegion::open(Kind, const std::string&) {
+  std::cerr << "Error: shared regions are not supported on this system"
+            << std::endl;
+  return false;
+}
+
+std::size_t MappedRegion::current_size() const {
+  return 0;
+}
+
+bool MappedRegion::map_readonly() {
+  return false;
+}
+
+void MappedRegion::release() {
+  if (kind_ == HEAP) {
+    std::free(data_);
+  }
+
+  kind_ = HEAP;
+  data_ = NULL;
+  size_ = 0;
+  fd_ = -1;
+  name_.clear();
+}
+
+bool MappedRegion::remove(Kind, const std::string&) {
+  return false;
+}
+
+#endif
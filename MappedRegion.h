@@ -0,0 +1,107 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MAPPEDREGION_H_
+#define MAPPEDREGION_H_
+
+#include <cstddef>
+#include <string>
+
+// A contiguous block of memory for large arrays. It is either allocated on the
+// heap, or mapped from a POSIX shared-memory object or a file so that it can
+// be shared between processes, or that it can exceed the physical memory.
+// Mapped regions are only supported on POSIX systems.
+class MappedRegion {
+ public:
+  enum Kind {
+    HEAP,
+    SHARED_MEMORY,  // name is a POSIX shared-memory object name, e.g. "/paraheat_bunny"
+    MAPPED_FILE     // name is a file path
+  };
+
+  MappedRegion();
+  ~MappedRegion();
+
+  // Allocate a heap region
+  bool allocate(std::size_t size);
+
+  // Create a named region exclusively, without mapping it. If the region
+  // already exists, returns false with already_exists set to true.
+  bool create(Kind kind, const std::string &name, bool &already_exists);
+
+  // Create a file in the directory that is removed right away, so that it
+  // only lives as long as the region, without mapping it
+  bool create_temporary(const std::string &directory);
+
+  // Set the size of a region created by create() or create_temporary() and
+  // map it read-write. The storage of a file is allocated up front, so that a
+  // full file system fails here rather than with SIGBUS on a later write.
+  bool map_writable(std::size_t size);
+
+  // Open an existing named region; map it read-only once it has a nonzero size
+  bool open(Kind kind, const std::string &name);
+  bool map_readonly();
+  std::size_t current_size() const;
+
+  // Unmap or free the region; named regions are kept by the system
+  void release();
+
+  // Remove a named region from the system
+  static bool remove(Kind kind, const std::string &name);
+
+  char* data() {
+    return data_;
+  }
+
+  const char* data() const {
+    return data_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  Kind kind() const {
+    return kind_;
+  }
+
+ private:
+  Kind kind_;
+  char *data_;
+  std::size_t size_;
+  int fd_;
+  std::string name_;
+
+  MappedRegion(const MappedRegion&);
+  MappedRegion& operator=(const MappedRegion&);
+};
+
+#endif /* MAPPEDREGION_H_ */
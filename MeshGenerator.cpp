@@ -0,0 +1,474 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "MeshGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const char* const kKindNames[MeshGenerator::KIND_COUNT] = { "grid",
+    "icosphere", "tube", "scan" };
+
+const char* const kShuffledSuffix = ":shuffled";
+
+// Seed of the random choices, fixed so that a specification gives one mesh
+const unsigned kSeed = 20190101;
+
+const double kPi = 3.14159265358979323846;
+
+int find_kind(const std::string &kind) {
+  for (int i = 0; i < MeshGenerator::KIND_COUNT; ++i) {
+    if (kind == kKindNames[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Add the two triangles of the quad (v00, v01, v11, v10)
+void add_quad(MeshIndex v00, MeshIndex v01, MeshIndex v11, MeshIndex v10,
+              Matrix3Xi &faces, MeshIndex &n_faces) {
+  faces.col(n_faces++) << v00, v01, v11;
+  faces.col(n_faces++) << v00, v11, v10;
+}
+
+}
+
+bool MeshGenerator::is_synthetic(const std::string &name) {
+  std::string::size_type colon = name.find(':');
+  return colon != std::string::npos && find_kind(name.substr(0, colon)) >= 0;
+}
+
+bool MeshGenerator::parse(const std::string &name, std::vector<Spec> &specs) {
+  specs.clear();
+  std::string::size_type colon = name.find(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+
+  Spec spec;
+  spec.kind = find_kind(name.substr(0, colon));
+  std::string size = name.substr(colon + 1);
+  const std::string shuffled(kShuffledSuffix);
+  spec.shuffled = size.size() > shuffled.size()
+      && size.compare(size.size() - shuffled.size(), shuffled.size(), shuffled)
+          == 0;
+  if (spec.shuffled) {
+    size.erase(size.size() - shuffled.size());
+  }
+
+  // A single size, or a range MIN-MAX
+  long long min_faces = 0, max_faces = 0;
+  char dash = 0;
+  std::istringstream istr(size);
+  if (!(istr >> min_faces)) {
+    return false;
+  }
+  max_faces = min_faces;
+  if (istr >> dash && !(dash == '-' && istr >> max_faces)) {
+    return false;
+  }
+  if (spec.kind < 0 || min_faces <= 0 || max_faces < min_faces
+      || !(istr >> std::ws).eof()) {
+    return false;
+  }
+
+  for (long long n = min_faces; n <= max_faces; n *= 10) {
+    spec.n_faces = n;
+    specs.push_back(spec);
+    if (n > max_faces / 10) {
+      break;
+    }
+  }
+  return true;
+}
+
+std::string MeshGenerator::name(const Spec &spec) {
+  std::ostringstream ostr;
+  ostr << kKindNames[spec.kind] << ":" << spec.n_faces
+       << (spec.shuffled ? kShuffledSuffix : "");
+  return ostr.str();
+}
+
+void MeshGenerator::generate(const Spec &spec, Matrix3X &points,
+                             Matrix3Xi &faces) {
+  switch (spec.kind) {
+    case ICOSPHERE:
+      make_icosphere(spec.n_faces, points, faces);
+      break;
+    case TUBE:
+      make_tube(spec.n_faces, points, faces);
+      break;
+    case SCAN:
+      make_scan(spec.n_faces, points, faces);
+      break;
+    default:
+      make_grid(spec.n_faces, points, faces);
+      break;
+  }
+
+  if (spec.shuffled) {
+    shuffle(points, faces);
+  }
+}
+
+bool MeshGenerator::generate(const Spec &spec,
+                             surface_mesh::Surface_mesh &mesh) {
+  Matrix3X points;
+  Matrix3Xi faces;
+  generate(spec, points, faces);
+  if (!build(points, faces, mesh)) {
+    std::cerr << "Error: invalid synthetic mesh " << name(spec) << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool MeshGenerator::generate(const std::string &name,
+                             surface_mesh::Surface_mesh &mesh) {
+  std::vector<Spec> specs;
+  if (!parse(name, specs) || specs.size() != 1) {
+    std::cerr << "Error: invalid synthetic mesh " << name << std::endl;
+    return false;
+  }
+
+  return generate(specs[0], mesh);
+}
+
+bool MeshGenerator::build(const Matrix3X &points, const Matrix3Xi &faces,
+                          surface_mesh::Surface_mesh &mesh) {
+  typedef surface_mesh::Surface_mesh::Vertex Vertex;
+  mesh.clear();
+  mesh.reserve(points.cols(), points.cols() + faces.cols(), faces.cols());
+  for (MeshIndex i = 0; i < points.cols(); ++i) {
+    mesh.add_vertex(
+        surface_mesh::Point(points(0, i), points(1, i), points(2, i)));
+  }
+  for (MeshIndex i = 0; i < faces.cols(); ++i) {
+    if (!mesh.add_triangle(Vertex(faces(0, i)), Vertex(faces(1, i)),
+                           Vertex(faces(2, i))).is_valid()) {
+      std::cerr << "Error: unable to add face " << i << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool MeshGenerator::exact_distance(const Spec &spec, const Matrix3X &points,
+                                   const std::vector<MeshIndex> &sources,
+                                   DenseVector &distance) {
+  if (spec.kind == SCAN) {
+    return false;
+  }
+
+  distance.setConstant(points.cols(), std::numeric_limits<double>::max());
+  for (size_t s = 0; s < sources.size(); ++s) {
+    if (sources[s] < 0 || sources[s] >= points.cols()) {
+      return false;
+    }
+    Eigen::Vector3d source = points.col(sources[s]);
+    for (MeshIndex i = 0; i < points.cols(); ++i) {
+      Eigen::Vector3d p = points.col(i);
+      double d = 0;
+      if (spec.kind == ICOSPHERE) {
+        d = std::acos(std::max(-1.0, std::min(1.0, p.dot(source))));
+      } else if (spec.kind == TUBE) {
+        // Unit radius: the angle around the axis is the arc length
+        double angle = std::acos(std::max(-1.0, std::min(1.0,
+            p(0) * source(0) + p(1) * source(1))));
+        d = std::sqrt(angle * angle + (p(2) - source(2)) * (p(2) - source(2)));
+      } else {
+        d = (p - source).norm();
+      }
+      distance(i) = std::min(distance(i), d);
+    }
+  }
+
+  return true;
+}
+
+bool MeshGenerator::write_binary_off(const Matrix3X &points,
+                                     const Matrix3Xi &faces,
+                                     const std::string &file_name) {
+  FILE *out = std::fopen(file_name.c_str(), "wb");
+  if (out == NULL) {
+    return false;
+  }
+
+  std::uint32_t counts[3] = { std::uint32_t(points.cols()), std::uint32_t(
+      faces.cols()), 0 };
+  bool success = std::fputs("OFF BINARY\n", out) >= 0
+      && std::fwrite(counts, sizeof(counts), 1, out) == 1;
+
+  // Vertices and faces in blocks, to write large meshes quickly
+  const MeshIndex kBlock = 1 << 16;
+  std::vector<float> coords;
+  for (MeshIndex begin = 0; success && begin < points.cols(); begin += kBlock) {
+    MeshIndex end = std::min<MeshIndex>(begin + kBlock, points.cols());
+    coords.resize(3 * (end - begin));
+    for (MeshIndex i = begin; i < end; ++i) {
+      for (int k = 0; k < 3; ++k) {
+        coords[3 * (i - begin) + k] = float(points(k, i));
+      }
+    }
+    success = std::fwrite(coords.data(), sizeof(float), coords.size(), out)
+        == coords.size();
+  }
+
+  std::vector<std::uint32_t> indices;
+  for (MeshIndex begin = 0; success && begin < faces.cols(); begin += kBlock) {
+    MeshIndex end = std::min<MeshIndex>(begin + kBlock, faces.cols());
+    indices.resize(4 * (end - begin));
+    for (MeshIndex i = begin; i < end; ++i) {
+      indices[4 * (i - begin)] = 3;
+      for (int k = 0; k < 3; ++k) {
+        indices[4 * (i - begin) + k + 1] = std::uint32_t(faces(k, i));
+      }
+    }
+    success = std::fwrite(indices.data(), sizeof(std::uint32_t),
+                          indices.size(), out) == indices.size();
+  }
+
+  return (std::fclose(out) == 0) && success;
+}
+
+void MeshGenerator::make_grid(long long n_faces, Matrix3X &points,
+                              Matrix3Xi &faces) {
+  MeshIndex n = std::max<MeshIndex>(
+      2, MeshIndex(std::sqrt(double(n_faces) / 2.0)) + 1);
+  points.resize(3, n * n);
+  for (MeshIndex i = 0; i < n; ++i) {
+    for (MeshIndex j = 0; j < n; ++j) {
+      points.col(i * n + j) << double(j), double(i), 0.0;
+    }
+  }
+
+  faces.resize(3, 2 * (n - 1) * (n - 1));
+  MeshIndex n_added = 0;
+  for (MeshIndex i = 0; i + 1 < n; ++i) {
+    for (MeshIndex j = 0; j + 1 < n; ++j) {
+      add_quad(i * n + j, i * n + j + 1, (i + 1) * n + j + 1, (i + 1) * n + j,
+               faces, n_added);
+    }
+  }
+}
+
+void MeshGenerator::make_icosphere(long long n_faces, Matrix3X &points,
+                                   Matrix3Xi &faces) {
+  // Each face of the icosahedron is split into m * m triangles
+  MeshIndex m = std::max<MeshIndex>(
+      1, MeshIndex(std::sqrt(double(n_faces) / 20.0) + 0.5));
+
+  const double t = (1.0 + std::sqrt(5.0)) / 2.0;
+  const double corners[12][3] = { { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, {
+      1, -t, 0 }, { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t }, { t,
+      0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+  const int ico_faces[20][3] = { { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0,
+      7, 10 }, { 0, 10, 11 }, { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10,
+      7, 6 }, { 7, 1, 8 }, { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, {
+      3, 8, 9 }, { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8,
+      1 } };
+
+  // Vertices: the corners, then m - 1 on each edge of the icosahedron in the
+  // direction from its lower to its higher corner, then the interior ones of
+  // each face
+  std::vector<std::pair<int, int> > edges;
+  for (int f = 0; f < 20; ++f) {
+    for (int k = 0; k < 3; ++k) {
+      int a = ico_faces[f][k], b = ico_faces[f][(k + 1) % 3];
+      edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  MeshIndex n_interior = (m - 1) * (m - 2) / 2;
+  points.resize(3, 12 + 30 * (m - 1) + 20 * n_interior);
+  for (int c = 0; c < 12; ++c) {
+    points.col(c) = Eigen::Vector3d(corners[c][0], corners[c][1],
+                                    corners[c][2]).normalized();
+  }
+
+  // Index of the vertex with barycentric coordinates (i, j, m - i - j) in
+  // face f, from its corners (a, b, c)
+  std::vector<MeshIndex> face_vertices((m + 1) * (m + 1));
+  faces.resize(3, 20 * m * m);
+  MeshIndex n_added = 0;
+  for (int f = 0; f < 20; ++f) {
+    const int *abc = ico_faces[f];
+    for (MeshIndex i = 0; i <= m; ++i) {
+      for (MeshIndex j = 0; i + j <= m; ++j) {
+        MeshIndex w[3] = { i, j, m - i - j };
+        int n_nonzero = (w[0] > 0) + (w[1] > 0) + (w[2] > 0);
+        MeshIndex v;
+        if (n_nonzero == 1) {
+          v = abc[w[0] > 0 ? 0 : (w[1] > 0 ? 1 : 2)];
+        } else if (n_nonzero == 2) {
+          int p = (w[0] == 0) ? 1 : 0, q = (w[2] == 0) ? 1 : 2;
+          int lo = std::min(abc[p], abc[q]), hi = std::max(abc[p], abc[q]);
+          MeshIndex steps = (abc[p] == lo) ? w[q] : w[p];  // From lo
+          MeshIndex e = std::lower_bound(edges.begin(), edges.end(),
+                                         std::make_pair(lo, hi))
+              - edges.begin();
+          v = 12 + e * (m - 1) + steps - 1;
+        } else {
+          // Interior points in row order of (i, j), with i, j >= 1
+          v = 12 + 30 * (m - 1) + f * n_interior + (i - 1) * (2 * m - i - 2) / 2
+              + (j - 1);
+        }
+
+        points.col(v) = ((double(w[0]) * points.col(abc[0])
+            + double(w[1]) * points.col(abc[1])
+            + double(w[2]) * points.col(abc[2])) / double(m)).normalized();
+        face_vertices[i * (m + 1) + j] = v;
+      }
+    }
+
+    for (MeshIndex i = 0; i < m; ++i) {
+      for (MeshIndex j = 0; i + j < m; ++j) {
+        MeshIndex v0 = face_vertices[i * (m + 1) + j];
+        MeshIndex v1 = face_vertices[(i + 1) * (m + 1) + j];
+        MeshIndex v2 = face_vertices[i * (m + 1) + j + 1];
+        faces.col(n_added++) << v0, v1, v2;
+        if (i + j + 1 < m) {
+          MeshIndex v3 = face_vertices[(i + 1) * (m + 1) + j + 1];
+          faces.col(n_added++) << v1, v3, v2;
+        }
+      }
+    }
+  }
+}
+
+void MeshGenerator::make_tube(long long n_faces, Matrix3X &points,
+                              Matrix3Xi &faces) {
+  // m vertices around, and 64 * m rings spaced by the edge length around
+  MeshIndex m = std::max<MeshIndex>(
+      3, MeshIndex(std::sqrt(double(n_faces) / 128.0) + 0.5));
+  MeshIndex n_rings = std::max<MeshIndex>(2, n_faces / (2 * m) + 1);
+  double spacing = 2.0 * std::sin(kPi / double(m));
+
+  points.resize(3, m * n_rings);
+  for (MeshIndex r = 0; r < n_rings; ++r) {
+    // Alternate rings are rotated by half a step, for near-equilateral faces
+    double offset = (r % 2) * kPi / double(m);
+    for (MeshIndex k = 0; k < m; ++k) {
+      double angle = 2.0 * kPi * double(k) / double(m) + offset;
+      points.col(r * m + k) << std::cos(angle), std::sin(angle), r * spacing;
+    }
+  }
+
+  faces.resize(3, 2 * m * (n_rings - 1));
+  MeshIndex n_added = 0;
+  for (MeshIndex r = 0; r + 1 < n_rings; ++r) {
+    for (MeshIndex k = 0; k < m; ++k) {
+      MeshIndex k1 = (k + 1) % m;
+      MeshIndex a = r * m + k, b = r * m + k1;
+      MeshIndex c = (r + 1) * m + k, d = (r + 1) * m + k1;
+      if (r % 2 == 0) {
+        faces.col(n_added++) << a, b, c;
+        faces.col(n_added++) << b, d, c;
+      } else {
+        faces.col(n_added++) << a, b, d;
+        faces.col(n_added++) << a, d, c;
+      }
+    }
+  }
+}
+
+void MeshGenerator::make_scan(long long n_faces, Matrix3X &points,
+                              Matrix3Xi &faces) {
+  make_grid(n_faces, points, faces);
+  MeshIndex n = MeshIndex(std::sqrt(double(points.cols())) + 0.5);
+
+  // Bumps over the square, with noise in all directions
+  std::mt19937_64 random(kSeed);
+  std::normal_distribution<double> noise(0.0, 0.05);
+  for (MeshIndex i = 0; i < points.cols(); ++i) {
+    double x = points(0, i) / double(n), y = points(1, i) / double(n);
+    double height = 0.1 * double(n)
+        * (std::sin(6.0 * kPi * x) * std::cos(4.0 * kPi * y)
+            + 0.5 * std::sin(17.0 * kPi * (x + y)));
+    points(0, i) += noise(random);
+    points(1, i) += noise(random);
+    points(2, i) = height + noise(random);
+  }
+
+  // Slivers: one in a hundred interior vertices is moved most of the way to
+  // its right neighbor
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (MeshIndex i = 1; i + 1 < n; ++i) {
+    for (MeshIndex j = 1; j + 1 < n; ++j) {
+      if (uniform(random) < 0.01) {
+        MeshIndex v = i * n + j;
+        points.col(v) += 0.95 * (points.col(v + 1) - points.col(v));
+      }
+    }
+  }
+}
+
+void MeshGenerator::shuffle(Matrix3X &points, Matrix3Xi &faces) {
+  std::mt19937_64 random(kSeed + 1);
+
+  std::vector<MeshIndex> new_index(points.cols());
+  for (MeshIndex i = 0; i < points.cols(); ++i) {
+    new_index[i] = i;
+  }
+  std::shuffle(new_index.begin(), new_index.end(), random);
+
+  Matrix3X new_points(3, points.cols());
+  for (MeshIndex i = 0; i < points.cols(); ++i) {
+    new_points.col(new_index[i]) = points.col(i);
+  }
+  points.swap(new_points);
+
+  std::vector<MeshIndex> face_order(faces.cols());
+  for (MeshIndex i = 0; i < faces.cols(); ++i) {
+    face_order[i] = i;
+  }
+  std::shuffle(face_order.begin(), face_order.end(), random);
+
+  Matrix3Xi new_faces(3, faces.cols());
+  for (MeshIndex i = 0; i < faces.cols(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      new_faces(k, i) = new_index[faces(k, face_order[i])];
+    }
+  }
+  faces.swap(new_faces);
+}
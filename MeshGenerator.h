@@ -0,0 +1,118 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MESHGENERATOR_H_
+#define MESHGENERATOR_H_
+
+#include "EigenTypes.h"
+#include "surface_mesh/Surface_mesh.h"
+#include <string>
+#include <vector>
+
+// Synthetic triangle meshes of any size, for scaling studies beyond the
+// bundled models. A mesh is named by a specification "KIND:FACES", with the
+// kinds
+//   grid       a flat triangulated square, with the vertices in row order
+//   icosphere  a sphere subdivided from an icosahedron, closed and regular
+//   tube       an open cylinder 64 times longer than its circumference, with
+//              about sqrt(32 * FACES) BFS layers from a vertex at one end
+//   scan       a bumpy height field with noise, where some vertices are moved
+//              close to a neighbor so that their triangles are slivers
+// and the number of faces, which is matched approximately. Appending
+// ":shuffled" puts the vertices and faces in random order, as in meshes whose
+// order does not follow their connectivity. "KIND:MIN-MAX" names the meshes
+// of the kind with MIN faces, 10 times as many, and so on up to MAX faces.
+// The random choices use a fixed seed, so that a specification always gives
+// the same mesh.
+class MeshGenerator {
+ public:
+  enum Kind {
+    GRID = 0,
+    ICOSPHERE = 1,
+    TUBE = 2,
+    SCAN = 3,
+    KIND_COUNT = 4
+  };
+
+  struct Spec {
+    int kind;
+    long long n_faces;
+    bool shuffled;
+  };
+
+  // Whether the name is a specification rather than a mesh file name
+  static bool is_synthetic(const std::string &name);
+
+  // The meshes named by a specification, one for each size of a range
+  static bool parse(const std::string &name, std::vector<Spec> &specs);
+
+  // Name of a single mesh, as accepted by parse()
+  static std::string name(const Spec &spec);
+
+  // Vertex positions and faces of the mesh
+  static void generate(const Spec &spec, Matrix3X &points, Matrix3Xi &faces);
+
+  // The mesh as a surface_mesh, e.g. for GeodesicOperator::build()
+  static bool generate(const Spec &spec, surface_mesh::Surface_mesh &mesh);
+
+  // Generate the mesh named by a specification that names a single mesh
+  static bool generate(const std::string &name,
+                       surface_mesh::Surface_mesh &mesh);
+
+  // Build a surface_mesh from vertex positions and faces
+  static bool build(const Matrix3X &points, const Matrix3Xi &faces,
+                    surface_mesh::Surface_mesh &mesh);
+
+  // Exact geodesic distance of the vertices of a generated mesh to the
+  // nearest source vertex, on the smooth surface that the mesh samples:
+  // straight lines for grids, great circles for icospheres, and helices for
+  // tubes. False for scans, which have no closed-form distance.
+  static bool exact_distance(const Spec &spec, const Matrix3X &points,
+                             const std::vector<MeshIndex> &sources,
+                             DenseVector &distance);
+
+  // Write a mesh in the binary OFF format read by surface_mesh ("OFF BINARY"
+  // header, then 32-bit counts, float coordinates and 32-bit indices in the
+  // byte order of the machine), which loads much faster than text formats
+  static bool write_binary_off(const Matrix3X &points, const Matrix3Xi &faces,
+                               const std::string &file_name);
+
+ private:
+  static void make_grid(long long n_faces, Matrix3X &points,
+                        Matrix3Xi &faces);
+  static void make_icosphere(long long n_faces, Matrix3X &points,
+                             Matrix3Xi &faces);
+  static void make_tube(long long n_faces, Matrix3X &points, Matrix3Xi &faces);
+  static void make_scan(long long n_faces, Matrix3X &points, Matrix3Xi &faces);
+  static void shuffle(Matrix3X &points, Matrix3Xi &faces);
+};
+
+#endif /* MESHGENERATOR_H_ */
@@ -0,0 +1,552 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "MeshPartition.h"
+#include "GeodesicOperator.h"
+#include "surface_mesh/IO.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// Large arrays are sent in several messages, to keep byte counts within int range
+const std::size_t kMaxMessageBytes = std::size_t(1) << 30;
+
+template<typename T>
+void send_vector(MPI_Comm comm, int dest, const std::vector<T> &values) {
+  unsigned long long n = values.size();
+  MPI_Send(&n, 1, MPI_UNSIGNED_LONG_LONG, dest, 0, comm);
+
+  const char *data = reinterpret_cast<const char*>(values.data());
+  std::size_t total_bytes = n * sizeof(T);
+  for (std::size_t offset = 0; offset < total_bytes; offset +=
+      kMaxMessageBytes) {
+    int count = std::min(kMaxMessageBytes, total_bytes - offset);
+    MPI_Send(const_cast<char*>(data + offset), count, MPI_BYTE, dest, 0, comm);
+  }
+}
+
+template<typename T>
+void receive_vector(MPI_Comm comm, int source, std::vector<T> &values) {
+  unsigned long long n = 0;
+  MPI_Recv(&n, 1, MPI_UNSIGNED_LONG_LONG, source, 0, comm, MPI_STATUS_IGNORE);
+  values.resize(n);
+
+  char *data = reinterpret_cast<char*>(values.data());
+  std::size_t total_bytes = n * sizeof(T);
+  for (std::size_t offset = 0; offset < total_bytes; offset +=
+      kMaxMessageBytes) {
+    int count = std::min(kMaxMessageBytes, total_bytes - offset);
+    MPI_Recv(data + offset, count, MPI_BYTE, source, 0, comm,
+             MPI_STATUS_IGNORE);
+  }
+}
+
+// Scalar members of MeshPartition, sent as one message
+struct PartitionHeader {
+  int n_ranks;
+  int rank;
+  int n_vertices;
+  int n_faces;
+  int n_interior_edges;
+  int n_layers;
+  int n_owned_edges;
+  double model_scaling_factor;
+  long double init_source_val;
+};
+
+// Split the faces in [begin, end) into n_parts parts of nearly equal size,
+// by recursively cutting along the longest axis of their bounding box
+void bisect_faces(std::vector<int>::iterator begin,
+                  std::vector<int>::iterator end, const Matrix3X &centroids,
+                  int first_part, int n_parts, std::vector<int> &face_part) {
+  if (n_parts == 1) {
+    for (std::vector<int>::iterator iter = begin; iter != end; ++iter) {
+      face_part[*iter] = first_part;
+    }
+    return;
+  }
+
+  Eigen::Vector3d min_coord = centroids.col(*begin), max_coord = min_coord;
+  for (std::vector<int>::iterator iter = begin; iter != end; ++iter) {
+    min_coord = min_coord.cwiseMin(centroids.col(*iter));
+    max_coord = max_coord.cwiseMax(centroids.col(*iter));
+  }
+
+  int axis = 0;
+  (max_coord - min_coord).maxCoeff(&axis);
+
+  int n_left_parts = n_parts / 2;
+  std::vector<int>::iterator mid = begin
+      + (end - begin) * static_cast<long long>(n_left_parts) / n_parts;
+  std::nth_element(begin, mid, end, [&](int a, int b) {
+    return centroids(axis, a) < centroids(axis, b);
+  });
+
+  bisect_faces(begin, mid, centroids, first_part, n_left_parts, face_part);
+  bisect_faces(mid, end, centroids, first_part + n_left_parts,
+               n_parts - n_left_parts, face_part);
+}
+
+// Global data on rank 0 for building the part of each rank
+class Partitioner {
+ public:
+  Partitioner(const GeodesicOperator &op, const Parameters &param, int n_ranks)
+      : op(op),
+        param(param),
+        n_ranks(n_ranks),
+        n_layers(0),
+        n_interior_edges(0),
+        init_source_val(1) {
+  }
+
+  bool compute_bfs();
+  void partition(const surface_mesh::Surface_mesh &mesh);
+  void build_part(int rank, MeshPartition &part) const;
+
+  std::vector<int> new_to_old_vertex;
+
+ private:
+  typedef long double HeatScalar;
+
+  const GeodesicOperator &op;
+  const Parameters &param;
+  int n_ranks;
+
+  // BFS from the sources, following the shared-memory solvers
+  std::vector<int> bfs_order;
+  std::vector<int> vertex_layer;
+  std::vector<int> transition_halfedge;
+  int n_layers;
+
+  std::vector<int> face_part, vertex_new_id, face_new_id, new_to_old_face;
+  std::vector<int> vertex_offsets, face_offsets;
+
+  // Interior edges with the first face in each part, and with only the second face in it
+  std::vector<std::vector<int> > owned_edges, ghost_edges;
+  int n_interior_edges;
+
+  HeatScalar init_source_val;
+
+  int new_face_id(int f) const {
+    return f >= 0 ? face_new_id[f] : -1;
+  }
+};
+
+bool Partitioner::compute_bfs() {
+  int n_vertices = op.n_vertices;
+  for (int i = 0; i < static_cast<int>(param.source_vertices.size()); ++i) {
+    if (param.source_vertices[i] < 0
+        || param.source_vertices[i] >= n_vertices) {
+      std::cerr << "Error: invalid source vertex index "
+                << param.source_vertices[i] << std::endl;
+      return false;
+    }
+  }
+
+  std::vector<bool> visited(n_vertices, false);
+  vertex_layer.assign(n_vertices, -1);
+  transition_halfedge.assign(n_vertices, -1);
+  bfs_order.clear();
+  bfs_order.reserve(n_vertices);
+
+  std::vector<int> current_front(param.source_vertices.begin(),
+                                 param.source_vertices.end()), next_front;
+  for (int i = 0; i < static_cast<int>(current_front.size()); ++i) {
+    int v = current_front[i];
+    visited[v] = true;
+    vertex_layer[v] = 0;
+    bfs_order.push_back(v);
+  }
+
+  n_layers = 1;
+  while (true) {
+    next_front.clear();
+    for (int k = 0; k < static_cast<int>(current_front.size()); ++k) {
+      int v = current_front[k];
+      for (int j = op.vertex_halfedge_addr(v);
+          j < op.vertex_halfedge_addr(v + 1); ++j) {
+        int heh = op.vertex_halfedges(j);
+        int next_v = op.halfedge_to_vertex(heh);
+        if (!visited[next_v]) {
+          next_front.push_back(next_v);
+          bfs_order.push_back(next_v);
+          vertex_layer[next_v] = n_layers;
+          transition_halfedge[next_v] = heh;
+        }
+
+        visited[next_v] = true;
+      }
+    }
+
+    if (next_front.empty()) {
+      break;
+    }
+
+    n_layers++;
+    std::swap(current_front, next_front);
+  }
+
+  if (static_cast<int>(bfs_order.size()) != n_vertices) {
+    std::cerr << "Error: the distributed solver requires a connected mesh"
+              << std::endl;
+    return false;
+  }
+
+  // Heat value for sources, as in the shared-memory solvers
+  int n_sources = param.source_vertices.size();
+  HeatScalar total_source_area = 0;
+  for (int i = 0; i < n_sources; ++i) {
+    total_source_area += op.vertex_area(param.source_vertices[i]);
+  }
+  init_source_val = std::sqrt(
+      std::min(HeatScalar(n_vertices) / HeatScalar(n_sources),
+               op.vertex_area.cast<HeatScalar>().sum() / total_source_area));
+
+  return true;
+}
+
+void Partitioner::partition(const surface_mesh::Surface_mesh &mesh) {
+  typedef surface_mesh::Surface_mesh MeshType;
+  int n_vertices = op.n_vertices, n_faces = op.n_faces;
+
+  // Split faces by their centroids
+  Matrix3X centroids(3, n_faces);
+  for (int i = 0; i < n_faces; ++i) {
+    Eigen::Vector3d c = Eigen::Vector3d::Zero();
+    for (int k = 0; k < 3; ++k) {
+      int v = op.halfedge_to_vertex(op.face_halfedges(k, i));
+      c += to_eigen_vec3d(mesh.position(MeshType::Vertex(v)));
+    }
+    centroids.col(i) = c / 3.0;
+  }
+
+  std::vector<int> faces(n_faces);
+  for (int i = 0; i < n_faces; ++i) {
+    faces[i] = i;
+  }
+  face_part.assign(n_faces, 0);
+  bisect_faces(faces.begin(), faces.end(), centroids, 0, n_ranks, face_part);
+
+  // Each vertex goes to the part of its first incident face
+  std::vector<int> vertex_part(n_vertices, 0);
+  for (int v = 0; v < n_vertices; ++v) {
+    for (int j = op.vertex_halfedge_addr(v); j < op.vertex_halfedge_addr(v + 1);
+        ++j) {
+      int f = op.halfedge_face(op.vertex_halfedges(j));
+      if (f >= 0) {
+        vertex_part[v] = face_part[f];
+        break;
+      }
+    }
+  }
+
+  // Renumber vertices by part, in BFS order within each part
+  std::vector<int> vertex_count(n_ranks, 0), face_count(n_ranks, 0);
+  for (int v = 0; v < n_vertices; ++v) {
+    vertex_count[vertex_part[v]]++;
+  }
+  for (int f = 0; f < n_faces; ++f) {
+    face_count[face_part[f]]++;
+  }
+
+  vertex_offsets.assign(n_ranks + 1, 0);
+  face_offsets.assign(n_ranks + 1, 0);
+  for (int r = 0; r < n_ranks; ++r) {
+    vertex_offsets[r + 1] = vertex_offsets[r] + vertex_count[r];
+    face_offsets[r + 1] = face_offsets[r] + face_count[r];
+  }
+
+  vertex_new_id.resize(n_vertices);
+  new_to_old_vertex.resize(n_vertices);
+  std::vector<int> next_id(vertex_offsets.begin(), vertex_offsets.end() - 1);
+  for (int i = 0; i < n_vertices; ++i) {
+    int v = bfs_order[i];
+    int id = next_id[vertex_part[v]]++;
+    vertex_new_id[v] = id;
+    new_to_old_vertex[id] = v;
+  }
+
+  face_new_id.resize(n_faces);
+  new_to_old_face.resize(n_faces);
+  next_id.assign(face_offsets.begin(), face_offsets.end() - 1);
+  for (int f = 0; f < n_faces; ++f) {
+    int id = next_id[face_part[f]]++;
+    face_new_id[f] = id;
+    new_to_old_face[id] = f;
+  }
+
+  // An interior edge belongs to the part of its first face
+  owned_edges.assign(n_ranks, std::vector<int>());
+  ghost_edges.assign(n_ranks, std::vector<int>());
+  n_interior_edges = 0;
+  for (int e = 0; e < op.n_edges; ++e) {
+    if (!op.is_boundary_edge(e)) {
+      int p0 = face_part[op.halfedge_face(2 * e)];
+      int p1 = face_part[op.halfedge_face(2 * e + 1)];
+      owned_edges[p0].push_back(e);
+      if (p1 != p0) {
+        ghost_edges[p1].push_back(e);
+      }
+      n_interior_edges++;
+    }
+  }
+}
+
+void Partitioner::build_part(int rank, MeshPartition &part) const {
+  part = MeshPartition();
+  part.n_ranks = n_ranks;
+  part.rank = rank;
+  part.n_vertices = op.n_vertices;
+  part.n_faces = op.n_faces;
+  part.n_interior_edges = n_interior_edges;
+  part.n_layers = n_layers;
+  part.model_scaling_factor = op.model_scaling_factor;
+  part.init_source_val = init_source_val;
+  part.vertex_offsets = vertex_offsets;
+  part.face_offsets = face_offsets;
+
+  // Owned vertices
+  double step_length = op.heat_step_length;
+  int vertex_begin = vertex_offsets[rank], vertex_end = vertex_offsets[rank
+      + 1];
+  part.layer_addr.assign(n_layers + 1, 0);
+  part.laplacian_addr.assign(1, 0);
+  for (int i = vertex_begin; i < vertex_end; ++i) {
+    int v = new_to_old_vertex[i];
+    part.layer_addr[vertex_layer[v] + 1]++;
+
+    // Laplacian row, computed in the same way as the shared-memory solvers
+    int n = op.valence(v) + 1;
+    DenseVector weights;
+    IndexVector vtx_idx;
+    weights.setZero(n);
+    vtx_idx.setZero(n);
+
+    int k = 0;
+    for (int j = op.vertex_halfedge_addr(v); j < op.vertex_halfedge_addr(v + 1);
+        ++j) {
+      int heh = op.vertex_halfedges(j);
+      vtx_idx(k) = op.halfedge_to_vertex(heh);
+      weights(k) = op.edge_laplacian_weight(heh >> 1);
+      k++;
+    }
+
+    vtx_idx(k) = v;
+    weights(k) = weights.head(k).sum();
+    weights *= step_length;
+    weights(k) += op.vertex_area(v);
+
+    for (int j = 0; j < n; ++j) {
+      part.laplacian_vertices.push_back(vertex_new_id[vtx_idx(j)]);
+      part.laplacian_weights.push_back(weights(j));
+    }
+    part.laplacian_addr.push_back(part.laplacian_vertices.size());
+
+    // Transition from the BFS parent
+    int heh = transition_halfedge[v];
+    if (heh >= 0) {
+      Eigen::Vector3d edge_vec = op.edge_vector.col(heh >> 1);
+      if (heh & 1) {
+        edge_vec *= -1;
+      }
+
+      part.transition_from_vertex.push_back(vertex_new_id[op.from_vertex(heh)]);
+      for (int j = 0; j < 3; ++j) {
+        part.transition_edge_vector.push_back(edge_vec(j));
+      }
+      part.transition_edge_faces.push_back(new_face_id(op.halfedge_face(heh)));
+      part.transition_edge_faces.push_back(
+          new_face_id(op.halfedge_face(heh ^ 1)));
+    } else {
+      part.transition_from_vertex.push_back(-1);
+      part.transition_edge_vector.insert(part.transition_edge_vector.end(), 3,
+                                         0.0);
+      part.transition_edge_faces.insert(part.transition_edge_faces.end(), 2,
+                                        -1);
+    }
+  }
+
+  for (int l = 0; l < n_layers; ++l) {
+    part.layer_addr[l + 1] += part.layer_addr[l];
+  }
+
+  // Owned faces
+  for (int i = face_offsets[rank]; i < face_offsets[rank + 1]; ++i) {
+    int f = new_to_old_face[i];
+    for (int k = 0; k < 3; ++k) {
+      int heh = op.face_halfedges(k, f);
+      Eigen::Vector3d edge_vec = op.edge_vector.col(heh >> 1);
+      if (heh & 1) {
+        edge_vec *= -1;
+      }
+
+      part.face_vertices.push_back(vertex_new_id[op.halfedge_to_vertex(heh)]);
+      for (int j = 0; j < 3; ++j) {
+        part.face_halfedge_vectors.push_back(edge_vec(j));
+      }
+    }
+  }
+
+  // Owned interior edges, followed by the other ones with an owned face
+  part.n_owned_edges = owned_edges[rank].size();
+  for (int pass = 0; pass < 2; ++pass) {
+    const std::vector<int> &edges =
+        (pass == 0) ? owned_edges[rank] : ghost_edges[rank];
+    for (int i = 0; i < static_cast<int>(edges.size()); ++i) {
+      int e = edges[i];
+      Eigen::Vector3d unit_vec = op.edge_vector.col(e).normalized();
+      for (int k = 0; k < 2; ++k) {
+        int f = op.halfedge_face(2 * e + k);
+        part.edge_faces.push_back(face_new_id[f]);
+        part.edge_face_areas.push_back(op.face_area(f));
+      }
+      for (int j = 0; j < 3; ++j) {
+        part.edge_unit_vectors.push_back(unit_vec(j));
+      }
+    }
+  }
+}
+
+}
+
+bool MeshPartition::distribute(MPI_Comm comm, const char *mesh_file,
+                               const Parameters &param, MeshPartition &part,
+                               IndexVector &original_vertex) {
+  int rank = 0, n_ranks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &n_ranks);
+
+  if (rank != 0) {
+    int status = 0;
+    MPI_Bcast(&status, 1, MPI_INT, 0, comm);
+    if (!status) {
+      return false;
+    }
+
+    part.receive(comm, 0);
+    return true;
+  }
+
+  GeodesicOperator op;
+  surface_mesh::Surface_mesh mesh;
+  std::unique_ptr<Partitioner> partitioner;
+  int status = 0;
+  if (!surface_mesh::read_mesh(mesh, mesh_file)) {
+    std::cerr << "Error: unable to read input mesh from the file " << mesh_file
+              << std::endl;
+  } else if (op.build(mesh)) {
+    partitioner.reset(new Partitioner(op, param, n_ranks));
+    status = partitioner->compute_bfs() ? 1 : 0;
+  }
+
+  MPI_Bcast(&status, 1, MPI_INT, 0, comm);
+  if (!status) {
+    return false;
+  }
+
+  partitioner->partition(mesh);
+  mesh.clear();
+  mesh.free_memory();
+
+  // Build and send the parts one at a time, to bound the memory on rank 0
+  for (int r = 1; r < n_ranks; ++r) {
+    MeshPartition remote_part;
+    partitioner->build_part(r, remote_part);
+    remote_part.send(comm, r);
+  }
+  partitioner->build_part(0, part);
+
+  original_vertex = Eigen::Map<const IndexVector>(
+      partitioner->new_to_old_vertex.data(),
+      partitioner->new_to_old_vertex.size());
+  return true;
+}
+
+void MeshPartition::send(MPI_Comm comm, int dest) const {
+  PartitionHeader header;
+  header.n_ranks = n_ranks;
+  header.rank = rank;
+  header.n_vertices = n_vertices;
+  header.n_faces = n_faces;
+  header.n_interior_edges = n_interior_edges;
+  header.n_layers = n_layers;
+  header.n_owned_edges = n_owned_edges;
+  header.model_scaling_factor = model_scaling_factor;
+  header.init_source_val = init_source_val;
+  MPI_Send(&header, sizeof(PartitionHeader), MPI_BYTE, dest, 0, comm);
+
+  send_vector(comm, dest, vertex_offsets);
+  send_vector(comm, dest, face_offsets);
+  send_vector(comm, dest, layer_addr);
+  send_vector(comm, dest, laplacian_addr);
+  send_vector(comm, dest, laplacian_vertices);
+  send_vector(comm, dest, laplacian_weights);
+  send_vector(comm, dest, transition_from_vertex);
+  send_vector(comm, dest, transition_edge_vector);
+  send_vector(comm, dest, transition_edge_faces);
+  send_vector(comm, dest, face_vertices);
+  send_vector(comm, dest, face_halfedge_vectors);
+  send_vector(comm, dest, edge_faces);
+  send_vector(comm, dest, edge_unit_vectors);
+  send_vector(comm, dest, edge_face_areas);
+}
+
+void MeshPartition::receive(MPI_Comm comm, int source) {
+  PartitionHeader header;
+  MPI_Recv(&header, sizeof(PartitionHeader), MPI_BYTE, source, 0, comm,
+           MPI_STATUS_IGNORE);
+  n_ranks = header.n_ranks;
+  rank = header.rank;
+  n_vertices = header.n_vertices;
+  n_faces = header.n_faces;
+  n_interior_edges = header.n_interior_edges;
+  n_layers = header.n_layers;
+  n_owned_edges = header.n_owned_edges;
+  model_scaling_factor = header.model_scaling_factor;
+  init_source_val = header.init_source_val;
+
+  receive_vector(comm, source, vertex_offsets);
+  receive_vector(comm, source, face_offsets);
+  receive_vector(comm, source, layer_addr);
+  receive_vector(comm, source, laplacian_addr);
+  receive_vector(comm, source, laplacian_vertices);
+  receive_vector(comm, source, laplacian_weights);
+  receive_vector(comm, source, transition_from_vertex);
+  receive_vector(comm, source, transition_edge_vector);
+  receive_vector(comm, source, transition_edge_faces);
+  receive_vector(comm, source, face_vertices);
+  receive_vector(comm, source, face_halfedge_vectors);
+  receive_vector(comm, source, edge_faces);
+  receive_vector(comm, source, edge_unit_vectors);
+  receive_vector(comm, source, edge_face_areas);
+}
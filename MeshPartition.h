@@ -0,0 +1,122 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MESHPARTITION_H_
+#define MESHPARTITION_H_
+
+#include "EigenTypes.h"
+#include "Parameters.h"
+#include <mpi.h>
+#include <vector>
+
+// The part of a mesh assigned to one MPI rank, for the distributed face-based
+// solver.
+//
+// Rank 0 reads the mesh, computes the BFS order from the sources, splits the
+// faces into one part per rank by recursive coordinate bisection, and
+// renumbers vertices and faces so that each rank owns a contiguous range of
+// global indices. Owned vertices are numbered in BFS order. All indices in a
+// MeshPartition are global indices after renumbering.
+struct MeshPartition {
+  MeshPartition()
+      : n_ranks(1),
+        rank(0),
+        n_vertices(0),
+        n_faces(0),
+        n_interior_edges(0),
+        n_layers(0),
+        model_scaling_factor(1.0),
+        init_source_val(1),
+        n_owned_edges(0) {
+  }
+
+  int n_ranks;
+  int rank;
+
+  // Global sizes
+  int n_vertices;
+  int n_faces;
+  int n_interior_edges;
+  int n_layers;  // Number of BFS layers; the first one contains the sources
+
+  double model_scaling_factor;
+  long double init_source_val;  // Heat value for sources, same as in the shared-memory solvers
+
+  // Ranges of vertices and faces owned by each rank
+  std::vector<int> vertex_offsets;
+  std::vector<int> face_offsets;
+
+  // Owned vertices, in BFS order
+  std::vector<int> layer_addr;  // Start of each BFS layer within the owned vertices
+  std::vector<int> laplacian_addr;  // Start of the Laplacian row of each owned vertex
+  std::vector<int> laplacian_vertices;  // Neighbors of the vertex, followed by the vertex itself
+  std::vector<double> laplacian_weights;  // Heat flow weights of the neighbors, then the diagonal weight
+  std::vector<int> transition_from_vertex;  // BFS parent of each vertex, -1 for sources
+  std::vector<double> transition_edge_vector;  // 3 values for each vertex: vector from the parent
+  std::vector<int> transition_edge_faces;  // 2 values for each vertex: faces of the edge from the parent, or -1
+
+  // Owned faces
+  std::vector<int> face_vertices;  // 3 values for each face: target vertices of its halfedges
+  std::vector<double> face_halfedge_vectors;  // 9 values for each face: vectors of its halfedges
+
+  // Interior edges with at least one owned face. The first n_owned_edges
+  // edges are owned by this rank, i.e. their first face is owned.
+  int n_owned_edges;
+  std::vector<int> edge_faces;  // 2 values for each edge
+  std::vector<double> edge_unit_vectors;  // 3 values for each edge
+  std::vector<double> edge_face_areas;  // 2 values for each edge
+
+  int n_owned_vertices() const {
+    return vertex_offsets[rank + 1] - vertex_offsets[rank];
+  }
+
+  int n_owned_faces() const {
+    return face_offsets[rank + 1] - face_offsets[rank];
+  }
+
+  int n_local_edges() const {
+    return edge_faces.size() / 2;
+  }
+
+  // Read and partition the mesh on rank 0, and send each rank its part.
+  // On rank 0, original_vertex receives the original index of each
+  // renumbered vertex. Collective over comm; returns false on all ranks if
+  // the mesh cannot be partitioned.
+  static bool distribute(MPI_Comm comm, const char *mesh_file,
+                         const Parameters &param, MeshPartition &part,
+                         IndexVector &original_vertex);
+
+ private:
+  void send(MPI_Comm comm, int dest) const;
+  void receive(MPI_Comm comm, int source);
+};
+
+#endif /* MESHPARTITION_H_ */
@@ -0,0 +1,336 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "NumaPlacement.h"
+#include "OMPHelper.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct Topology {
+  std::vector<std::vector<int> > node_cpus;  // Available CPUs of each node
+  std::vector<int> cpu_nodes;  // Node of each CPU
+
+  Topology() {
+    load();
+    if (node_cpus.empty()) {
+      node_cpus.push_back(std::vector<int>());
+    }
+  }
+
+  // Parse a CPU list such as "0-3,8-11"
+  static std::vector<int> parse_cpu_list(const std::string &str) {
+    std::vector<int> cpus;
+    std::istringstream istr(str);
+    std::string range;
+    while (std::getline(istr, range, ',')) {
+      int first = 0, last = 0;
+      char dash = 0;
+      std::istringstream range_str(range);
+      if (!(range_str >> first)) {
+        continue;
+      }
+      last = first;
+      if (range_str >> dash >> last) {
+        last = std::max(first, last);
+      }
+      for (int c = first; c <= last; ++c) {
+        cpus.push_back(c);
+      }
+    }
+    return cpus;
+  }
+
+  void load() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool has_mask = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+    for (int node = 0;; ++node) {
+      std::ostringstream path;
+      path << "/sys/devices/system/node/node" << node << "/cpulist";
+      std::ifstream ifile(path.str().c_str());
+      if (!ifile.is_open()) {
+        break;
+      }
+
+      std::string line;
+      std::getline(ifile, line);
+      std::vector<int> cpus = parse_cpu_list(line), available;
+      for (int i = 0; i < static_cast<int>(cpus.size()); ++i) {
+        int c = cpus[i];
+        if (c >= CPU_SETSIZE || (has_mask && !CPU_ISSET(c, &allowed))) {
+          continue;
+        }
+        available.push_back(c);
+        if (c >= static_cast<int>(cpu_nodes.size())) {
+          cpu_nodes.resize(c + 1, 0);
+        }
+        cpu_nodes[c] = node;
+      }
+
+      // Nodes without available CPUs (e.g. memory-only nodes) keep their
+      // index, so that page counts can be reported by node id
+      node_cpus.push_back(available);
+    }
+
+    // Without NUMA information, all allowed CPUs are on node 0
+    if (node_cpus.empty() && has_mask) {
+      std::vector<int> cpus;
+      for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &allowed)) {
+          cpus.push_back(c);
+        }
+      }
+      node_cpus.push_back(cpus);
+      cpu_nodes.assign(cpus.empty() ? 0 : cpus.back() + 1, 0);
+    }
+#endif
+  }
+};
+
+const Topology& topology() {
+  static Topology topo;
+  return topo;
+}
+
+int current_cpu() {
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+}
+
+int NumaPlacement::n_nodes() {
+  const Topology &topo = topology();
+  int n = 0;
+  for (int i = 0; i < static_cast<int>(topo.node_cpus.size()); ++i) {
+    if (!topo.node_cpus[i].empty()) {
+      n++;
+    }
+  }
+  return std::max(1, n);
+}
+
+int NumaPlacement::cpu_node(int cpu) {
+  const Topology &topo = topology();
+  if (cpu < 0 || cpu >= static_cast<int>(topo.cpu_nodes.size())) {
+    return 0;
+  }
+  return topo.cpu_nodes[cpu];
+}
+
+int NumaPlacement::thread_cpu(int affinity, int thread_index) {
+  const Topology &topo = topology();
+
+  // Nodes that have CPUs, in id order
+  std::vector<const std::vector<int>*> nodes;
+  int n_cpus = 0;
+  for (int i = 0; i < static_cast<int>(topo.node_cpus.size()); ++i) {
+    if (!topo.node_cpus[i].empty()) {
+      nodes.push_back(&topo.node_cpus[i]);
+      n_cpus += topo.node_cpus[i].size();
+    }
+  }
+
+  if (affinity == AFFINITY_NONE || n_cpus == 0 || thread_index < 0) {
+    return -1;
+  }
+
+  // With more threads than CPUs, wrap around
+  int k = thread_index % n_cpus;
+  if (affinity == AFFINITY_COMPACT) {
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+      int n = nodes[i]->size();
+      if (k < n) {
+        return (*nodes[i])[k];
+      }
+      k -= n;
+    }
+  } else if (affinity == AFFINITY_SPREAD) {
+    // Round-robin over nodes, skipping nodes whose CPUs are all used
+    int round = 0;
+    while (true) {
+      for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        if (round < static_cast<int>(nodes[i]->size())) {
+          if (k == 0) {
+            return (*nodes[i])[round];
+          }
+          k--;
+        }
+      }
+      round++;
+    }
+  }
+
+  return -1;
+}
+
+bool NumaPlacement::pin_current_thread(int cpu) {
+  if (cpu < 0) {
+    return true;
+  }
+
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+    std::cerr << "Warning: unable to pin thread to CPU " << cpu << std::endl;
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+void NumaPlacement::pin_threads(int affinity) {
+  if (affinity == AFFINITY_NONE) {
+    return;
+  }
+
+#ifdef USE_OPENMP
+  // Threads of later parallel regions are taken from the same pool, so they
+  // keep their CPUs
+  OMP_PARALLEL
+  {
+    pin_current_thread(thread_cpu(affinity, omp_get_thread_num()));
+  }
+#else
+  pin_current_thread(thread_cpu(affinity, 0));
+#endif
+}
+
+void NumaPlacement::prepare_first_touch() {
+#if defined(__linux__) && defined(__GLIBC__)
+  // glibc raises its mmap threshold after large blocks are freed, and then
+  // serves new arrays from heap pages placed by earlier phases. A fixed
+  // threshold keeps large arrays on fresh pages.
+  mallopt(M_MMAP_THRESHOLD, 256 * 1024);
+#endif
+}
+
+void NumaPlacement::Report::add_array(const std::string &name,
+                                      const void *data, size_t bytes) {
+  const Topology &topo = topology();
+  int n = topo.node_cpus.size();
+  Entry entry;
+  entry.name = name;
+  entry.counts.assign(n + 1, 0);
+
+#ifdef __linux__
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (data && bytes > 0 && page_size > 0) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+    uintptr_t last = reinterpret_cast<uintptr_t>(data) + bytes;
+    std::vector<void*> pages;
+    for (uintptr_t p = first; p < last; p += page_size) {
+      pages.push_back(reinterpret_cast<void*>(p));
+    }
+
+    // With no target nodes, move_pages only reports the node of each page
+    std::vector<int> status(pages.size(), -1);
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), NULL,
+                status.data(), 0) == 0) {
+      for (int i = 0; i < static_cast<int>(status.size()); ++i) {
+        if (status[i] >= 0 && status[i] < n) {
+          entry.counts[status[i]]++;
+        } else {
+          entry.counts[n]++;
+        }
+      }
+    } else {
+      entry.counts[n] = pages.size();
+    }
+  }
+#else
+  (void) data;
+  (void) bytes;
+#endif
+
+  arrays.push_back(entry);
+}
+
+void NumaPlacement::Report::add_threads() {
+  thread_counts.assign(topology().node_cpus.size(), 0);
+
+#ifdef USE_OPENMP
+  std::vector<int> cpus(omp_get_max_threads(), -1);
+  OMP_PARALLEL
+  {
+    cpus[omp_get_thread_num()] = current_cpu();
+  }
+#else
+  std::vector<int> cpus(1, current_cpu());
+#endif
+
+  for (int i = 0; i < static_cast<int>(cpus.size()); ++i) {
+    int node = cpu_node(cpus[i]);
+    if (node < static_cast<int>(thread_counts.size())) {
+      thread_counts[node]++;
+    }
+  }
+}
+
+void NumaPlacement::Report::print() const {
+  int n = topology().node_cpus.size();
+  std::cout << "====== NUMA placement ======" << std::endl;
+  if (!thread_counts.empty()) {
+    std::cout << "Threads per node:";
+    for (int i = 0; i < n; ++i) {
+      std::cout << " " << thread_counts[i];
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << "Pages per node (last column: not yet placed):" << std::endl;
+  for (int i = 0; i < static_cast<int>(arrays.size()); ++i) {
+    std::cout << arrays[i].name << ":";
+    for (int k = 0; k <= n; ++k) {
+      std::cout << " " << arrays[i].counts[k];
+    }
+    std::cout << std::endl;
+  }
+}
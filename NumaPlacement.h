@@ -0,0 +1,97 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef NUMAPLACEMENT_H_
+#define NUMAPLACEMENT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Helpers for running the solvers on machines with several NUMA nodes:
+// pinning threads to CPUs, and finding the node of the pages of an array.
+//
+// The topology is read from /sys on Linux. Elsewhere, a single node is
+// assumed and pinning has no effect.
+class NumaPlacement {
+ public:
+  // Thread affinity policies, as used by the ThreadAffinity option
+  enum Affinity {
+    AFFINITY_NONE = 0,  // Leave placement to the OS (or OMP_PROC_BIND)
+    AFFINITY_COMPACT = 1,  // Fill the CPUs of one node before the next
+    AFFINITY_SPREAD = 2,  // Distribute threads round-robin over the nodes
+    AFFINITY_COUNT = 3
+  };
+
+  // Number of NUMA nodes with CPUs available to this process
+  static int n_nodes();
+
+  // Node of a CPU, or 0 if unknown
+  static int cpu_node(int cpu);
+
+  // CPU for the thread with the given index under an affinity policy, or -1
+  // for no pinning
+  static int thread_cpu(int affinity, int thread_index);
+
+  // Pin the calling thread to a CPU; does nothing for a negative CPU
+  static bool pin_current_thread(int cpu);
+
+  // Pin the threads of OpenMP parallel regions started from the calling
+  // thread. With the task scheduler, pass the policy to its constructor instead.
+  static void pin_threads(int affinity);
+
+  // Serve large allocations with fresh pages from the OS, so that new arrays
+  // are placed by the threads that first write to them, rather than reusing
+  // heap memory already placed by earlier phases
+  static void prepare_first_touch();
+
+  // Per-node page counts of arrays and threads, printed as a table
+  class Report {
+   public:
+    void add_array(const std::string &name, const void *data, size_t bytes);
+
+    // Record the node of each thread of the current parallel backend
+    void add_threads();
+
+    void print() const;
+
+   private:
+    struct Entry {
+      std::string name;
+      std::vector<size_t> counts;  // Pages on each node, then pages not placed yet
+    };
+
+    std::vector<Entry> arrays;
+    std::vector<int> thread_counts;
+  };
+};
+
+#endif /* NUMAPLACEMENT_H_ */
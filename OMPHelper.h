@@ -36,70 +36,312 @@
 #ifdef USE_MSVC
 #define OMP_PARALLEL __pragma(omp parallel)
 #define OMP_FOR __pragma(omp for)
+#define OMP_FOR_RUNTIME __pragma(omp for schedule(runtime))
 #define OMP_SINGLE __pragma(omp single)
 #define OMP_SECTIONS __pragma(omp sections)
 #define OMP_SECTION __pragma(omp section)
 #define OMP_SECTIONS_NOWAIT __pragma(omp sections nowait)
+#define OMP_BARRIER __pragma(omp barrier)
 #else
 #define OMP_PARALLEL _Pragma("omp parallel")
 #define OMP_FOR _Pragma("omp for")
+#define OMP_FOR_RUNTIME _Pragma("omp for schedule(runtime)")
 #define OMP_SINGLE _Pragma("omp single")
 #define OMP_SECTIONS _Pragma("omp sections")
 #define OMP_SECTION _Pragma("omp section")
 #define OMP_SECTIONS_NOWAIT _Pragma("omp sections nowait")
+#define OMP_BARRIER _Pragma("omp barrier")
+#endif
+
+// Loop schedules can be set at run time since OpenMP 3.0
+#if _OPENMP >= 200805
+#define USE_OMP_SCHEDULE
 #endif
 
 #else
-#include <ctime>
+// Without OpenMP, parallel regions are executed by a single thread, and only
+// the loops in them are run in parallel when the task scheduler is used
 #define OMP_PARALLEL
 #define OMP_FOR
+#define OMP_FOR_RUNTIME
 #define OMP_SINGLE
 #define OMP_SECTIONS
 #define OMP_SECTION
 #define OMP_SECTIONS_NOWAIT
+#define OMP_BARRIER
+#endif
+
+#ifdef USE_TASK_SCHEDULER
+#include "TaskScheduler.h"
 #endif
 
 #include <cassert>
+#include <chrono>
+#include <ctime>
+#include <type_traits>
 #include <vector>
 
-class Timer {
+// Parallel loop calling body(i) for i in [begin, end).
+//
+// With OpenMP, it works like OMP_FOR: inside an OMP_PARALLEL region it must be
+// reached by all threads of the team, which share the iterations and wait for
+// each other at the end. With the task scheduler, the iterations are run as
+// range tasks with adaptive splitting on TaskScheduler::current().
+//
+// The loop index has the wider type of begin and end, so that loops over
+// mesh elements use MeshIndex.
+template<typename BeginT, typename EndT, typename Body>
+inline void parallel_for(BeginT begin, EndT end, const Body &body) {
+#ifdef USE_TASK_SCHEDULER
+  TaskScheduler::current().parallel_for(begin, end, body);
+#else
+  typedef typename std::common_type<BeginT, EndT>::type LoopIndex;
+  OMP_FOR
+  for (LoopIndex i = begin; i < end; ++i) {
+    body(i);
+  }
+#endif
+}
+
+// Runs the parallel regions and loops started by the calling thread on that
+// thread alone during its lifetime, if enabled. Used where the overhead of
+// starting and synchronizing threads outweighs the work.
+class SerialScope {
  public:
+  explicit SerialScope(bool enabled)
+      : enabled_(enabled),
+        previous_n_threads_(1) {
+    if (!enabled_) {
+      return;
+    }
 
-  typedef int EventID;
+#ifdef USE_OPENMP
+    previous_n_threads_ = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+#ifdef USE_TASK_SCHEDULER
+    scheduler_.reset(new TaskScheduler(1));
+    scope_.reset(new TaskScheduler::Scope(*scheduler_));
+#endif
+  }
 
-  EventID get_time() {
-    EventID id = time_values_.size();
+  ~SerialScope() {
+    if (!enabled_) {
+      return;
+    }
 
 #ifdef USE_OPENMP
-    time_values_.push_back(omp_get_wtime());
+    omp_set_num_threads(previous_n_threads_);
+#endif
+#ifdef USE_TASK_SCHEDULER
+    scope_.reset();
+    scheduler_.reset();
+#endif
+  }
+
+ private:
+  bool enabled_;
+  int previous_n_threads_;
+#ifdef USE_TASK_SCHEDULER
+  std::unique_ptr<TaskScheduler> scheduler_;
+  std::unique_ptr<TaskScheduler::Scope> scope_;
+#endif
+
+  SerialScope(const SerialScope&);
+  SerialScope& operator=(const SerialScope&);
+};
+
+// Like parallel_for(), but with OpenMP the iterations are shared with the
+// schedule set by the innermost ScheduleScope of the thread that started the
+// parallel region
+template<typename BeginT, typename EndT, typename Body>
+inline void scheduled_parallel_for(BeginT begin, EndT end, const Body &body) {
+#if defined(USE_TASK_SCHEDULER) || !defined(USE_OMP_SCHEDULE)
+  parallel_for(begin, end, body);
+#else
+  typedef typename std::common_type<BeginT, EndT>::type LoopIndex;
+  OMP_FOR_RUNTIME
+  for (LoopIndex i = begin; i < end; ++i) {
+    body(i);
+  }
+#endif
+}
+
+// The loops of the solvers and the operator, written as
+//   PARALLEL_FOR(MeshIndex, i, begin, end) {
+//     ...
+//   } PARALLEL_FOR_END
+// With OpenMP they are plain OMP_FOR loops, so that the body is compiled in
+// place like a hand-written loop; with the task scheduler the body becomes a
+// lambda passed to parallel_for(). The body can therefore neither continue
+// nor return. SCHEDULED_PARALLEL_FOR uses the schedule of
+// scheduled_parallel_for().
+#ifdef USE_TASK_SCHEDULER
+#define PARALLEL_FOR(IndexT, i, begin, end) \
+  parallel_for(begin, end, [&](IndexT i)
+#define SCHEDULED_PARALLEL_FOR(IndexT, i, begin, end) \
+  parallel_for(begin, end, [&](IndexT i)
+#define PARALLEL_FOR_END );
+#else
+#define PARALLEL_FOR(IndexT, i, begin, end) \
+  OMP_FOR \
+  for (IndexT i = begin; i < end; ++i)
+#ifdef USE_OMP_SCHEDULE
+#define SCHEDULED_PARALLEL_FOR(IndexT, i, begin, end) \
+  OMP_FOR_RUNTIME \
+  for (IndexT i = begin; i < end; ++i)
+#else
+#define SCHEDULED_PARALLEL_FOR(IndexT, i, begin, end) \
+  PARALLEL_FOR(IndexT, i, begin, end)
+#endif
+#define PARALLEL_FOR_END
+#endif
+
+// Number of threads that run the parallel loops started by the calling thread
+inline int available_threads() {
+#if defined(USE_TASK_SCHEDULER)
+  return TaskScheduler::current().n_threads();
+#elif defined(USE_OPENMP)
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Number of threads and loop schedule for the parallel loops of a phase
+struct LoopSchedule {
+  enum Kind {
+    STATIC = 0,
+    DYNAMIC = 1,
+    GUIDED = 2,
+    KIND_COUNT = 3
+  };
+
+  int n_threads;  // 0 for the number of threads of the caller
+  int kind;
+  int chunk_size;  // 0 for the default of the schedule kind
+
+  LoopSchedule()
+      : n_threads(0),
+        kind(STATIC),
+        chunk_size(0) {
+  }
+
+  LoopSchedule(int threads, int schedule_kind, int chunk)
+      : n_threads(threads),
+        kind(schedule_kind),
+        chunk_size(chunk) {
+  }
+
+  static const char* kind_name(int kind) {
+    static const char* names[KIND_COUNT] = { "static", "dynamic", "guided" };
+    return (kind >= 0 && kind < KIND_COUNT) ? names[kind] : "unknown";
+  }
+};
+
+// Applies loop schedules to the parallel regions started by the calling
+// thread during its lifetime, starting with the static schedule and the
+// current number of threads, and restores the previous ones at the end.
+// Schedules are ignored where they cannot be set (task scheduler, or OpenMP
+// before 3.0).
+class ScheduleScope {
+ public:
+  ScheduleScope() {
+#ifdef USE_OMP_SCHEDULE
+    previous_n_threads_ = omp_get_max_threads();
+    omp_get_schedule(&previous_kind_, &previous_chunk_size_);
+    omp_set_schedule(omp_sched_static, 0);
+#endif
+  }
+
+  ~ScheduleScope() {
+#ifdef USE_OMP_SCHEDULE
+    omp_set_num_threads(previous_n_threads_);
+    omp_set_schedule(previous_kind_, previous_chunk_size_);
+#endif
+  }
+
+  static bool supported() {
+#if defined(USE_OMP_SCHEDULE) && !defined(USE_TASK_SCHEDULER)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Number of threads available to the schedules
+  int max_threads() const {
+#ifdef USE_OMP_SCHEDULE
+    return previous_n_threads_;
+#else
+    return 1;
+#endif
+  }
+
+  // Set the schedule, with at most max_threads() threads
+  void apply(const LoopSchedule &schedule) {
+#ifdef USE_OMP_SCHEDULE
+    int n_threads = schedule.n_threads;
+    if (n_threads <= 0 || n_threads > previous_n_threads_) {
+      n_threads = previous_n_threads_;
+    }
+    omp_set_num_threads(n_threads);
+
+    static const omp_sched_t kinds[LoopSchedule::KIND_COUNT] = {
+        omp_sched_static, omp_sched_dynamic, omp_sched_guided };
+    omp_set_schedule(kinds[schedule.kind], schedule.chunk_size);
 #else
-    time_values_.push_back(clock());
+    (void) schedule;
 #endif
+  }
+
+ private:
+#ifdef USE_OMP_SCHEDULE
+  int previous_n_threads_;
+  omp_sched_t previous_kind_;
+  int previous_chunk_size_;
+#endif
+
+  ScheduleScope(const ScheduleScope&);
+  ScheduleScope& operator=(const ScheduleScope&);
+};
+
+// Wall time from a monotonic clock, and CPU time of all threads of the
+// process, at each event
+class Timer {
+ public:
+
+  typedef int EventID;
 
+  EventID get_time() {
+    EventID id = time_values_.size();
+    time_values_.push_back(std::chrono::steady_clock::now());
+    cpu_time_values_.push_back(std::clock());
     return id;
   }
 
   double elapsed_time(EventID event1, EventID event2) {
     assert(event1 >= 0 && event1 < static_cast<EventID>(time_values_.size()));
     assert(event2 >= 0 && event2 < static_cast<EventID>(time_values_.size()));
+    return std::chrono::duration<double>(
+        time_values_[event2] - time_values_[event1]).count();
+  }
 
-#ifdef USE_OPENMP
-    return time_values_[event2] - time_values_[event1];
-#else
-    return double(time_values_[event2] - time_values_[event1]) / CLOCKS_PER_SEC;
-#endif
+  double elapsed_cpu_time(EventID event1, EventID event2) {
+    assert(event1 >= 0 && event1 < static_cast<EventID>(time_values_.size()));
+    assert(event2 >= 0 && event2 < static_cast<EventID>(time_values_.size()));
+    return double(cpu_time_values_[event2] - cpu_time_values_[event1])
+        / CLOCKS_PER_SEC;
   }
 
   void reset() {
     time_values_.clear();
+    cpu_time_values_.clear();
   }
 
  private:
-#ifdef USE_OPENMP
-  std::vector<double> time_values_;
-#else
-  std::vector<clock_t> time_values_;
-#endif
+  std::vector<std::chrono::steady_clock::time_point> time_values_;
+  std::vector<std::clock_t> cpu_time_values_;
 };
 
 #endif /* OMPHELPER_H_ */
@@ -133,6 +133,25 @@ class OptionInterpreter {
     return true;
   }
 
+  bool load_value_impl(const std::string &str, long long &value) const {
+    try {
+      value = std::stoll(str);
+    } catch (const std::invalid_argument& ia) {
+      std::cerr << "Invalid argument: " << ia.what() << std::endl;
+      return false;
+    } catch (const std::out_of_range &oor) {
+      std::cerr << "Out of Range error: " << oor.what() << std::endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  bool load_value_impl(const std::string &str, std::string &value) const {
+    std::istringstream istr(str);
+    return static_cast<bool>(istr >> value);
+  }
+
   bool load_value_impl(const std::string &str, bool &value) const {
     int bool_value = 0;
     if (load_value_impl(str, bool_value)) {
@@ -183,7 +202,38 @@ bool Parameters::load(const char* filename) {
         || opt.load_value("GradSolverConvergeCheckFrequency",
                           grad_solver_convergence_check_frequency)
         || opt.load_values("SourceVertices", source_vertices)
-        || opt.load_value("SolverType", solver_type))) {
+        || opt.load_value("SolverType", solver_type)
+        || opt.load_value("PrintProgress", print_progress)
+        || opt.load_value("BatchLoaderThreads", batch_loader_threads)
+        || opt.load_value("BatchSolverThreads", batch_solver_threads)
+        || opt.load_value("BatchWriterThreads", batch_writer_threads)
+        || opt.load_value("BatchQueueCapacity", batch_queue_capacity)
+        || opt.load_value("QuerySchedulerThreads", query_scheduler_threads)
+        || opt.load_value("ResultCacheMegabytes", result_cache_megabytes)
+        || opt.load_value("OperatorStore", operator_store)
+        || opt.load_value("NumaFirstTouch", numa_first_touch)
+        || opt.load_value("ThreadAffinity", thread_affinity)
+        || opt.load_value("HugePages", huge_pages)
+        || opt.load_value("MaxMemoryBytes", max_memory_bytes)
+        || opt.load_value("OutOfCoreDirectory", out_of_core_directory)
+        || opt.load_value("SmallMeshVertices", small_mesh_vertices)
+        || opt.load_value("Autotune", autotune)
+        || opt.load_value("ScheduleProfile", schedule_profile)
+        || opt.load_value("MetricsFile", metrics_file)
+        || opt.load_value("ConvergenceTraceFile", convergence_trace_file)
+        || opt.load_value("ConvergenceTraceCapacity",
+                          convergence_trace_capacity)
+        || opt.load_value("HardwareCounters", hardware_counters)
+        || opt.load_value("EventTraceFile", event_trace_file)
+        || opt.load_value("EventTraceCapacity", event_trace_capacity)
+        || opt.load_value("EventTraceLayerSampling",
+                          event_trace_layer_sampling)
+        || opt.load_value("AccuracyTraceFile", accuracy_trace_file)
+        || opt.load_value("AccuracyReferenceFile", accuracy_reference_file)
+        || opt.load_value("AccuracySampleInterval", accuracy_sample_interval)
+        || opt.load_value("BenchmarkWarmup", benchmark_warmup)
+        || opt.load_value("BenchmarkRepetitions", benchmark_repetitions)
+        || opt.load_value("BenchmarkResultsFile", benchmark_results_file))) {
       std::cerr << "Unable to parse option " << option_str << std::endl;
       return false;
     }
@@ -228,7 +278,7 @@ bool check_upper_bound(const std::string &name, T val, T upper_bound,
 }
 
 bool check_nonempty_index_sequence(const std::string &name,
-                                   const std::vector<int> &seq) {
+                                   const std::vector<MeshIndex> &seq) {
   bool valid = (!seq.empty());
   if (!valid) {
     std::cerr << "Error: " << name << " is empty" << std::endl;
@@ -271,7 +321,33 @@ bool Parameters::valid_parameters() const {
       && check_lower_bound("GradSolverConvergeCheckFrequency",
                            grad_solver_convergence_check_frequency, 0, false)
       && check_nonempty_index_sequence("SourceVertices", source_vertices)
-      && check_solvertype("SolverType", solver_type);
+      && check_solvertype("SolverType", solver_type)
+      && check_lower_bound("BatchLoaderThreads", batch_loader_threads, 0, false)
+      && check_lower_bound("BatchSolverThreads", batch_solver_threads, 0, true)
+      && check_lower_bound("BatchWriterThreads", batch_writer_threads, 0, false)
+      && check_lower_bound("BatchQueueCapacity", batch_queue_capacity, 0, false)
+      && check_lower_bound("QuerySchedulerThreads", query_scheduler_threads, 0,
+                           true)
+      && check_lower_bound("ResultCacheMegabytes", result_cache_megabytes, 0,
+                           true)
+      && check_lower_bound("ThreadAffinity", thread_affinity, 0, true)
+      && check_upper_bound("ThreadAffinity", thread_affinity, 2, true)
+      && check_lower_bound("HugePages", huge_pages, 0, true)
+      && check_upper_bound("HugePages", huge_pages, 2, true)
+      && check_lower_bound("MaxMemoryBytes", max_memory_bytes, 0LL, true)
+      && check_lower_bound("SmallMeshVertices", small_mesh_vertices, 0, true)
+      && check_lower_bound("ConvergenceTraceCapacity",
+                           convergence_trace_capacity, 1, true)
+      && check_lower_bound("HardwareCounters", hardware_counters, 0, true)
+      && check_upper_bound("HardwareCounters", hardware_counters, 2, true)
+      && check_lower_bound("EventTraceCapacity", event_trace_capacity, 1, true)
+      && check_lower_bound("EventTraceLayerSampling",
+                           event_trace_layer_sampling, 1, true)
+      && check_lower_bound("AccuracySampleInterval", accuracy_sample_interval,
+                           1, true)
+      && check_lower_bound("BenchmarkWarmup", benchmark_warmup, 0, true)
+      && check_lower_bound("BenchmarkRepetitions", benchmark_repetitions, 1,
+                           true);
 }
 
 template<typename T>
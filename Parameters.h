@@ -32,6 +32,8 @@
 #ifndef PARAMETERS_H_
 #define PARAMETERS_H_
 
+#include "EigenTypes.h"
+#include <string>
 #include <vector>
 
 struct Parameters {
@@ -44,7 +46,36 @@ struct Parameters {
         penalty(50),
         grad_solver_output_frequency(50),
         grad_solver_convergence_check_frequency(10),
-        solver_type(0) {
+        solver_type(0),
+        print_progress(true),
+        batch_loader_threads(1),
+        batch_solver_threads(0),
+        batch_writer_threads(1),
+        batch_queue_capacity(2),
+        query_scheduler_threads(0),
+        result_cache_megabytes(0),
+        operator_store(),
+        numa_first_touch(false),
+        thread_affinity(0),
+        huge_pages(1),
+        max_memory_bytes(0),
+        out_of_core_directory(),
+        small_mesh_vertices(50000),
+        autotune(false),
+        schedule_profile(),
+        metrics_file(),
+        convergence_trace_file(),
+        convergence_trace_capacity(100000),
+        hardware_counters(0),
+        event_trace_file(),
+        event_trace_capacity(100000),
+        event_trace_layer_sampling(16),
+        accuracy_trace_file(),
+        accuracy_reference_file(),
+        accuracy_sample_interval(50),
+        benchmark_warmup(3),
+        benchmark_repetitions(20),
+        benchmark_results_file() {
     source_vertices.push_back(0);
   }
 
@@ -61,11 +92,113 @@ struct Parameters {
   int grad_solver_convergence_check_frequency;
 
   // Indices for source vertices
-  std::vector<int> source_vertices;
+  std::vector<MeshIndex> source_vertices;
 
   // SolverType. 0 for face based algorithm; 1 for edge based algorithm
   int solver_type;
 
+  // Whether the solver prints its progress and timing to stdout
+  bool print_progress;
+
+  // Parameters for the pipelined batch executor (BatchGeodDistSolver).
+  // batch_solver_threads = 0 assigns all remaining hardware threads to the solver stage.
+  int batch_loader_threads;
+  int batch_solver_threads;
+  int batch_writer_threads;
+  int batch_queue_capacity;  // Maximum number of meshes waiting between two stages
+
+  // Total number of threads used by the query scheduler (GeodDistQueries).
+  // 0 uses all hardware threads.
+  int query_scheduler_threads;
+
+  // Memory budget of the distance result cache used by GeodDistQueries, in megabytes.
+  // 0 disables the cache.
+  int result_cache_megabytes;
+
+  // Location for sharing the mesh operator between worker processes:
+  // "shm:NAME" for a POSIX shared-memory object, or "file:PATH" for a mapped file.
+  // The first process builds the operator there and the others attach to it.
+  // Empty for building a private operator in every process.
+  std::string operator_store;
+
+  // Whether the solver arrays are first written by the threads that later
+  // compute on them, so that their pages are placed on the NUMA nodes of those threads
+  bool numa_first_touch;
+
+  // Pinning of solver threads to CPUs (GeodDistSolver):
+  // 0 for none, 1 for compact (fill one NUMA node first), 2 for spread (round-robin over nodes)
+  int thread_affinity;
+
+  // Pages backing the solver buffers:
+  // 0 for regular pages, 1 for transparent huge pages, 2 for explicit huge pages
+  int huge_pages;
+
+  // Budget in bytes for the solver buffers, 0 for no limit. Lower-memory
+  // variants of the solver are used if needed to fit in it.
+  long long max_memory_bytes;
+
+  // Directory on a fast local drive for keeping the operator and the solver
+  // buffers in memory-mapped temporary files, for meshes whose solver state
+  // exceeds the memory. Empty for keeping them in memory.
+  std::string out_of_core_directory;
+
+  // Meshes with fewer vertices are solved by the calling thread alone and
+  // without progress output during the solve, for low latency. 0 disables it.
+  int small_mesh_vertices;
+
+  // Whether GeodDistSolver benchmarks the number of threads and the OpenMP
+  // loop schedule of each solver phase on the mesh before solving it
+  bool autotune;
+
+  // File with the loop schedules found by autotuning for each solver type and
+  // mesh size; tuned schedules are saved to it, and later solves of meshes of
+  // a similar size use them. Empty for no file.
+  std::string schedule_profile;
+
+  // File to which a JSON record of the timing, convergence and memory use of
+  // each solve is appended, "-" for the standard output. Empty for none.
+  std::string metrics_file;
+
+  // File to which the residuals at each convergence check of a solve are
+  // appended, in CSV if it ends with .csv and in binary otherwise. Empty for
+  // none.
+  std::string convergence_trace_file;
+
+  // Number of residual records kept per solve; older ones are overwritten
+  int convergence_trace_capacity;
+
+  // Hardware event counters around each solver phase: 0 for TLB misses only
+  // (with PrintProgress), 1 for cycles, instructions, cache misses, TLB
+  // misses and stalled cycles, 2 for these also per thread in the metrics
+  int hardware_counters;
+
+  // File to which the phases, sampled BFS layers, iterations and loop shares
+  // of the threads of each solve are added as a Chrome trace. Empty for none.
+  std::string event_trace_file;
+
+  // Number of events kept for each thread per solve; older ones are
+  // overwritten
+  int event_trace_capacity;
+
+  // Every this many BFS layers, a layer and the loop shares of the threads in
+  // it are recorded in the event trace
+  int event_trace_layer_sampling;
+
+  // File to which the error of the distances against the reference distances
+  // in accuracy_reference_file is appended, for the initial gradients, every
+  // accuracy_sample_interval ADMM iterations and the final result of each
+  // solve, with the time to reach them. Empty for none.
+  std::string accuracy_trace_file;
+  std::string accuracy_reference_file;
+  int accuracy_sample_interval;
+
+  // Parameters for the kernel benchmarks (paraheat_bench): the number of
+  // untimed and timed runs of each kernel, and the CSV file to which the
+  // statistics are appended (empty for none)
+  int benchmark_warmup;
+  int benchmark_repetitions;
+  std::string benchmark_results_file;
+
   // Load options from file
   bool load(const char* filename);
 
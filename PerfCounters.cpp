@@ -0,0 +1,317 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const kEventNames[PerfCounters::EVENT_COUNT] = { "cycles",
+    "instructions", "llc_misses", "dtlb_load_misses",
+    "stalled_cycles_frontend", "stalled_cycles_backend" };
+
+}
+
+const char* PerfCounters::event_name(int event) {
+  return (event >= 0 && event < EVENT_COUNT) ? kEventNames[event] : "unknown";
+}
+
+PerfCounters::PerfCounters() {
+}
+
+PerfCounters::~PerfCounters() {
+  close();
+}
+
+void PerfCounters::open(bool hardware_events) {
+  close();
+
+#ifdef __linux__
+  DIR *dir = opendir("/proc/self/task");
+  if (dir == NULL) {
+    return;
+  }
+
+  while (dirent *entry = readdir(dir)) {
+    int tid = std::atoi(entry->d_name);
+    if (tid > 0) {
+      tids.push_back(tid);
+    }
+  }
+  closedir(dir);
+  std::sort(tids.begin(), tids.end());
+
+  for (int event = 0; event < EVENT_COUNT; ++event) {
+    if (!hardware_events && event != DTLB_LOAD_MISSES) {
+      continue;
+    }
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (event) {
+      case CYCLES:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case INSTRUCTIONS:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case LLC_MISSES:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+      case DTLB_LOAD_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+      case STALLED_CYCLES_FRONTEND:
+        attr.config = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND;
+        break;
+      case STALLED_CYCLES_BACKEND:
+        attr.config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+        break;
+    }
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+
+    std::vector<int> &fds = event_fds[event];
+    for (int i = 0; i < static_cast<int>(tids.size()); ++i) {
+      int fd = syscall(SYS_perf_event_open, &attr, tids[i], -1, -1, 0);
+      if (fd < 0) {
+        // Not supported here; report no count rather than a partial one
+        for (int k = 0; k < static_cast<int>(fds.size()); ++k) {
+          ::close(fds[k]);
+        }
+        fds.clear();
+        break;
+      }
+      fds.push_back(fd);
+    }
+  }
+#else
+  (void) hardware_events;
+#endif
+}
+
+void PerfCounters::close() {
+  for (int event = 0; event < EVENT_COUNT; ++event) {
+#ifdef __linux__
+    for (int i = 0; i < static_cast<int>(event_fds[event].size()); ++i) {
+      ::close(event_fds[event][i]);
+    }
+#endif
+    event_fds[event].clear();
+  }
+  tids.clear();
+}
+
+long long PerfCounters::read_count(int fd) {
+#ifdef __linux__
+  unsigned long long values[3];  // Count, time enabled, time running
+  if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+    return 0;
+  }
+
+  if (values[2] < values[1]) {
+    return static_cast<long long>(double(values[0]) * double(values[1])
+        / double(values[2]));
+  }
+  return static_cast<long long>(values[0]);
+#else
+  (void) fd;
+  return 0;
+#endif
+}
+
+PerfCounters::Sample PerfCounters::sample(bool per_thread) const {
+  Sample s;
+  s.minor_page_faults = 0;
+  s.major_page_faults = 0;
+  s.resident_bytes = -1;
+  s.peak_resident_bytes = -1;
+  s.storage_read_bytes = -1;
+  s.storage_written_bytes = -1;
+  storage_io(s.storage_read_bytes, s.storage_written_bytes);
+
+  if (per_thread) {
+    s.thread_events.assign(tids.size() * EVENT_COUNT, -1);
+  }
+  for (int event = 0; event < EVENT_COUNT; ++event) {
+    const std::vector<int> &fds = event_fds[event];
+    s.events[event] = fds.empty() ? -1 : 0;
+    for (int i = 0; i < static_cast<int>(fds.size()); ++i) {
+      long long count = read_count(fds[i]);
+      s.events[event] += count;
+      if (per_thread) {
+        s.thread_events[i * EVENT_COUNT + event] = count;
+      }
+    }
+  }
+
+#ifdef __linux__
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    s.minor_page_faults = usage.ru_minflt;
+    s.major_page_faults = usage.ru_majflt;
+  }
+
+  FILE *status = std::fopen("/proc/self/status", "r");
+  if (status != NULL) {
+    char line[256];
+    long long kb = 0;
+    while (std::fgets(line, sizeof(line), status)) {
+      if (std::sscanf(line, "VmRSS: %lld kB", &kb) == 1) {
+        s.resident_bytes = kb * 1024;
+      } else if (std::sscanf(line, "VmHWM: %lld kB", &kb) == 1) {
+        s.peak_resident_bytes = kb * 1024;
+      }
+    }
+    std::fclose(status);
+  }
+#endif
+
+  return s;
+}
+
+bool PerfCounters::storage_io(long long &read_bytes,
+                              long long &written_bytes) {
+  bool found = false;
+#ifdef __linux__
+  FILE *io = std::fopen("/proc/self/io", "r");
+  if (io != NULL) {
+    char line[256];
+    long long value = 0;
+    while (std::fgets(line, sizeof(line), io)) {
+      if (std::sscanf(line, "read_bytes: %lld", &value) == 1) {
+        read_bytes = value;
+        found = true;
+      } else if (std::sscanf(line, "write_bytes: %lld", &value) == 1) {
+        written_bytes = value;
+      }
+    }
+    std::fclose(io);
+  }
+#else
+  (void) read_bytes;
+  (void) written_bytes;
+#endif
+
+  return found;
+}
+
+bool PerfCounters::reset_peak_resident() {
+#ifdef __linux__
+  // Writing 5 to clear_refs resets VmHWM to VmRSS (Linux 4.0 and later)
+  FILE *clear_refs = std::fopen("/proc/self/clear_refs", "w");
+  if (clear_refs != NULL) {
+    bool written = std::fputs("5", clear_refs) >= 0;
+    return (std::fclose(clear_refs) == 0) && written;
+  }
+#endif
+  return false;
+}
+
+void PerfCounters::print(const std::vector<const char*> &phase_names,
+                         const std::vector<Sample> &samples) {
+  for (int i = 0; i < static_cast<int>(phase_names.size())
+      && i + 1 < static_cast<int>(samples.size()); ++i) {
+    const Sample &s0 = samples[i], &s1 = samples[i + 1];
+    std::cout << phase_names[i] << ": "
+              << s1.minor_page_faults - s0.minor_page_faults
+              << " minor page faults, "
+              << s1.major_page_faults - s0.major_page_faults
+              << " major page faults, ";
+    long long counts[EVENT_COUNT];
+    for (int event = 0; event < EVENT_COUNT; ++event) {
+      counts[event] =
+          (s0.events[event] >= 0 && s1.events[event] >= 0) ?
+              s1.events[event] - s0.events[event] : -1;
+    }
+
+    if (counts[DTLB_LOAD_MISSES] >= 0) {
+      std::cout << counts[DTLB_LOAD_MISSES] << " dTLB load misses";
+    } else {
+      std::cout << "dTLB load misses not available";
+    }
+
+    if (counts[CYCLES] >= 0) {
+      std::cout << ", " << counts[CYCLES] << " cycles";
+    }
+    if (counts[INSTRUCTIONS] >= 0) {
+      std::cout << ", " << counts[INSTRUCTIONS] << " instructions";
+      if (counts[CYCLES] > 0) {
+        std::cout << " (" << double(counts[INSTRUCTIONS]) / counts[CYCLES]
+                  << " per cycle)";
+      }
+    }
+    if (counts[LLC_MISSES] >= 0) {
+      std::cout << ", " << counts[LLC_MISSES] << " last-level cache misses";
+    }
+    if (counts[STALLED_CYCLES_FRONTEND] >= 0) {
+      std::cout << ", " << counts[STALLED_CYCLES_FRONTEND]
+                << " cycles stalled in the frontend";
+    }
+    if (counts[STALLED_CYCLES_BACKEND] >= 0) {
+      std::cout << ", " << counts[STALLED_CYCLES_BACKEND]
+                << " cycles stalled in the backend";
+    }
+
+    if (s1.resident_bytes >= 0) {
+      std::cout << ", resident " << s1.resident_bytes << " bytes at the end"
+                << " (peak so far " << s1.peak_resident_bytes << " bytes)";
+    }
+
+    if (s0.storage_read_bytes >= 0 && s1.storage_read_bytes >= 0) {
+      std::cout << ", storage read "
+                << s1.storage_read_bytes - s0.storage_read_bytes
+                << " bytes and written "
+                << s1.storage_written_bytes - s0.storage_written_bytes
+                << " bytes";
+    }
+    std::cout << std::endl;
+  }
+}
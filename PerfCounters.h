@@ -0,0 +1,127 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <vector>
+
+// Process-wide counts of memory and processor events, sampled between solver
+// phases.
+//
+// Resident memory is read from /proc/self/status: the current size, and the
+// peak size so far, which shows the phase that sets the peak of the process.
+// Storage I/O is read from /proc/self/io, and counts the bytes the process
+// caused to be read from or written to block devices, including page-ins and
+// write-back of mapped files.
+// Page faults are read from getrusage() and cover all threads. Hardware events
+// (TLB misses, and with open(true) also cycles, instructions, last-level
+// cache misses and stalled cycles) are read from Linux perf events opened on
+// every thread that exists when the counters are opened; threads started
+// afterwards are counted with the thread that starts them. Counts are scaled
+// up when the kernel multiplexes the events. An event is not available if the
+// kernel or the virtual machine does not expose it, or if
+// /proc/sys/kernel/perf_event_paranoid forbids it.
+class PerfCounters {
+ public:
+  enum Event {
+    CYCLES = 0,
+    INSTRUCTIONS = 1,
+    LLC_MISSES = 2,
+    DTLB_LOAD_MISSES = 3,
+    STALLED_CYCLES_FRONTEND = 4,
+    STALLED_CYCLES_BACKEND = 5,
+    EVENT_COUNT = 6
+  };
+
+  static const char* event_name(int event);
+
+  struct Sample {
+    long long minor_page_faults;
+    long long major_page_faults;
+    long long events[EVENT_COUNT];  // -1 if not available
+    long long resident_bytes;  // -1 if not available
+    long long peak_resident_bytes;  // -1 if not available
+    long long storage_read_bytes;  // -1 if not available
+    long long storage_written_bytes;  // -1 if not available
+
+    // EVENT_COUNT counts for each of thread_ids(), if sampled per thread
+    std::vector<long long> thread_events;
+  };
+
+  PerfCounters();
+  ~PerfCounters();
+
+  // Open the TLB miss counters on all threads of the process, and the other
+  // hardware events if asked
+  void open(bool hardware_events = false);
+  void close();
+
+  bool has_event(int event) const {
+    return !event_fds[event].empty();
+  }
+
+  bool has_dtlb_misses() const {
+    return has_event(DTLB_LOAD_MISSES);
+  }
+
+  // Threads on which the counters are open, in increasing order
+  const std::vector<int>& thread_ids() const {
+    return tids;
+  }
+
+  Sample sample(bool per_thread = false) const;
+
+  // Bytes read from and written to storage by the process so far; false if
+  // not available
+  static bool storage_io(long long &read_bytes, long long &written_bytes);
+
+  // Reset the peak resident memory of the process to the current size, so
+  // that later samples show the peak of the work since; false if the kernel
+  // does not support it
+  static bool reset_peak_resident();
+
+  // Print the events between consecutive samples, one line per phase
+  static void print(const std::vector<const char*> &phase_names,
+                    const std::vector<Sample> &samples);
+
+ private:
+  std::vector<int> tids;
+  std::vector<int> event_fds[EVENT_COUNT];  // One per thread, if available
+
+  // Count of an event, scaled up for the time it was not scheduled
+  static long long read_count(int fd);
+
+  PerfCounters(const PerfCounters&);
+  PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif /* PERFCOUNTERS_H_ */
@@ -0,0 +1,155 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "QueryScheduler.h"
+#include "DistanceFile.h"
+#include "GetRSS.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// Read the query file. Each non-comment line contains the source vertices of
+// one query, separated by whitespace.
+bool load_queries(const char *file_name,
+                  std::vector<std::vector<MeshIndex> > &queries) {
+  std::ifstream ifile(file_name);
+  if (!ifile.is_open()) {
+    std::cerr << "Error while opening file " << file_name << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(ifile, line)) {
+    std::string::size_type pos = line.find_first_not_of(" \t\r");
+    if (pos == std::string::npos || line.at(pos) == '#') {
+      continue;
+    }
+
+    std::istringstream istr(line);
+    std::vector<MeshIndex> sources;
+    MeshIndex v = 0;
+    while (istr >> v) {
+      sources.push_back(v);
+    }
+
+    if (sources.empty()) {
+      std::cerr << "Error parsing query: " << line << std::endl;
+      return false;
+    }
+
+    queries.push_back(sources);
+  }
+
+  if (queries.empty()) {
+    std::cerr << "Error: no query in " << file_name << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 4 && argc != 5) {
+    std::cerr
+        << "Usage: GeodDistQueries PARAMETERS_FILE MESH_FILE QUERY_FILE [OUTPUT_PREFIX]"
+        << std::endl;
+    return 1;
+  }
+
+  Parameters param;
+  if (!param.load(argv[1])) {
+    std::cerr << "Error: unable to load parameter file" << std::endl;
+    return 1;
+  }
+  param.output_options();
+
+  std::vector<std::vector<MeshIndex> > queries;
+  if (!load_queries(argv[3], queries)) {
+    std::cerr << "Error: unable to load query file" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Reading triangle mesh......" << std::endl;
+  GeodesicOperator op;
+  if (!op.build(argv[2], param.operator_store)) {
+    std::cerr << "Error: unable to build operator for mesh " << argv[2]
+              << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<DistanceCache> cache;
+  if (param.result_cache_megabytes > 0) {
+    cache.reset(
+        new DistanceCache(std::size_t(param.result_cache_megabytes) << 20));
+  }
+
+  int n_failed = 0;
+  {
+    QueryScheduler scheduler(op, param, param.query_scheduler_threads,
+                             cache.get(), argv[2]);
+
+    std::vector<std::future<SharedDistance> > results;
+    for (int i = 0; i < static_cast<int>(queries.size()); ++i) {
+      results.push_back(scheduler.submit(queries[i]));
+    }
+
+    for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+      SharedDistance dist = results[i].get();
+      if (!dist) {
+        std::cerr << "Error: query " << i << " failed" << std::endl;
+        n_failed++;
+        continue;
+      }
+
+      if (argc == 5) {
+        std::ostringstream file_name;
+        file_name << argv[4] << i << ".txt";
+        if (!DistanceFile::save(file_name.str().c_str(), *dist)) {
+          std::cerr << "Error in saving geodesic distance" << std::endl;
+          n_failed++;
+        }
+      }
+    }
+
+    scheduler.print_statistics();
+  }
+
+  if (cache) {
+    cache->print_statistics();
+  }
+
+  size_t peak_mem = getPeakRSS();
+  std::cout << "Peak memory usage in bytes: " << peak_mem << std::endl;
+
+  return n_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "QueryScheduler.h"
+#include "FaceBasedGeodesicSolver.h"
+#include "EdgeBasedGeodesicSolver.h"
+#include "OMPHelper.h"
+#include <algorithm>
+#include <iostream>
+
+// Below this number of vertices per thread, adding threads to a single solve
+// gives little speedup, because the BFS layers become too thin
+static const int kMinVerticesPerThread = 10000;
+
+QueryScheduler::QueryScheduler(const GeodesicOperator &geod_op,
+                               const Parameters &para, int n_threads,
+                               DistanceCache *result_cache,
+                               const std::string &mesh_name)
+    : op(geod_op),
+      param(para),
+      n_total_threads(n_threads),
+      thread_cap(1),
+      cache(result_cache),
+      mesh_id(mesh_name),
+      n_running(0),
+      n_threads_in_use(0),
+      stopping(false),
+      max_running(0),
+      n_cache_hits(0),
+      has_submission(false) {
+  param.print_progress = false;  // Output of concurrent solves would interleave
+
+  if (n_total_threads <= 0) {
+    n_total_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  thread_cap = static_cast<int>(std::max<MeshIndex>(
+      1, std::min<MeshIndex>(n_total_threads,
+                             op.n_vertices / kMinVerticesPerThread)));
+
+  // A worker for each possible concurrent solve, down to one thread per solve
+  for (int i = 0; i < n_total_threads; ++i) {
+    workers.push_back(std::thread(&QueryScheduler::worker_loop, this));
+  }
+}
+
+QueryScheduler::~QueryScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+
+  work_available.notify_all();
+  for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+    workers[i].join();
+  }
+}
+
+std::future<SharedDistance> QueryScheduler::submit(
+    const std::vector<MeshIndex> &source_vertices) {
+  std::unique_ptr<Query> query(new Query());
+  query->source_vertices = source_vertices;
+  std::sort(query->source_vertices.begin(), query->source_vertices.end());
+  query->source_vertices.erase(
+      std::unique(query->source_vertices.begin(),
+                  query->source_vertices.end()),
+      query->source_vertices.end());
+  query->submit_time = Clock::now();
+  std::future<SharedDistance> result = query->result.get_future();
+
+  if (cache) {
+    query->cache_key = DistanceCache::make_key(mesh_id, query->source_vertices,
+                                               param);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!has_submission) {
+      has_submission = true;
+      first_submit_time = query->submit_time;
+    }
+
+    queue.push_back(std::move(query));
+  }
+
+  work_available.notify_one();
+  return result;
+}
+
+void QueryScheduler::wait_idle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this]() {return queue.empty() && n_running == 0;});
+}
+
+int QueryScheduler::choose_team_size(int n_pending) const {
+  // Share the threads among pending queries, but never use more threads for
+  // one query than the mesh size allows
+  int team_size = std::max(1, n_total_threads / std::max(1, n_pending));
+  return std::min(team_size, thread_cap);
+}
+
+void QueryScheduler::worker_loop() {
+  while (true) {
+    std::unique_ptr<Query> query;
+    SharedDistance cached_dist;
+    int team_size = 0;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_available.wait(
+          lock,
+          [this]() {
+            return stopping
+            || (!queue.empty() && n_threads_in_use < n_total_threads);
+          });
+
+      if (queue.empty()) {
+        return;  // Stopping, and no query left
+      }
+
+      query = std::move(queue.front());
+      queue.pop_front();
+
+      // The cache is checked when the query is dispatched rather than when it
+      // is submitted, so that repeated queries waiting in the queue can reuse
+      // the result of an earlier one
+      if (cache) {
+        cached_dist = cache->find(query->cache_key);
+      }
+
+      if (cached_dist) {
+        Clock::time_point end_time = Clock::now();
+        latencies.push_back(
+            std::chrono::duration<double>(end_time - query->submit_time)
+                .count());
+        solve_times.push_back(0);
+        team_sizes.push_back(0);
+        last_complete_time = std::max(last_complete_time, end_time);
+        n_cache_hits++;
+      } else {
+        int n_pending = queue.size() + n_running + 1;
+        team_size = std::min(choose_team_size(n_pending),
+                             n_total_threads - n_threads_in_use);
+        n_running++;
+        n_threads_in_use += team_size;
+        max_running = std::max(max_running, n_running);
+      }
+    }
+
+    if (cached_dist) {
+      query->result.set_value(cached_dist);
+      idle.notify_all();
+      continue;
+    }
+
+#ifdef USE_OPENMP
+    omp_set_num_threads(team_size);
+#elif defined(USE_TASK_SCHEDULER)
+    TaskScheduler team(team_size);
+    TaskScheduler::Scope team_scope(team);
+#endif
+
+    Clock::time_point start_time = Clock::now();
+    std::shared_ptr<DenseVector> dist(new DenseVector());
+    SharedDistance result;
+    if (run_solver(query->source_vertices, *dist)) {
+      result = dist;
+      if (cache) {
+        cache->insert(query->cache_key, result);
+      }
+    }
+    Clock::time_point end_time = Clock::now();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      n_running--;
+      n_threads_in_use -= team_size;
+      latencies.push_back(
+          std::chrono::duration<double>(end_time - query->submit_time).count());
+      solve_times.push_back(
+          std::chrono::duration<double>(end_time - start_time).count());
+      team_sizes.push_back(team_size);
+      last_complete_time = std::max(last_complete_time, end_time);
+    }
+
+    query->result.set_value(result);
+    work_available.notify_all();
+    idle.notify_all();
+  }
+}
+
+bool QueryScheduler::run_solver(const std::vector<MeshIndex> &source_vertices,
+                                DenseVector &dist) {
+  Parameters query_param = param;
+  query_param.source_vertices = source_vertices;
+
+  if (query_param.source_vertices.empty()) {
+    std::cerr << "Error: query without source vertices" << std::endl;
+    return false;
+  }
+
+  if (param.solver_type == 0) {
+    FaceBasedGeodesicSolver solver;
+    if (!solver.solve(op, query_param)) {
+      return false;
+    }
+    dist = solver.get_distance_values();
+  } else {
+    EdgeBasedGeodesicSolver solver;
+    if (!solver.solve(op, query_param)) {
+      return false;
+    }
+    dist = solver.get_distance_values();
+  }
+
+  return true;
+}
+
+void QueryScheduler::print_statistics() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  int n_completed = latencies.size();
+  std::cout << std::endl;
+  std::cout << "====== Query scheduler ======" << std::endl;
+  std::cout << "Total threads: " << n_total_threads
+            << ", max threads per query: " << thread_cap << std::endl;
+  std::cout << "Completed queries: " << n_completed << " (" << n_cache_hits
+            << " from cache)" << std::endl;
+  if (n_completed == 0) {
+    return;
+  }
+
+  double wall_time = std::chrono::duration<double>(
+      last_complete_time - first_submit_time).count();
+  std::vector<double> sorted_latencies = latencies;
+  std::sort(sorted_latencies.begin(), sorted_latencies.end());
+
+  // Solve time and team size are averaged over the queries that ran the solver
+  int n_solved = n_completed - n_cache_hits;
+  double mean_latency = 0, mean_solve_time = 0, mean_team_size = 0;
+  for (int i = 0; i < n_completed; ++i) {
+    mean_latency += latencies[i];
+    mean_solve_time += solve_times[i];
+    mean_team_size += team_sizes[i];
+  }
+  mean_latency /= n_completed;
+  mean_solve_time /= std::max(1, n_solved);
+  mean_team_size /= std::max(1, n_solved);
+
+  std::cout << "Wall time: " << wall_time << " seconds" << std::endl;
+  std::cout << "Throughput: " << (wall_time > 0 ? n_completed / wall_time : 0)
+            << " queries per second" << std::endl;
+  std::cout << "Latency (seconds): mean " << mean_latency << ", median "
+            << sorted_latencies[n_completed / 2] << ", 95th percentile "
+            << sorted_latencies[std::min(n_completed - 1,
+                                         (n_completed * 95) / 100)]
+            << ", max " << sorted_latencies.back() << std::endl;
+  std::cout << "Mean solve time: " << mean_solve_time << " seconds"
+            << std::endl;
+  std::cout << "Mean threads per query: " << mean_team_size
+            << ", max concurrent queries: " << max_running << std::endl;
+}
@@ -0,0 +1,125 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef QUERYSCHEDULER_H_
+#define QUERYSCHEDULER_H_
+
+#include "EigenTypes.h"
+#include "GeodesicOperator.h"
+#include "Parameters.h"
+#include "DistanceCache.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs concurrent distance queries against one shared, read-only operator.
+//
+// Each query is solved with a team of threads: OpenMP threads, or a private
+// task scheduler with the task backend. Small meshes and thin BFS layers do
+// not scale to many threads, so instead of running queries one after another
+// on all threads, the scheduler runs several of them at once with fewer
+// threads each. The team size of a query is chosen when it starts,
+// from the mesh size (which bounds the useful number of threads per solve) and
+// the number of pending queries (which are given a fair share of the threads).
+//
+// If a cache is given, repeated queries are answered from it without running
+// the solver, and new results are added to it.
+class QueryScheduler {
+ public:
+  // n_threads is the total number of threads for all queries; 0 uses all
+  // hardware threads. mesh_id identifies the mesh of the operator in the
+  // cache keys. The operator and the cache must outlive the scheduler.
+  QueryScheduler(const GeodesicOperator &op, const Parameters &para,
+                 int n_threads = 0, DistanceCache *cache = NULL,
+                 const std::string &mesh_id = "");
+
+  ~QueryScheduler();
+
+  // Queue a query for the given source vertices. The future provides the
+  // distance values, or a null pointer if the solver failed.
+  std::future<SharedDistance> submit(const std::vector<MeshIndex> &source_vertices);
+
+  // Block until all submitted queries are completed
+  void wait_idle();
+
+  // Print throughput and latency of the completed queries
+  void print_statistics();
+
+  // Maximum number of threads that a single query uses on this mesh
+  int max_threads_per_solve() const {
+    return thread_cap;
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Query {
+    std::vector<MeshIndex> source_vertices;
+    std::string cache_key;
+    std::promise<SharedDistance> result;
+    Clock::time_point submit_time;
+  };
+
+  const GeodesicOperator &op;
+  Parameters param;
+  int n_total_threads;
+  int thread_cap;
+  DistanceCache *cache;
+  std::string mesh_id;
+
+  std::deque<std::unique_ptr<Query> > queue;
+  int n_running;
+  int n_threads_in_use;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable work_available, idle;
+  std::vector<std::thread> workers;
+
+  // Statistics of completed queries
+  std::vector<double> latencies, solve_times;
+  std::vector<int> team_sizes;
+  int max_running;
+  int n_cache_hits;
+  bool has_submission;
+  Clock::time_point first_submit_time, last_complete_time;
+
+  void worker_loop();
+  int choose_team_size(int n_pending) const;
+  bool run_solver(const std::vector<MeshIndex> &source_vertices, DenseVector &dist);
+};
+
+#endif /* QUERYSCHEDULER_H_ */
@@ -0,0 +1,535 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "RegressionGate.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+const int kSchemaVersion = 1;
+
+// Scales a median absolute deviation to a standard deviation, for normally
+// distributed times
+const double kDeviationScale = 1.4826;
+
+// Minimal JSON reader for the baseline file: objects, arrays, strings,
+// numbers, booleans and null
+struct JsonValue {
+  enum Type {
+    NONE,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT
+  };
+
+  Type type;
+  double number;
+  std::string string;
+  std::vector<JsonValue> elements;
+  std::map<std::string, JsonValue> members;
+
+  JsonValue()
+      : type(NONE),
+        number(0) {
+  }
+
+  const JsonValue& operator[](const std::string &name) const {
+    static const JsonValue none;
+    std::map<std::string, JsonValue>::const_iterator it = members.find(name);
+    return it == members.end() ? none : it->second;
+  }
+
+  double number_or(double value) const {
+    return type == NUMBER ? number : value;
+  }
+};
+
+class JsonReader {
+ public:
+  explicit JsonReader(const std::string &text)
+      : text_(text),
+        pos_(0) {
+  }
+
+  bool read(JsonValue &value) {
+    return read_value(value) && (skip_space(), pos_ == text_.size());
+  }
+
+ private:
+  const std::string &text_;
+  size_t pos_;
+
+  void skip_space() {
+    while (pos_ < text_.size() && std::isspace((unsigned char) text_[pos_])) {
+      pos_++;
+    }
+  }
+
+  bool expect(char c) {
+    skip_space();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool read_literal(const char *literal) {
+    size_t n = std::char_traits<char>::length(literal);
+    if (text_.compare(pos_, n, literal) != 0) {
+      return false;
+    }
+    pos_ += n;
+    return true;
+  }
+
+  bool read_string(std::string &str) {
+    if (!expect('"')) {
+      return false;
+    }
+    str.clear();
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      char c = text_[pos_++];
+      if (c == '\\') {
+        if (pos_ >= text_.size()) {
+          return false;
+        }
+        c = text_[pos_++];
+        if (c == 'u') {
+          // Only the control characters written by the baseline writer
+          if (pos_ + 4 > text_.size()) {
+            return false;
+          }
+          c = char(std::strtol(text_.substr(pos_, 4).c_str(), NULL, 16));
+          pos_ += 4;
+        } else if (c == 'n') {
+          c = '\n';
+        } else if (c == 't') {
+          c = '\t';
+        }
+      }
+      str += c;
+    }
+    return expect('"');
+  }
+
+  bool read_value(JsonValue &value) {
+    skip_space();
+    if (pos_ >= text_.size()) {
+      return false;
+    }
+
+    char c = text_[pos_];
+    if (c == '{') {
+      value.type = JsonValue::OBJECT;
+      pos_++;
+      if (expect('}')) {
+        return true;
+      }
+      do {
+        std::string name;
+        if (!read_string(name) || !expect(':')
+            || !read_value(value.members[name])) {
+          return false;
+        }
+      } while (expect(','));
+      return expect('}');
+    } else if (c == '[') {
+      value.type = JsonValue::ARRAY;
+      pos_++;
+      if (expect(']')) {
+        return true;
+      }
+      do {
+        value.elements.push_back(JsonValue());
+        if (!read_value(value.elements.back())) {
+          return false;
+        }
+      } while (expect(','));
+      return expect(']');
+    } else if (c == '"') {
+      value.type = JsonValue::STRING;
+      return read_string(value.string);
+    } else if (c == 't' || c == 'f') {
+      value.type = JsonValue::BOOLEAN;
+      value.number = (c == 't');
+      return read_literal(c == 't' ? "true" : "false");
+    } else if (c == 'n') {
+      value.type = JsonValue::NONE;
+      return read_literal("null");
+    }
+
+    const char *begin = text_.c_str() + pos_;
+    char *end = NULL;
+    value.type = JsonValue::NUMBER;
+    value.number = std::strtod(begin, &end);
+    pos_ += end - begin;
+    return end != begin;
+  }
+};
+
+void write_string(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = str[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      const char *hex = "0123456789abcdef";
+      out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+const char* status_name(bool enforced, bool passed) {
+  return !enforced ? "info" : (passed ? "ok" : "REGRESSED");
+}
+
+}
+
+RegressionGate::Host RegressionGate::current_host() {
+  Host h;
+  h.n_threads = std::max(1u, std::thread::hardware_concurrency());
+  h.backend = ScalingStudy::backend_name();
+
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      std::string::size_type colon = line.find(':');
+      if (colon != std::string::npos) {
+        std::string::size_type begin = line.find_first_not_of(" \t",
+                                                              colon + 1);
+        h.cpu = (begin == std::string::npos) ? "" : line.substr(begin);
+      }
+      break;
+    }
+  }
+  if (h.cpu.empty()) {
+    h.cpu = "unknown";
+  }
+
+  return h;
+}
+
+std::string RegressionGate::Entry::key() const {
+  std::ostringstream ostr;
+  ostr << mesh << " (" << scaling << "), " << params << ", " << solver
+       << " solver, " << n_threads << " threads";
+  return ostr.str();
+}
+
+RegressionGate::Entry RegressionGate::make_entry(
+    const ScalingStudy::Run &run) {
+  Entry e;
+  e.mesh = run.mesh;
+  e.scaling = run.weak ? "weak" : "strong";
+  e.params = run.params;
+  e.solver = run.solver_type == 0 ? "face" : "edge";
+  e.n_threads = run.n_threads;
+  e.n_vertices = run.n_vertices;
+  e.n_faces = run.n_faces;
+  e.total_seconds = run.total_seconds;
+  e.total_deviation_seconds = run.total_deviation_seconds;
+  e.peak_resident_bytes = run.peak_resident_bytes;
+  e.mean_relative_error = run.mean_relative_error;
+  e.reference = (run.mean_relative_error < 0) ? "none" :
+      (run.exact_reference ? "exact" : "converged");
+  return e;
+}
+
+bool RegressionGate::load(const std::string &file_name) {
+  std::ifstream ifile(file_name.c_str());
+  if (!ifile.is_open()) {
+    std::cerr << "Error while opening file " << file_name << std::endl;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << ifile.rdbuf();
+  std::string text = buffer.str();
+
+  JsonValue root;
+  if (!JsonReader(text).read(root) || root.type != JsonValue::OBJECT
+      || root["schema"].number_or(0) != kSchemaVersion) {
+    std::cerr << "Error: invalid baseline file " << file_name << std::endl;
+    return false;
+  }
+
+  const JsonValue &h = root["host"];
+  host.cpu = h["cpu"].string;
+  host.n_threads = int(h["threads"].number_or(0));
+  host.backend = h["backend"].string;
+
+  const JsonValue &t = root["tolerances"];
+  Tolerances defaults;
+  tolerances.time = t["time"].number_or(defaults.time);
+  tolerances.noise = t["noise"].number_or(defaults.noise);
+  tolerances.memory = t["memory"].number_or(defaults.memory);
+  tolerances.memory_bytes = (long long) t["memory_bytes"].number_or(
+      double(defaults.memory_bytes));
+  tolerances.error = t["error"].number_or(defaults.error);
+  tolerances.retries = int(t["retries"].number_or(defaults.retries));
+
+  entries.clear();
+  const std::vector<JsonValue> &runs = root["runs"].elements;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const JsonValue &r = runs[i];
+    Entry e;
+    e.mesh = r["mesh"].string;
+    e.scaling = r["scaling"].string;
+    e.params = r["params"].string;
+    e.solver = r["solver"].string;
+    e.n_threads = int(r["threads"].number_or(0));
+    e.n_vertices = (long long) r["vertices"].number_or(-1);
+    e.n_faces = (long long) r["faces"].number_or(-1);
+    e.total_seconds = r["total_seconds"].number_or(-1);
+    e.total_deviation_seconds = r["total_deviation_seconds"].number_or(0);
+    e.peak_resident_bytes = (long long) r["peak_resident_bytes"].number_or(-1);
+    e.mean_relative_error = r["mean_relative_error"].number_or(-1);
+    e.reference = r["reference"].string;
+    entries.push_back(e);
+  }
+
+  return true;
+}
+
+void RegressionGate::update(const std::vector<ScalingStudy::Run> &runs) {
+  host = current_host();
+  entries.clear();
+  for (size_t i = 0; i < runs.size(); ++i) {
+    if (runs[i].success && runs[i].n_threads <= host.n_threads) {
+      entries.push_back(make_entry(runs[i]));
+    }
+  }
+}
+
+bool RegressionGate::save(const std::string &file_name) const {
+  std::ofstream ofile(file_name.c_str());
+  if (!ofile.is_open()) {
+    std::cerr << "Error: unable to open baseline file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  ofile << "{\"schema\":" << kSchemaVersion << ",\n\"host\":{\"cpu\":";
+  write_string(ofile, host.cpu);
+  ofile << ",\"threads\":" << host.n_threads << ",\"backend\":";
+  write_string(ofile, host.backend);
+  ofile << "},\n\"tolerances\":{\"time\":" << tolerances.time << ",\"noise\":"
+        << tolerances.noise << ",\"memory\":" << tolerances.memory
+        << ",\"memory_bytes\":" << tolerances.memory_bytes << ",\"error\":"
+        << tolerances.error << ",\"retries\":" << tolerances.retries
+        << "},\n\"runs\":[";
+  ofile.precision(std::numeric_limits<double>::digits10 + 2);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Entry &e = entries[i];
+    ofile << (i > 0 ? ",\n" : "\n") << "{\"mesh\":";
+    write_string(ofile, e.mesh);
+    ofile << ",\"scaling\":\"" << e.scaling << "\",\"params\":";
+    write_string(ofile, e.params);
+    ofile << ",\"solver\":\"" << e.solver << "\",\"threads\":" << e.n_threads
+          << ",\"vertices\":" << e.n_vertices << ",\"faces\":" << e.n_faces
+          << ",\"total_seconds\":" << e.total_seconds
+          << ",\"total_deviation_seconds\":" << e.total_deviation_seconds
+          << ",\"peak_resident_bytes\":" << e.peak_resident_bytes
+          << ",\"mean_relative_error\":" << e.mean_relative_error
+          << ",\"reference\":\"" << e.reference << "\"}";
+  }
+  ofile << "\n]}\n";
+
+  ofile.flush();
+  if (!ofile) {
+    std::cerr << "Error: unable to write baseline file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool RegressionGate::check(const std::vector<ScalingStudy::Run> &runs,
+                           bool *time_only) const {
+  Host this_host = current_host();
+  bool compare_time = (this_host == host);
+  if (!compare_time) {
+    std::cout << "TIME CHECKS SKIPPED: the baseline was recorded on another "
+              << "host (" << host.cpu << ", " << host.n_threads
+              << " threads, " << host.backend << ") than this one ("
+              << this_host.cpu << ", " << this_host.n_threads << " threads, "
+              << this_host.backend << "); update the baseline on this host "
+              << "to check times" << std::endl;
+  }
+  std::cout << "Errors are against the exact distance (error) or against a "
+            << "stored converged solution (self-error, a self-consistency "
+            << "check)" << std::endl;
+
+  bool passed = true, time_passed_all = true;
+  char header[128], line[512];
+  std::snprintf(header, sizeof(header), "%-10s %16s %16s %16s  %s",
+                "quantity", "baseline", "current", "limit", "status");
+  std::vector<bool> found(entries.size(), false);
+  for (size_t i = 0; i < runs.size(); ++i) {
+    Entry current = make_entry(runs[i]);
+    std::cout << std::endl << current.key() << std::endl;
+    if (!runs[i].success) {
+      std::cout << "  FAILED: the solve did not complete" << std::endl;
+      passed = false;
+      continue;
+    }
+
+    size_t k = 0;
+    while (k < entries.size() && entries[k].key() != current.key()) {
+      k++;
+    }
+    if (k == entries.size()) {
+      std::cout << "  not in the baseline" << std::endl;
+      continue;
+    }
+    found[k] = true;
+    const Entry &base = entries[k];
+    std::cout << "  " << header << std::endl;
+
+    // Time, with the noise of both measurements
+    double deviation = kDeviationScale
+        * std::max(base.total_deviation_seconds,
+                   current.total_deviation_seconds);
+    double time_limit = base.total_seconds
+        + std::max(tolerances.time * base.total_seconds,
+                   tolerances.noise * deviation);
+    bool time_passed = current.total_seconds <= time_limit;
+    std::snprintf(line, sizeof(line), "%-10s %16.6f %16.6f %16.6f  %s",
+                  "seconds", base.total_seconds, current.total_seconds,
+                  time_limit,
+                  compare_time ? status_name(true, time_passed) : "skipped");
+    std::cout << "  " << line << std::endl;
+    time_passed_all = time_passed_all && (time_passed || !compare_time);
+
+    // Peak memory, if measured in both
+    bool compare_memory = base.peak_resident_bytes >= 0
+        && current.peak_resident_bytes >= 0;
+    double memory_limit = double(base.peak_resident_bytes)
+        * (1 + tolerances.memory) + double(tolerances.memory_bytes);
+    bool memory_passed = double(current.peak_resident_bytes) <= memory_limit;
+    std::snprintf(line, sizeof(line), "%-10s %16lld %16lld %16.0f  %s",
+                  "memory", base.peak_resident_bytes,
+                  current.peak_resident_bytes, memory_limit,
+                  status_name(compare_memory, memory_passed));
+    std::cout << "  " << line << std::endl;
+    passed = passed && (memory_passed || !compare_memory);
+
+    // Error, which must not increase beyond rounding
+    if (base.mean_relative_error >= 0) {
+      double error_limit = base.mean_relative_error * (1 + tolerances.error);
+      bool error_passed = current.mean_relative_error >= 0
+          && current.mean_relative_error <= error_limit;
+      std::snprintf(line, sizeof(line), "%-10s %16.8g %16.8g %16.8g  %s",
+                    current.reference == "exact" ? "error" : "self-error",
+                    base.mean_relative_error,
+                    current.mean_relative_error, error_limit,
+                    status_name(true, error_passed));
+      std::cout << "  " << line << std::endl;
+      passed = passed && error_passed;
+    }
+  }
+
+  for (size_t k = 0; k < entries.size(); ++k) {
+    if (!found[k] && entries[k].n_threads > this_host.n_threads) {
+      std::cout << std::endl << entries[k].key() << std::endl
+                << "  skipped: more threads than the " << this_host.n_threads
+                << " hardware threads of this host" << std::endl;
+    } else if (!found[k]) {
+      std::cout << std::endl << entries[k].key() << std::endl
+                << "  MISSING: in the baseline but not run" << std::endl;
+      passed = false;
+    }
+  }
+
+  if (time_only) {
+    *time_only = passed && !time_passed_all;
+  }
+  passed = passed && time_passed_all;
+  std::cout << std::endl << "Regression check "
+            << (passed ? "passed" : "FAILED")
+            << (compare_time ? "" : ", times not checked on this host")
+            << std::endl;
+  return passed;
+}
+
+bool RegressionGate::run_and_check(ScalingStudy &study) const {
+  study.run();
+  std::vector<ScalingStudy::Run> runs = study.runs();
+  bool time_only = false;
+  for (int attempt = 0; !check(runs, &time_only); ++attempt) {
+    if (!time_only || attempt >= tolerances.retries) {
+      return false;
+    }
+
+    std::cout << std::endl << "Running the study again to rule out noise ("
+              << attempt + 1 << " of " << tolerances.retries << ")"
+              << std::endl;
+    study.run();
+    const std::vector<ScalingStudy::Run> &retry = study.runs();
+    for (size_t i = 0; i < runs.size() && i < retry.size(); ++i) {
+      ScalingStudy::Run &run = runs[i];
+      const ScalingStudy::Run &other = retry[i];
+      if (!other.success) {
+        run.success = false;
+        continue;
+      }
+      if (other.total_seconds < run.total_seconds) {
+        run.total_seconds = other.total_seconds;
+        run.total_deviation_seconds = other.total_deviation_seconds;
+      }
+      run.peak_resident_bytes = std::max(run.peak_resident_bytes,
+                                         other.peak_resident_bytes);
+      run.mean_relative_error = std::max(run.mean_relative_error,
+                                         other.mean_relative_error);
+    }
+  }
+
+  return true;
+}
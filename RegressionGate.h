@@ -0,0 +1,145 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef REGRESSIONGATE_H_
+#define REGRESSIONGATE_H_
+
+#include "ScalingStudy.h"
+#include <string>
+#include <vector>
+
+// Performance regression check of the runs of a fixed study against a
+// baseline stored as JSON:
+//   {"schema":1,
+//    "host":{"cpu":"...","threads":8,"backend":"openmp"},
+//    "tolerances":{"time":0.1,"noise":4,"memory":0.05,
+//                  "memory_bytes":4194304,"error":1e-06,"retries":2},
+//    "runs":[{"mesh":"...","scaling":"strong","params":"...","solver":"face",
+//             "threads":1,"vertices":...,"faces":...,"total_seconds":...,
+//             "total_deviation_seconds":...,"peak_resident_bytes":...,
+//             "mean_relative_error":...,"reference":"exact"}, ...]}
+// A run regresses if
+//   * its time exceeds the baseline time by more than the larger of the time
+//     tolerance (a fraction) and the noise factor times the larger median
+//     absolute deviation of the two, scaled to a standard deviation;
+//   * its peak resident memory exceeds the baseline by more than the memory
+//     tolerance (a fraction) plus memory_bytes;
+//   * its mean relative error exceeds the baseline error by more than the
+//     error tolerance (a fraction), which only absorbs rounding differences.
+//     The reference is the exact distance ("exact"), or a converged solution
+//     stored in a file ("converged"), which makes the error a self-consistency
+//     check of the solvers rather than a measure of their accuracy.
+// A check that fails on time alone is repeated up to retries more times, taking the faster
+// time but the larger memory and error of each run over the attempts, so that
+// a burst of load on the machine does not fail the check.
+// Times are only compared on the host of the baseline (same CPU model, number
+// of hardware threads and parallel backend); elsewhere they are reported as
+// skipped without failing the check. Runs with more threads than the hardware
+// threads of the host are neither stored nor checked. The tolerances are kept when the baseline is
+// updated, so they can be adjusted in the file.
+class RegressionGate {
+ public:
+  struct Tolerances {
+    double time;
+    double noise;
+    double memory;
+    long long memory_bytes;
+    double error;
+    int retries;
+
+    Tolerances()
+        : time(0.1),
+          noise(4),
+          memory(0.05),
+          memory_bytes(4 << 20),
+          error(1e-6),
+          retries(2) {
+    }
+  };
+
+  // Identity of the machine, for deciding whether times are comparable
+  struct Host {
+    std::string cpu;
+    int n_threads;
+    std::string backend;
+
+    bool operator==(const Host &other) const {
+      return cpu == other.cpu && n_threads == other.n_threads
+          && backend == other.backend;
+    }
+  };
+
+  static Host current_host();
+
+  // Read the baseline; false if the file is missing or invalid
+  bool load(const std::string &file_name);
+
+  // Replace the runs of the baseline by those of the study, on this host
+  void update(const std::vector<ScalingStudy::Run> &runs);
+
+  bool save(const std::string &file_name) const;
+
+  // Compare the runs of the study with the baseline and print the result of
+  // each check; false if any run regressed, failed or is missing, with
+  // time_only set if only times regressed
+  bool check(const std::vector<ScalingStudy::Run> &runs,
+             bool *time_only = NULL) const;
+
+  // Run the study and check it, with the retries of the tolerances
+  bool run_and_check(ScalingStudy &study) const;
+
+ private:
+  // The quantities of a run stored in the baseline
+  struct Entry {
+    std::string mesh;
+    std::string scaling;
+    std::string params;
+    std::string solver;
+    int n_threads;
+    long long n_vertices, n_faces;
+    double total_seconds;
+    double total_deviation_seconds;
+    long long peak_resident_bytes;
+    double mean_relative_error;
+    std::string reference;  // "exact", "converged" or "none"
+
+    std::string key() const;
+  };
+
+  static Entry make_entry(const ScalingStudy::Run &run);
+
+  Host host;
+  Tolerances tolerances;
+  std::vector<Entry> entries;
+};
+
+#endif /* REGRESSIONGATE_H_ */
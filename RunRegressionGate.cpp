@@ -0,0 +1,86 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "RegressionGate.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+  bool update = (argc == 4 && std::strcmp(argv[3], "--update") == 0);
+  if (argc != 3 && !update) {
+    std::cerr << "Usage: paraheat_regress STUDY_FILE BASELINE_FILE [--update]"
+              << std::endl;
+    return 1;
+  }
+
+  ScalingStudy study;
+  if (!study.load(argv[1])) {
+    std::cerr << "Error: unable to load study file" << std::endl;
+    return 1;
+  }
+
+  // Runs with more threads than the machine has would only measure the
+  // oversubscription
+  int n_hw_threads = RegressionGate::current_host().n_threads;
+  int n_dropped = study.limit_threads(n_hw_threads);
+  if (n_dropped > 0) {
+    std::cout << "Skipping " << n_dropped << " thread count"
+              << (n_dropped > 1 ? "s" : "") << " of the study above the "
+              << n_hw_threads << " hardware threads of this host" << std::endl;
+  }
+
+  // The tolerances of an existing baseline are kept on update
+  RegressionGate gate;
+  bool has_baseline = std::ifstream(argv[2]).good();
+  if ((has_baseline || !update) && !gate.load(argv[2]) && !update) {
+    std::cerr << "Error: unable to load baseline file" << std::endl;
+    return 1;
+  }
+
+  if (!update) {
+    return gate.run_and_check(study) ? 0 : 1;
+  }
+
+  if (!study.run()) {
+    std::cerr << "Error: some runs of the study failed, baseline not updated"
+              << std::endl;
+    return 1;
+  }
+
+  gate.update(study.runs());
+  if (!gate.save(argv[2])) {
+    return 1;
+  }
+  std::cout << "Baseline written to " << argv[2] << std::endl;
+  return 0;
+}
@@ -0,0 +1,529 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "ScalingStudy.h"
+#include "FaceBasedGeodesicSolver.h"
+#include "EdgeBasedGeodesicSolver.h"
+#include "DistanceError.h"
+#include "DistanceFile.h"
+#include "NumaPlacement.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+double median(std::vector<double> values) {
+  if (values.empty()) {
+    return -1;
+  }
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+const char* solver_name(int solver_type) {
+  return solver_type == 0 ? "face" : "edge";
+}
+
+// Speedup of a run against the base run of its group, scaled by the growth
+// of the problem for weak scaling
+double speedup(double base_seconds, double seconds, int base_threads,
+               int n_threads, bool weak) {
+  if (base_seconds <= 0 || seconds <= 0) {
+    return 0;
+  }
+  double s = base_seconds / seconds;
+  return weak ? s * double(n_threads) / double(base_threads) : s;
+}
+
+}
+
+ScalingStudy::ScalingStudy()
+    : repetitions(1) {
+}
+
+bool ScalingStudy::load(const std::string &file_name) {
+  std::ifstream ifile(file_name.c_str());
+  if (!ifile.is_open()) {
+    std::cerr << "Error while opening file " << file_name << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(ifile, line)) {
+    line_number++;
+    std::string::size_type pos = line.find_first_not_of(" \t\r");
+    if (pos == std::string::npos || line.at(pos) == '#') {
+      continue;
+    }
+
+    std::istringstream istr(line);
+    std::string key;
+    istr >> key;
+    bool valid = true;
+    if (key == "mesh" || key == "weak") {
+      MeshEntry entry;
+      entry.weak = (key == "weak");
+      valid = static_cast<bool>(istr >> entry.name);
+      istr >> entry.reference_file;
+      std::vector<MeshGenerator::Spec> specs;
+      if (entry.weak && !(MeshGenerator::parse(entry.name, specs)
+          && specs.size() == 1)) {
+        valid = false;
+      }
+      meshes.push_back(entry);
+    } else if (key == "params") {
+      std::string param_file;
+      Parameters param;
+      valid = (istr >> param_file) && param.load(param_file.c_str());
+      param.print_progress = false;
+      param_files.push_back(param_file);
+      param_sets.push_back(param);
+    } else if (key == "solvers" || key == "threads") {
+      std::vector<int> &values =
+          (key == "solvers") ? solver_types : thread_counts;
+      int value = 0;
+      while (istr >> value) {
+        values.push_back(value);
+        valid = valid && value >= (key == "solvers" ? 0 : 1)
+            && (key == "threads" || value <= 1);
+      }
+      valid = valid && !values.empty();
+    } else if (key == "repetitions") {
+      valid = (istr >> repetitions) && repetitions > 0;
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      std::cerr << "Error parsing line " << line_number << " of " << file_name
+                << std::endl;
+      return false;
+    }
+  }
+
+  if (meshes.empty()) {
+    std::cerr << "Error: no mesh listed in " << file_name << std::endl;
+    return false;
+  }
+
+  if (param_sets.empty()) {
+    std::cerr << "Error: no parameter file listed in " << file_name
+              << std::endl;
+    return false;
+  }
+
+  if (solver_types.empty()) {
+    solver_types.push_back(0);
+    solver_types.push_back(1);
+  }
+
+  if (thread_counts.empty()) {
+    int n_hw_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int n = 1; n < n_hw_threads; n *= 2) {
+      thread_counts.push_back(n);
+    }
+    thread_counts.push_back(n_hw_threads);
+  }
+
+  return true;
+}
+
+int ScalingStudy::limit_threads(int max_threads) {
+  std::vector<int> kept;
+  for (size_t k = 0; k < thread_counts.size(); ++k) {
+    if (thread_counts[k] <= max_threads) {
+      kept.push_back(thread_counts[k]);
+    }
+  }
+  int n_dropped = thread_counts.size() - kept.size();
+  if (kept.empty()) {
+    kept.push_back(max_threads);
+  }
+  thread_counts.swap(kept);
+  return n_dropped;
+}
+
+bool ScalingStudy::run() {
+  runs_.clear();
+  bool success = true;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const MeshEntry &entry = meshes[i];
+    std::vector<MeshGenerator::Spec> specs;
+    bool synthetic = MeshGenerator::parse(entry.name, specs)
+        && specs.size() == 1;
+
+    // Weak scaling solves a mesh grown with the threads for each thread count
+    std::vector<std::vector<int> > thread_groups;
+    if (entry.weak) {
+      for (size_t k = 0; k < thread_counts.size(); ++k) {
+        thread_groups.push_back(std::vector<int>(1, thread_counts[k]));
+      }
+    } else {
+      thread_groups.push_back(thread_counts);
+    }
+
+    for (size_t k = 0; k < thread_groups.size(); ++k) {
+      GeodesicOperator op;
+      Matrix3X points;
+      MeshGenerator::Spec spec = MeshGenerator::Spec();
+      std::string mesh_name = entry.name;
+      bool built = false;
+      if (synthetic) {
+        spec = specs[0];
+        if (entry.weak) {
+          spec.n_faces *= thread_groups[k][0];
+        }
+        mesh_name = MeshGenerator::name(spec);
+
+        Matrix3Xi faces;
+        MeshGenerator::generate(spec, points, faces);
+        surface_mesh::Surface_mesh mesh;
+        built = MeshGenerator::build(points, faces, mesh) && op.build(mesh);
+      } else {
+        built = op.build(entry.name.c_str());
+      }
+
+      if (!built) {
+        std::cerr << "Error: unable to load mesh " << mesh_name << std::endl;
+        success = false;
+        break;
+      }
+
+      std::cout << "Mesh " << mesh_name << ": " << op.n_vertices
+                << " vertices, " << op.n_faces << " faces" << std::endl;
+      success = run_mesh(entry, op, synthetic ? &spec : NULL, points,
+                         thread_groups[k])
+          && success;
+    }
+  }
+
+  return success;
+}
+
+bool ScalingStudy::run_mesh(const MeshEntry &entry, const GeodesicOperator &op,
+                            const MeshGenerator::Spec *spec,
+                            const Matrix3X &points,
+                            const std::vector<int> &n_threads) {
+  bool success = true;
+  for (size_t p = 0; p < param_sets.size(); ++p) {
+    const Parameters &param = param_sets[p];
+
+    // Reference distance for the sources of the parameter set
+    DenseVector reference;
+    bool has_reference = false;
+    if (!entry.reference_file.empty()) {
+      has_reference = DistanceFile::load(entry.reference_file.c_str(),
+                                         reference);
+      if (!has_reference || reference.size() != op.n_vertices) {
+        std::cerr << "Error: invalid reference distance file "
+                  << entry.reference_file << std::endl;
+        return false;
+      }
+    } else if (spec) {
+      has_reference = MeshGenerator::exact_distance(*spec, points,
+                                                    param.source_vertices,
+                                                    reference);
+    }
+    if (!has_reference) {
+      reference.resize(0);
+    }
+
+    for (size_t s = 0; s < solver_types.size(); ++s) {
+      for (size_t t = 0; t < n_threads.size(); ++t) {
+        Run run;
+        run.mesh = entry.name;
+        run.weak = entry.weak;
+        run.params = param_files[p];
+        run.solver_type = solver_types[s];
+        run.n_vertices = op.n_vertices;
+        run.n_faces = op.n_faces;
+        run.exact_reference = entry.reference_file.empty();
+
+        Parameters run_param = param;
+        run_param.solver_type = solver_types[s];
+        run.success =
+            (run_param.solver_type == 0) ?
+                run_solver<FaceBasedGeodesicSolver>(op, run_param, reference,
+                                                    n_threads[t], run) :
+                run_solver<EdgeBasedGeodesicSolver>(op, run_param, reference,
+                                                    n_threads[t], run);
+        if (!run.success) {
+          std::cerr << "Error: " << solver_name(run.solver_type)
+                    << " solver failed on " << entry.name << " with "
+                    << n_threads[t] << " threads" << std::endl;
+          success = false;
+        }
+        runs_.push_back(run);
+      }
+    }
+  }
+
+  return success;
+}
+
+template<typename SolverT>
+bool ScalingStudy::run_solver(const GeodesicOperator &op,
+                              const Parameters &param,
+                              const DenseVector &reference, int n_threads,
+                              Run &run) {
+#ifdef USE_OPENMP
+  int previous_n_threads = omp_get_max_threads();
+  omp_set_num_threads(n_threads);
+  NumaPlacement::pin_threads(param.thread_affinity);
+#elif defined(USE_TASK_SCHEDULER)
+  TaskScheduler pool(n_threads, param.thread_affinity);
+  TaskScheduler::Scope pool_scope(pool);
+#else
+  // Without a parallel backend every run uses the calling thread alone
+  (void) n_threads;
+#endif
+  run.n_threads = available_threads();
+
+  std::vector<double> seconds[SolveMetrics::PHASE_COUNT], total_seconds;
+  run.peak_resident_bytes = -1;
+  run.mean_relative_error = -1;
+  bool success = true;
+  for (int r = 0; r < repetitions && success; ++r) {
+    PerfCounters::reset_peak_resident();
+    SolverT solver;
+    success = solver.solve(op, param);
+    if (!success) {
+      break;
+    }
+
+    const SolveMetrics &metrics = solver.get_metrics();
+    double total = 0;
+    for (int i = kFirstPhase; i < SolveMetrics::PHASE_COUNT; ++i) {
+      seconds[i].push_back(metrics.phases[i].wall_seconds);
+      total += metrics.phases[i].wall_seconds;
+    }
+    total_seconds.push_back(total);
+    run.heat_iterations = metrics.heat_iterations;
+    run.admm_iterations = metrics.admm_iterations;
+    run.peak_resident_bytes = std::max(
+        run.peak_resident_bytes,
+        PerfCounters().sample().peak_resident_bytes);
+
+    if (reference.size() == op.n_vertices) {
+      run.mean_relative_error = DistanceError::mean_relative_error(
+          solver.get_distance_values(), reference, param.source_vertices);
+    }
+  }
+
+#ifdef USE_OPENMP
+  omp_set_num_threads(previous_n_threads);
+#endif
+
+  run.phase_seconds[SolveMetrics::LOAD] = 0;
+  for (int i = kFirstPhase; i < SolveMetrics::PHASE_COUNT; ++i) {
+    run.phase_seconds[i] = median(seconds[i]);
+  }
+  run.total_seconds = median(total_seconds);
+  for (size_t r = 0; r < total_seconds.size(); ++r) {
+    total_seconds[r] = std::fabs(total_seconds[r] - run.total_seconds);
+  }
+  run.total_deviation_seconds = median(total_seconds);
+  if (!success) {
+    run.heat_iterations = run.admm_iterations = -1;
+  }
+
+  return success;
+}
+
+bool ScalingStudy::append_table(const std::string &file_name) const {
+  bool new_file = !std::ifstream(file_name.c_str()).good();
+  std::ofstream ofile(file_name.c_str(), std::ios::app);
+  if (!ofile.is_open()) {
+    std::cerr << "Error: unable to open scaling results file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  ofile.precision(9);
+  if (new_file) {
+    ofile << "mesh,scaling,params,solver,backend,threads,vertices,faces,"
+          << "repetitions,success";
+    for (int i = kFirstPhase; i < SolveMetrics::PHASE_COUNT; ++i) {
+      ofile << "," << SolveMetrics::phase_name(i) << "_seconds";
+    }
+    ofile << ",total_seconds,heat_iterations,admm_iterations,"
+          << "peak_resident_bytes,mean_relative_error\n";
+  }
+
+  for (size_t k = 0; k < runs_.size(); ++k) {
+    const Run &run = runs_[k];
+    ofile << run.mesh << "," << (run.weak ? "weak" : "strong") << ","
+          << run.params << "," << solver_name(run.solver_type) << ","
+          << backend_name() << "," << run.n_threads << "," << run.n_vertices
+          << "," << run.n_faces << "," << repetitions << ","
+          << (run.success ? 1 : 0);
+    for (int i = kFirstPhase; i < SolveMetrics::PHASE_COUNT; ++i) {
+      ofile << "," << run.phase_seconds[i];
+    }
+    ofile << "," << run.total_seconds << "," << run.heat_iterations << ","
+          << run.admm_iterations << "," << run.peak_resident_bytes << ","
+          << run.mean_relative_error << "\n";
+  }
+
+  ofile.flush();
+  if (!ofile) {
+    std::cerr << "Error: unable to write scaling results file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void ScalingStudy::print_summary() const {
+  char line[512];
+
+  // Runs of the same mesh, parameter set and solver type form a group, with
+  // the run with the fewest threads as base
+  std::vector<bool> printed(runs_.size(), false);
+  for (size_t k = 0; k < runs_.size(); ++k) {
+    if (printed[k]) {
+      continue;
+    }
+
+    std::vector<size_t> group;
+    for (size_t j = k; j < runs_.size(); ++j) {
+      const Run &a = runs_[k], &b = runs_[j];
+      if (!printed[j] && b.success && a.mesh == b.mesh && a.weak == b.weak
+          && a.params == b.params && a.solver_type == b.solver_type) {
+        group.push_back(j);
+        printed[j] = true;
+      }
+    }
+    if (group.empty()) {
+      continue;
+    }
+
+    const Run *base = &runs_[group[0]];
+    for (size_t j = 1; j < group.size(); ++j) {
+      if (runs_[group[j]].n_threads < base->n_threads) {
+        base = &runs_[group[j]];
+      }
+    }
+
+    std::cout << std::endl << "====== " << (base->weak ? "Weak" : "Strong")
+              << " scaling: " << base->mesh << ", " << base->params << ", "
+              << solver_name(base->solver_type) << " solver, "
+              << backend_name() << " (speedup / efficiency) ======"
+              << std::endl;
+    std::snprintf(line, sizeof(line), "%7s %10s", "threads", "total(s)");
+    std::cout << line;
+    for (int i = kFirstPhase; i < SolveMetrics::PHASE_COUNT; ++i) {
+      std::snprintf(line, sizeof(line), " %14s", SolveMetrics::phase_name(i));
+      std::cout << line;
+    }
+    std::snprintf(line, sizeof(line), " %14s %10s", "total", "error");
+    std::cout << line << std::endl;
+
+    for (size_t j = 0; j < group.size(); ++j) {
+      const Run &run = runs_[group[j]];
+      std::snprintf(line, sizeof(line), "%7d %10.4f", run.n_threads,
+                    run.total_seconds);
+      std::cout << line;
+      for (int i = kFirstPhase; i <= SolveMetrics::PHASE_COUNT; ++i) {
+        bool total = (i == SolveMetrics::PHASE_COUNT);
+        double s = speedup(
+            total ? base->total_seconds : base->phase_seconds[i],
+            total ? run.total_seconds : run.phase_seconds[i], base->n_threads,
+            run.n_threads, run.weak);
+        double efficiency = s * double(base->n_threads) / double(run.n_threads);
+        std::snprintf(line, sizeof(line), " %6.2fx / %3.0f%%", s,
+                      efficiency * 100);
+        std::cout << line;
+      }
+      if (run.mean_relative_error >= 0) {
+        std::snprintf(line, sizeof(line), " %9.4f%%",
+                      run.mean_relative_error * 100);
+      } else {
+        std::snprintf(line, sizeof(line), " %10s", "-");
+      }
+      std::cout << line << std::endl;
+    }
+  }
+
+  // Solver types on the same mesh, parameter set and number of threads
+  if (solver_types.size() < 2) {
+    return;
+  }
+  std::cout << std::endl << "====== Solver comparison (time in s, error)"
+            << " ======" << std::endl;
+  for (size_t k = 0; k < runs_.size(); ++k) {
+    const Run &a = runs_[k];
+    if (!a.success || a.solver_type != solver_types[0]) {
+      continue;
+    }
+
+    std::ostringstream ostr;
+    ostr << a.mesh << (a.weak ? " (weak)" : "") << ", " << a.params << ", "
+         << a.n_threads << " threads:";
+    const Run *fastest = &a;
+    for (size_t j = 0; j < runs_.size(); ++j) {
+      const Run &b = runs_[j];
+      if (b.success && a.mesh == b.mesh && a.weak == b.weak
+          && a.params == b.params && a.n_threads == b.n_threads
+          && a.n_faces == b.n_faces) {
+        ostr << " " << solver_name(b.solver_type) << " " << b.total_seconds;
+        if (b.mean_relative_error >= 0) {
+          ostr << " (" << b.mean_relative_error * 100 << "%)";
+        }
+        if (b.total_seconds < fastest->total_seconds) {
+          fastest = &b;
+        }
+      }
+    }
+    std::cout << ostr.str() << ", fastest: " << solver_name(fastest->solver_type)
+              << std::endl;
+  }
+}
+
+const char* ScalingStudy::backend_name() {
+#if defined(USE_TASK_SCHEDULER)
+  return "tasks";
+#elif defined(USE_OPENMP)
+  return "openmp";
+#else
+  return "serial";
+#endif
+}
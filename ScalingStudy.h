@@ -0,0 +1,137 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef SCALINGSTUDY_H_
+#define SCALINGSTUDY_H_
+
+#include "GeodesicOperator.h"
+#include "MeshGenerator.h"
+#include "Parameters.h"
+#include "SolveMetrics.h"
+#include <string>
+#include <vector>
+
+// Strong and weak scaling of the solvers, over a matrix of meshes, parameter
+// sets, solver types and thread counts. The study is read from a text file
+// with one setting per line, and lines starting with '#' are comments:
+//   mesh MESH [REFERENCE_DISTANCE_FILE]
+//       strong scaling on a mesh file or a synthetic mesh (see MeshGenerator)
+//   weak KIND:FACES[:shuffled]
+//       weak scaling on synthetic meshes with FACES faces per thread
+//   params PARAMETERS_FILE
+//   solvers SOLVER_TYPE ...     (default: 0 1)
+//   threads N_THREADS ...       (default: 1, 2, 4, ... and all threads)
+//   repetitions N               (default: 1)
+// Every mesh is solved with every parameter set (at least one), solver type
+// and number of threads, the given number of times. The SolverType of the
+// parameter sets is ignored, and their progress output is turned off.
+// The error is measured against the reference distance file of the mesh, or
+// against the exact distance for synthetic meshes that have it.
+class ScalingStudy {
+ public:
+  // Solver phases of a run, as in SolveMetrics
+  static const int kFirstPhase = SolveMetrics::BFS;
+
+  struct Run {
+    std::string mesh;  // For weak scaling, the specification per thread
+    bool weak;
+    std::string params;
+    int solver_type;
+    int n_threads;
+    MeshIndex n_vertices, n_faces;
+    bool success;
+
+    // Medians over the repetitions, of each phase and of their sum, and the
+    // median absolute deviation of the sum as a measure of the noise
+    double phase_seconds[SolveMetrics::PHASE_COUNT];
+    double total_seconds;
+    double total_deviation_seconds;
+
+    int heat_iterations, admm_iterations;
+    long long peak_resident_bytes;  // -1 if not available
+    double mean_relative_error;  // -1 without a reference
+    bool exact_reference;  // Error against the exact distance, not a file
+  };
+
+  ScalingStudy();
+
+  bool load(const std::string &file_name);
+
+  // Drop the thread counts above max_threads, or use max_threads if all are
+  // above it. Returns the number of thread counts dropped.
+  int limit_threads(int max_threads);
+
+  // Run the whole study; false if any run failed
+  bool run();
+
+  const std::vector<Run>& runs() const {
+    return runs_;
+  }
+
+  // Append the runs to a CSV file, with a header if the file is new
+  bool append_table(const std::string &file_name) const;
+
+  // Speedup and parallel efficiency of each phase against the fewest threads,
+  // and the comparison of the solver types
+  void print_summary() const;
+
+  // Parallel backend the solvers are built with
+  static const char* backend_name();
+
+ private:
+  struct MeshEntry {
+    std::string name;
+    std::string reference_file;
+    bool weak;
+  };
+
+  std::vector<MeshEntry> meshes;
+  std::vector<std::string> param_files;
+  std::vector<Parameters> param_sets;
+  std::vector<int> solver_types;
+  std::vector<int> thread_counts;
+  int repetitions;
+
+  std::vector<Run> runs_;
+
+  // Solve the mesh with all parameter sets and solver types, with each of the
+  // thread counts
+  bool run_mesh(const MeshEntry &entry, const GeodesicOperator &op,
+                const MeshGenerator::Spec *spec, const Matrix3X &points,
+                const std::vector<int> &n_threads);
+
+  template<typename SolverT>
+  bool run_solver(const GeodesicOperator &op, const Parameters &param,
+                  const DenseVector &reference, int n_threads, Run &run);
+};
+
+#endif /* SCALINGSTUDY_H_ */
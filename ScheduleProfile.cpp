@@ -0,0 +1,174 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "ScheduleProfile.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+int find_name(const char* const *names, int n_names, const std::string &name) {
+  for (int i = 0; i < n_names; ++i) {
+    if (name == names[i]) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+const char* const kPhaseNames[ScheduleProfile::PHASE_COUNT] = { "heat",
+    "setup", "admm", "integration" };
+
+}
+
+const char* ScheduleProfile::phase_name(int phase) {
+  return (phase >= 0 && phase < PHASE_COUNT) ? kPhaseNames[phase] : "unknown";
+}
+
+int ScheduleProfile::size_bucket(MeshIndex n_vertices) {
+  int bucket = 0;
+  while (n_vertices > 1) {
+    n_vertices /= 2;
+    bucket++;
+  }
+
+  return bucket;
+}
+
+bool ScheduleProfile::load(const std::string &file_name) {
+  entries.clear();
+
+  std::ifstream ifile(file_name.c_str());
+  if (!ifile.is_open()) {
+    return true;
+  }
+
+  const char* kind_names[LoopSchedule::KIND_COUNT];
+  for (int i = 0; i < LoopSchedule::KIND_COUNT; ++i) {
+    kind_names[i] = LoopSchedule::kind_name(i);
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(ifile, line)) {
+    line_number++;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream istr(line);
+    Entry entry;
+    std::string phase, kind;
+    if (!(istr >> entry.solver_type >> entry.bucket >> phase
+        >> entry.schedule.n_threads >> kind >> entry.schedule.chunk_size)) {
+      std::cerr << "Error parsing line " << line_number << " of schedule profile "
+                << file_name << std::endl;
+      return false;
+    }
+
+    entry.phase = find_name(kPhaseNames, PHASE_COUNT, phase);
+    entry.schedule.kind = find_name(kind_names, LoopSchedule::KIND_COUNT, kind);
+    if (entry.phase < 0 || entry.schedule.kind < 0
+        || entry.schedule.n_threads < 0 || entry.schedule.chunk_size < 0) {
+      std::cerr << "Error: invalid schedule on line " << line_number
+                << " of schedule profile " << file_name << std::endl;
+      return false;
+    }
+
+    entries.push_back(entry);
+  }
+
+  return true;
+}
+
+bool ScheduleProfile::save(const std::string &file_name) const {
+  std::ofstream ofile(file_name.c_str());
+  if (!ofile.is_open()) {
+    std::cerr << "Unable to open file " << file_name << std::endl;
+    return false;
+  }
+
+  ofile << "# Loop schedules of the solver phases, found with Autotune 1\n";
+  ofile << "# Solver type, mesh size bucket (log2 of the number of vertices),"
+        << " phase, threads, schedule, chunk size\n";
+  for (int i = 0; i < static_cast<int>(entries.size()); ++i) {
+    const Entry &entry = entries[i];
+    ofile << entry.solver_type << ' ' << entry.bucket << ' '
+          << phase_name(entry.phase) << ' ' << entry.schedule.n_threads << ' '
+          << LoopSchedule::kind_name(entry.schedule.kind) << ' '
+          << entry.schedule.chunk_size << '\n';
+  }
+
+  if (!ofile) {
+    std::cerr << "Error writing to file " << file_name << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool ScheduleProfile::find(int solver_type, int bucket,
+                           LoopSchedule *schedules) const {
+  bool found[PHASE_COUNT] = { false, false, false, false };
+  for (int i = 0; i < static_cast<int>(entries.size()); ++i) {
+    const Entry &entry = entries[i];
+    if (entry.solver_type == solver_type && entry.bucket == bucket) {
+      schedules[entry.phase] = entry.schedule;
+      found[entry.phase] = true;
+    }
+  }
+
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    if (!found[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ScheduleProfile::set(int solver_type, int bucket,
+                          const LoopSchedule *schedules) {
+  std::vector<Entry> kept;
+  for (int i = 0; i < static_cast<int>(entries.size()); ++i) {
+    if (entries[i].solver_type != solver_type || entries[i].bucket != bucket) {
+      kept.push_back(entries[i]);
+    }
+  }
+
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    Entry entry = { solver_type, bucket, i, schedules[i] };
+    kept.push_back(entry);
+  }
+
+  entries.swap(kept);
+}
@@ -0,0 +1,82 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SCHEDULEPROFILE_H_
+#define SCHEDULEPROFILE_H_
+
+#include "EigenTypes.h"
+#include "OMPHelper.h"
+#include <string>
+#include <vector>
+
+// Loop schedules of the solver phases found by autotuning, for each solver
+// type and mesh size bucket, stored in a text file with one line per phase:
+//   SOLVER_TYPE SIZE_BUCKET PHASE N_THREADS SCHEDULE CHUNK_SIZE
+// where SIZE_BUCKET is the base-2 logarithm of the number of vertices, rounded
+// down, and SCHEDULE is static, dynamic or guided. Lines starting with '#' are
+// comments.
+class ScheduleProfile {
+ public:
+  // Phases with tuned schedules, in the order of the solver phases
+  enum Phase {
+    HEAT = 0,
+    SETUP = 1,
+    ADMM = 2,
+    INTEGRATION = 3,
+    PHASE_COUNT = 4
+  };
+
+  static const char* phase_name(int phase);
+
+  static int size_bucket(MeshIndex n_vertices);
+
+  // Read the file; a missing file gives an empty profile
+  bool load(const std::string &file_name);
+
+  bool save(const std::string &file_name) const;
+
+  // Get the schedules of all phases, if the profile has them
+  bool find(int solver_type, int bucket, LoopSchedule *schedules) const;
+
+  void set(int solver_type, int bucket, const LoopSchedule *schedules);
+
+ private:
+  struct Entry {
+    int solver_type;
+    int bucket;
+    int phase;
+    LoopSchedule schedule;
+  };
+
+  std::vector<Entry> entries;
+};
+
+#endif /* SCHEDULEPROFILE_H_ */
@@ -0,0 +1,246 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "SolveMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+const char* const kPhaseNames[SolveMetrics::PHASE_COUNT] = { "load", "bfs",
+    "heat", "setup", "admm", "integration" };
+
+// Serializes the records appended by concurrent solves in this process
+std::mutex append_mutex;
+
+void write_string(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = str[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      const char *hex = "0123456789abcdef";
+      out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+// JSON has no infinity or NaN
+void write_number(std::ostream &out, double value) {
+  if (std::isfinite(value)) {
+    out << value;
+  } else {
+    out << "null";
+  }
+}
+
+const char* bool_name(bool value) {
+  return value ? "true" : "false";
+}
+
+}
+
+const char* SolveMetrics::phase_name(int phase) {
+  return kPhaseNames[phase];
+}
+
+double SolveMetrics::Phase::bandwidth() const {
+  if (buffer_bytes < 0 || sweeps < 0 || wall_seconds <= 0) {
+    return -1;
+  }
+
+  return double(buffer_bytes) * double(sweeps) / wall_seconds;
+}
+
+void SolveMetrics::Phase::set_events(const PerfCounters::Sample &s0,
+                                     const PerfCounters::Sample &s1) {
+  for (int event = 0; event < PerfCounters::EVENT_COUNT; ++event) {
+    events[event] = (s0.events[event] >= 0 && s1.events[event] >= 0) ?
+        s1.events[event] - s0.events[event] : -1;
+  }
+
+  thread_events.clear();
+  if (s0.thread_events.size() == s1.thread_events.size()) {
+    thread_events.resize(s1.thread_events.size());
+    for (size_t i = 0; i < s1.thread_events.size(); ++i) {
+      thread_events[i] = (s0.thread_events[i] >= 0
+          && s1.thread_events[i] >= 0) ?
+          s1.thread_events[i] - s0.thread_events[i] : -1;
+    }
+  }
+}
+
+SolveMetrics::SolveMetrics() {
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    phases.push_back(Phase(kPhaseNames[i]));
+  }
+  reset();
+}
+
+void SolveMetrics::reset() {
+  success = false;
+  solver_type = -1;
+  n_threads = -1;
+  n_vertices = n_faces = n_edges = -1;
+  heat_iterations = -1;
+  heat_residual = heat_threshold = -1;
+  heat_converged = false;
+  admm_iterations = -1;
+  primal_residual = dual_residual = -1;
+  admm_converged = false;
+  buffer_bytes = -1;
+  thread_ids.clear();
+
+  for (int i = BFS; i < PHASE_COUNT; ++i) {
+    phases[i] = Phase(kPhaseNames[i]);
+  }
+}
+
+void SolveMetrics::write_json(std::ostream &out) const {
+  std::streamsize precision = out.precision(
+      std::numeric_limits<double>::digits10 + 2);
+
+  double wall_seconds = 0, cpu_seconds = 0;
+  long long peak_resident_bytes = -1;
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    wall_seconds += std::max(phases[i].wall_seconds, 0.0);
+    cpu_seconds += std::max(phases[i].cpu_seconds, 0.0);
+    peak_resident_bytes = std::max(peak_resident_bytes,
+                                   phases[i].peak_resident_bytes);
+  }
+
+  out << "{\"schema\":" << kSchemaVersion;
+  out << ",\"success\":" << bool_name(success);
+  out << ",\"mesh\":";
+  write_string(out, mesh);
+  out << ",\"solver\":\""
+      << (solver_type == 0 ? "face" : (solver_type == 1 ? "edge" : "unknown"))
+      << "\"";
+  out << ",\"threads\":" << n_threads;
+  out << ",\"vertices\":" << n_vertices << ",\"faces\":" << n_faces
+      << ",\"edges\":" << n_edges;
+
+  out << ",\"heat\":{\"iterations\":" << heat_iterations << ",\"residual\":";
+  write_number(out, heat_residual);
+  out << ",\"threshold\":";
+  write_number(out, heat_threshold);
+  out << ",\"converged\":" << bool_name(heat_converged) << "}";
+
+  out << ",\"admm\":{\"iterations\":" << admm_iterations
+      << ",\"primal_residual\":";
+  write_number(out, primal_residual);
+  out << ",\"dual_residual\":";
+  write_number(out, dual_residual);
+  out << ",\"converged\":" << bool_name(admm_converged) << "}";
+
+  out << ",\"phases\":[";
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    const Phase &phase = phases[i];
+    out << (i > 0 ? "," : "") << "{\"name\":\"" << phase.name << "\"";
+    out << ",\"wall_seconds\":";
+    write_number(out, phase.wall_seconds);
+    out << ",\"cpu_seconds\":";
+    write_number(out, phase.cpu_seconds);
+    out << ",\"threads\":" << phase.n_threads;
+    out << ",\"sweeps\":" << phase.sweeps;
+    out << ",\"buffer_bytes\":" << phase.buffer_bytes;
+    out << ",\"bandwidth_bytes_per_second\":";
+    write_number(out, phase.bandwidth());
+    out << ",\"resident_bytes\":" << phase.resident_bytes;
+    out << ",\"peak_resident_bytes\":" << phase.peak_resident_bytes;
+
+    out << ",\"hardware\":{";
+    for (int event = 0; event < PerfCounters::EVENT_COUNT; ++event) {
+      out << (event > 0 ? "," : "") << "\"" << PerfCounters::event_name(event)
+          << "\":" << phase.events[event];
+    }
+    if (!phase.thread_events.empty()) {
+      out << ",\"threads\":[";
+      for (size_t t = 0; t < thread_ids.size(); ++t) {
+        out << (t > 0 ? "," : "") << "{\"tid\":" << thread_ids[t];
+        for (int event = 0; event < PerfCounters::EVENT_COUNT; ++event) {
+          out << ",\"" << PerfCounters::event_name(event) << "\":"
+              << phase.thread_events[t * PerfCounters::EVENT_COUNT + event];
+        }
+        out << "}";
+      }
+      out << "]";
+    }
+    out << "}}";
+  }
+  out << "]";
+
+  out << ",\"wall_seconds\":";
+  write_number(out, wall_seconds);
+  out << ",\"cpu_seconds\":";
+  write_number(out, cpu_seconds);
+  out << ",\"buffer_bytes\":" << buffer_bytes;
+  out << ",\"peak_resident_bytes\":" << peak_resident_bytes << "}";
+
+  out.precision(precision);
+}
+
+bool SolveMetrics::append(const std::string &file_name) const {
+  // Format the whole line first, so that it is written at once
+  std::ostringstream line;
+  write_json(line);
+  line << '\n';
+
+  std::lock_guard<std::mutex> lock(append_mutex);
+  if (file_name == "-") {
+    std::cout << line.str() << std::flush;
+    return true;
+  }
+
+  std::ofstream ofile(file_name.c_str(), std::ios::app);
+  if (!ofile.is_open()) {
+    std::cerr << "Error: unable to open metrics file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  ofile << line.str() << std::flush;
+  if (!ofile) {
+    std::cerr << "Error: unable to write metrics file " << file_name
+              << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,140 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef SOLVEMETRICS_H_
+#define SOLVEMETRICS_H_
+
+#include "PerfCounters.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Record of one solve for monitoring, appended to a file as one line of JSON
+// (JSON Lines), so that the records of many runs can be collected and
+// aggregated. Version 2 of the schema has the fields:
+//   schema, success, mesh, solver ("face" or "edge"), threads,
+//   vertices, faces, edges,
+//   heat: {iterations, residual, threshold, converged},
+//   admm: {iterations, primal_residual, dual_residual, converged},
+//   phases: [{name, wall_seconds, cpu_seconds, threads, sweeps, buffer_bytes,
+//             bandwidth_bytes_per_second, resident_bytes,
+//             peak_resident_bytes, hardware}, ...],
+//   wall_seconds, cpu_seconds, buffer_bytes, peak_resident_bytes
+// with the phases load, bfs, heat, setup, admm and integration in this order.
+// hardware has the counts of the events of PerfCounters in the phase, named
+// by PerfCounters::event_name(), and if they are counted per thread, a list
+// threads of objects with the tid and the counts of each thread (version 2).
+// Times are wall time from a monotonic clock and CPU time of all threads of
+// the process; resident sizes are taken at the end of each phase. The
+// bandwidth is estimated as the bytes of the buffers live in the phase times
+// the number of sweeps over them, over the wall time. Numbers that are not
+// available are -1. Later versions only add fields.
+struct SolveMetrics {
+  static const int kSchemaVersion = 2;
+
+  struct Phase {
+    const char *name;
+    double wall_seconds;
+    double cpu_seconds;
+    int n_threads;
+    long long sweeps;
+    long long buffer_bytes;
+    long long resident_bytes;
+    long long peak_resident_bytes;
+    long long events[PerfCounters::EVENT_COUNT];
+
+    // EVENT_COUNT counts for each of thread_ids, if counted per thread
+    std::vector<long long> thread_events;
+
+    explicit Phase(const char *phase_name = "")
+        : name(phase_name),
+          wall_seconds(-1),
+          cpu_seconds(-1),
+          n_threads(-1),
+          sweeps(-1),
+          buffer_bytes(-1),
+          resident_bytes(-1),
+          peak_resident_bytes(-1) {
+      for (int i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+        events[i] = -1;
+      }
+    }
+
+    double bandwidth() const;
+
+    // Counts of the hardware events between two samples of the counters
+    void set_events(const PerfCounters::Sample &s0,
+                    const PerfCounters::Sample &s1);
+  };
+
+  enum PhaseIndex {
+    LOAD = 0,
+    BFS = 1,
+    HEAT = 2,
+    SETUP = 3,
+    ADMM = 4,
+    INTEGRATION = 5,
+    PHASE_COUNT = 6
+  };
+
+  static const char* phase_name(int phase);
+
+  bool success;
+  std::string mesh;
+  int solver_type;
+  int n_threads;
+  long long n_vertices, n_faces, n_edges;
+
+  int heat_iterations;
+  double heat_residual, heat_threshold;
+  bool heat_converged;
+
+  int admm_iterations;
+  double primal_residual, dual_residual;
+  bool admm_converged;
+
+  std::vector<Phase> phases;
+  long long buffer_bytes;
+  std::vector<int> thread_ids;  // Threads of the per-thread event counts
+
+  SolveMetrics();
+
+  // Clear all values except those of the load phase
+  void reset();
+
+  void write_json(std::ostream &out) const;
+
+  // Append the record as one line to the file, or to the standard output if
+  // file_name is "-". Records of concurrent solves are not interleaved.
+  bool append(const std::string &file_name) const;
+};
+
+#endif /* SOLVEMETRICS_H_ */
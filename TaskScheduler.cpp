@@ -0,0 +1,229 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "TaskScheduler.h"
+#include "NumaPlacement.h"
+
+namespace {
+
+// Scheduler made current by a Scope on this thread
+thread_local TaskScheduler *scoped_scheduler = NULL;
+
+// Scheduler owning this thread and the index of its queue, if it is a worker
+thread_local TaskScheduler *owner_scheduler = NULL;
+thread_local int owner_queue_index = -1;
+
+}
+
+TaskScheduler::TaskScheduler(int n_threads, int affinity)
+    : n_queued_tasks(0),
+      steal_count(0),
+      stopping(false),
+      thread_affinity(affinity) {
+  if (n_threads <= 0) {
+    n_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  int n_workers = n_threads - 1;
+  for (int i = 0; i <= n_workers; ++i) {
+    queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+  }
+
+  for (int i = 0; i < n_workers; ++i) {
+    workers.push_back(std::thread(&TaskScheduler::worker_loop, this, i));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake_up.notify_all();
+
+  for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+    workers[i].join();
+  }
+}
+
+TaskScheduler& TaskScheduler::current() {
+  if (scoped_scheduler) {
+    return *scoped_scheduler;
+  }
+
+  if (owner_scheduler) {
+    return *owner_scheduler;
+  }
+
+  static TaskScheduler default_scheduler;
+  return default_scheduler;
+}
+
+TaskScheduler::Scope::Scope(TaskScheduler &scheduler)
+    : previous(scoped_scheduler) {
+  scoped_scheduler = &scheduler;
+}
+
+TaskScheduler::Scope::~Scope() {
+  scoped_scheduler = previous;
+}
+
+int TaskScheduler::caller_queue() const {
+  return (owner_scheduler == this) ?
+      owner_queue_index : static_cast<int>(workers.size());
+}
+
+void TaskScheduler::run_job(RangeJob &job, long long begin, long long end) {
+  int queue_index = caller_queue();
+  RangeTask root = { &job, begin, end };
+  execute(root, queue_index);
+
+  // Help with other tasks until all ranges of the job are complete
+  RangeTask task;
+  while (job.n_pending.load(std::memory_order_acquire) > 0) {
+    if (pop(queue_index, task) || steal(queue_index, task)) {
+      execute(task, queue_index);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void TaskScheduler::execute(const RangeTask &task, int queue_index) {
+  RangeJob *job = task.job;
+  long long begin = task.begin, end = task.end;
+  TaskQueue &queue = *queues[queue_index];
+
+  while (begin < end) {
+    if (end - begin > job->grain_size && queue.size.load() == 0) {
+      // Our queue has been emptied by thieves: offer half of the rest
+      long long mid = begin + (end - begin) / 2;
+      job->n_pending.fetch_add(1);
+      RangeTask upper = { job, mid, end };
+      push(queue_index, upper);
+      end = mid;
+    } else {
+      long long chunk_end = std::min(end, begin + job->grain_size);
+      job->run(job->body, begin, chunk_end);
+      begin = chunk_end;
+    }
+  }
+
+  job->n_pending.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskScheduler::push(int queue_index, const RangeTask &task) {
+  TaskQueue &queue = *queues[queue_index];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+    queue.size++;
+  }
+  n_queued_tasks++;
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+  }
+  wake_up.notify_one();
+}
+
+bool TaskScheduler::pop(int queue_index, RangeTask &task) {
+  TaskQueue &queue = *queues[queue_index];
+  if (queue.size.load() == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+
+  task = queue.tasks.back();
+  queue.tasks.pop_back();
+  queue.size--;
+  n_queued_tasks--;
+  return true;
+}
+
+bool TaskScheduler::steal(int queue_index, RangeTask &task) {
+  int n_queues = queues.size();
+  for (int k = 1; k < n_queues; ++k) {
+    TaskQueue &queue = *queues[(queue_index + k) % n_queues];
+    if (queue.size.load() == 0) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    queue.size--;
+    n_queued_tasks--;
+    steal_count++;
+    return true;
+  }
+
+  return false;
+}
+
+void TaskScheduler::worker_loop(int index) {
+  owner_scheduler = this;
+  owner_queue_index = index;
+  NumaPlacement::pin_current_thread(
+      NumaPlacement::thread_cpu(thread_affinity, index + 1));
+
+  RangeTask task;
+  int n_failed_attempts = 0;
+  while (true) {
+    if (pop(index, task) || steal(index, task)) {
+      execute(task, index);
+      n_failed_attempts = 0;
+      continue;
+    }
+
+    if (++n_failed_attempts < kSpinCount) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    if (stopping) {
+      return;
+    }
+
+    if (n_queued_tasks.load() == 0) {
+      wake_up.wait(lock);
+    }
+    n_failed_attempts = 0;
+  }
+}
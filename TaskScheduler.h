@@ -0,0 +1,192 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2019, Jiong Tao, Bailin Deng, Yue Peng
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef TASKSCHEDULER_H_
+#define TASKSCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing scheduler for parallel loops, used as an alternative to
+// OpenMP when the code is built with PARALLEL_BACKEND=Tasks.
+//
+// A parallel loop is a range task. The thread executing a range splits off
+// the upper half of its remaining iterations whenever its own queue is empty,
+// i.e. when the previously split-off work has been stolen by idle threads
+// (lazy binary splitting). Ranges are thus only split when other threads can
+// take them, which balances irregular loops without a fixed chunk size.
+//
+// Each worker owns a double-ended queue: it pushes and pops at the back, and
+// idle threads steal from the front of other queues. The thread calling
+// parallel_for() takes part in the work until the loop is complete, so
+// parallel_for() may be called from any thread, including threads of the host
+// application.
+//
+// To run the solvers on a scheduler owned by the host application, create a
+// Scope for it on the calling thread; otherwise a default scheduler with all
+// hardware threads is used.
+class TaskScheduler {
+ public:
+  // n_threads is the number of threads executing tasks, including the thread
+  // that calls parallel_for(); 0 uses all hardware threads. Workers are pinned
+  // as threads 1 to n_threads - 1 of a NumaPlacement::Affinity policy; the
+  // calling thread counts as thread 0 and is left unpinned.
+  explicit TaskScheduler(int n_threads = 0, int affinity = 0);
+  ~TaskScheduler();
+
+  int n_threads() const {
+    return static_cast<int>(workers.size()) + 1;
+  }
+
+  // Call body(i) for every i in [begin, end), and return when all calls are
+  // complete. Ranges of at most grain_size iterations are not split further;
+  // 0 chooses it from the range length and the number of threads. Indices are
+  // 64-bit, to cover loops over the elements of meshes with 64-bit indices.
+  template<typename Body>
+  void parallel_for(long long begin, long long end, const Body &body,
+                    long long grain_size = 0);
+
+  // Number of range tasks taken from the queue of another thread
+  long long n_steals() const {
+    return steal_count.load();
+  }
+
+  // The scheduler used by the calling thread: the innermost Scope on this
+  // thread, the scheduler owning this thread if it is a worker, or the
+  // default scheduler.
+  static TaskScheduler& current();
+
+  // Make a scheduler current on the calling thread during the scope's lifetime
+  class Scope {
+   public:
+    explicit Scope(TaskScheduler &scheduler);
+    ~Scope();
+
+   private:
+    TaskScheduler *previous;
+
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+  };
+
+ private:
+  // Ranges smaller than this are never split, to bound the overhead of tasks
+  static const int kMinGrainSize = 128;
+
+  // Number of unsuccessful attempts to find a task before a worker sleeps
+  static const int kSpinCount = 1000;
+
+  struct RangeJob {
+    void (*run)(const void *body, long long begin, long long end);
+    const void *body;
+    long long grain_size;
+    std::atomic<int> n_pending;  // Range tasks of this job not yet completed
+  };
+
+  struct RangeTask {
+    RangeJob *job;
+    long long begin;
+    long long end;
+  };
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<RangeTask> tasks;
+    std::atomic<int> size;
+
+    TaskQueue()
+        : size(0) {
+    }
+  };
+
+  // One queue for each worker, and a last one shared by all other threads
+  std::vector<std::unique_ptr<TaskQueue> > queues;
+  std::vector<std::thread> workers;
+
+  std::mutex sleep_mutex;
+  std::condition_variable wake_up;
+  std::atomic<int> n_queued_tasks;
+  std::atomic<long long> steal_count;
+  bool stopping;
+  int thread_affinity;
+
+  template<typename Body>
+  static void run_range(const void *body, long long begin, long long end) {
+    const Body &b = *static_cast<const Body*>(body);
+    for (long long i = begin; i < end; ++i) {
+      b(i);
+    }
+  }
+
+  int caller_queue() const;
+  void run_job(RangeJob &job, long long begin, long long end);
+  void execute(const RangeTask &task, int queue_index);
+  void push(int queue_index, const RangeTask &task);
+  bool pop(int queue_index, RangeTask &task);
+  bool steal(int queue_index, RangeTask &task);
+  void worker_loop(int index);
+
+  TaskScheduler(const TaskScheduler&);
+  TaskScheduler& operator=(const TaskScheduler&);
+};
+
+template<typename Body>
+void TaskScheduler::parallel_for(long long begin, long long end,
+                                 const Body &body, long long grain_size) {
+  if (end <= begin) {
+    return;
+  }
+
+  if (grain_size <= 0) {
+    grain_size = std::max<long long>(kMinGrainSize,
+                                     (end - begin) / (8 * n_threads()));
+  }
+
+  if (workers.empty() || end - begin <= grain_size) {
+    run_range<Body>(&body, begin, end);
+    return;
+  }
+
+  RangeJob job;
+  job.run = &run_range<Body>;
+  job.body = &body;
+  job.grain_size = grain_size;
+  job.n_pending = 1;
+  run_job(job, begin, end);
+}
+
+#endif /* TASKSCHEDULER_H_ */
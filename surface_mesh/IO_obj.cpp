@@ -138,7 +138,7 @@ bool read_obj(Surface_mesh& mesh, const std::string& filename)
               {
                 case 0: // vertex
                 {
-                  vertices.push_back( Surface_mesh::Vertex(atoi(p0) - 1) );
+                  vertices.push_back( Surface_mesh::Vertex(atoll(p0) - 1) );
                   break;
                 }
                 case 1: // texture coord
@@ -258,13 +258,13 @@ bool write_obj(const Surface_mesh& mesh, const std::string& filename)
             if(with_tex_coord)
             {
                 // write vertex index, tex_coord index and normal index
-                fprintf(out, " %d/%d/%d", (*fvit).idx()+1, (*fhit).idx()+1, (*fvit).idx()+1);
+                fprintf(out, " %lld/%lld/%lld", (long long)(*fvit).idx()+1, (long long)(*fhit).idx()+1, (long long)(*fvit).idx()+1);
                 ++fhit;
             }
             else
             {
                 // write vertex index and normal index
-                fprintf(out, " %d//%d", (*fvit).idx()+1, (*fvit).idx()+1);
+                fprintf(out, " %lld//%lld", (long long)(*fvit).idx()+1, (long long)(*fvit).idx()+1);
             }
         }
         while (++fvit != fvend);
@@ -54,8 +54,9 @@ bool read_off_ascii(Surface_mesh& mesh,
 {
     char                 line[200], *lp;
     int                  nc;
-    unsigned int         i, j, items, idx;
-    unsigned int         nV, nF, nE;
+    unsigned int         j, items;
+    long long            i, idx;
+    long long            nV, nF, nE;
     Vec3f                p, n, c;
     Vec2f                t;
     Surface_mesh::Vertex v;
@@ -71,7 +72,7 @@ bool read_off_ascii(Surface_mesh& mesh,
 
 
     // #Vertice, #Faces, #Edges
-    items = fscanf(in, "%d %d %d\n", (int*)&nV, (int*)&nF, (int*)&nE);
+    items = fscanf(in, "%lld %lld %lld\n", &nV, &nF, &nE);
     mesh.clear();
     mesh.reserve(nV, std::max(3*nV, nE), nF);
 
@@ -132,7 +133,7 @@ bool read_off_ascii(Surface_mesh& mesh,
         lp = line;
 
         // #vertices
-        items = sscanf(lp, "%d%n", (int*)&nV, &nc);
+        items = sscanf(lp, "%lld%n", &nV, &nc);
         assert(items == 1);
         vertices.resize(nV);
         lp += nc;
@@ -140,7 +141,7 @@ bool read_off_ascii(Surface_mesh& mesh,
         // indices
         for (j=0; j<nV; ++j)
         {
-            items = sscanf(lp, "%d%n", (int*)&idx, &nc);
+            items = sscanf(lp, "%lld%n", &idx, &nc);
             assert(items == 1);
             vertices[j] = Surface_mesh::Vertex(idx);
             lp += nc;
@@ -320,7 +321,7 @@ bool write_off(const Surface_mesh& mesh, const std::string& filename)
         fprintf(out, "C");
     if(has_normals)
         fprintf(out, "N");
-    fprintf(out, "OFF\n%d %d 0\n", mesh.n_vertices(), mesh.n_faces());
+    fprintf(out, "OFF\n%llu %llu 0\n", (unsigned long long)mesh.n_vertices(), (unsigned long long)mesh.n_faces());
 
 
     // vertices, and optionally normals and texture coordinates
@@ -360,7 +361,7 @@ bool write_off(const Surface_mesh& mesh, const std::string& filename)
         Surface_mesh::Vertex_around_face_circulator fvit=mesh.vertices(*fit), fvend=fvit;
         do
         {
-            fprintf(out, " %d", (*fvit).idx());
+            fprintf(out, " %lld", (long long)(*fvit).idx());
         }
         while (++fvit != fvend);
         fprintf(out, "\n");
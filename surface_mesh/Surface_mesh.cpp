@@ -222,9 +222,9 @@ free_memory()
 
 void
 Surface_mesh::
-reserve(unsigned int nvertices,
-        unsigned int nedges,
-        unsigned int nfaces )
+reserve(SizeType nvertices,
+        SizeType nedges,
+        SizeType nfaces )
 {
     vprops_.reserve(nvertices);
     hprops_.reserve(2*nedges);
@@ -1574,7 +1574,7 @@ void
 Surface_mesh::
 garbage_collection()
 {
-    int  i, i0, i1,
+    IndexType  i, i0, i1,
     nV(vertices_size()),
     nE(edges_size()),
     nH(halfedges_size()),
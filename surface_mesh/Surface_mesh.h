@@ -51,10 +51,10 @@ public: //------------------------------------------------------ topology types
     public:
 
         /// constructor
-        explicit Base_handle(int _idx=-1) : idx_(_idx) {}
+        explicit Base_handle(IndexType _idx=-1) : idx_(_idx) {}
 
         /// Get the underlying index of this handle
-        int idx() const { return idx_; }
+        IndexType idx() const { return idx_; }
 
         /// reset handle to be invalid (index=-1)
         void reset() { idx_=-1; }
@@ -83,7 +83,7 @@ public: //------------------------------------------------------ topology types
         friend class Edge_iterator;
         friend class Face_iterator;
         friend class Surface_mesh;
-        int idx_;
+        IndexType idx_;
     };
 
 
@@ -92,7 +92,7 @@ public: //------------------------------------------------------ topology types
     struct Vertex : public Base_handle
     {
         /// default constructor (with invalid index)
-        explicit Vertex(int _idx=-1) : Base_handle(_idx) {}
+        explicit Vertex(IndexType _idx=-1) : Base_handle(_idx) {}
         std::ostream& operator<<(std::ostream& os) const { return os << 'v' << idx(); }
     };
 
@@ -102,7 +102,7 @@ public: //------------------------------------------------------ topology types
     struct Halfedge : public Base_handle
     {
         /// default constructor (with invalid index)
-        explicit Halfedge(int _idx=-1) : Base_handle(_idx) {}
+        explicit Halfedge(IndexType _idx=-1) : Base_handle(_idx) {}
     };
 
 
@@ -111,7 +111,7 @@ public: //------------------------------------------------------ topology types
     struct Edge : public Base_handle
     {
         /// default constructor (with invalid index)
-        explicit Edge(int _idx=-1) : Base_handle(_idx) {}
+        explicit Edge(IndexType _idx=-1) : Base_handle(_idx) {}
     };
 
 
@@ -120,7 +120,7 @@ public: //------------------------------------------------------ topology types
     struct Face : public Base_handle
     {
         /// default constructor (with invalid index)
-        explicit Face(int _idx=-1) : Base_handle(_idx) {}
+        explicit Face(IndexType _idx=-1) : Base_handle(_idx) {}
     };
 
 
@@ -971,23 +971,23 @@ public: //--------------------------------------------------- memory management
     //@{
 
     /// returns number of (deleted and valid) vertices in the mesh
-    unsigned int vertices_size() const { return (unsigned int) vprops_.size(); }
+    SizeType vertices_size() const { return (SizeType) vprops_.size(); }
     /// returns number of (deleted and valid)halfedge in the mesh
-    unsigned int halfedges_size() const { return (unsigned int) hprops_.size(); }
+    SizeType halfedges_size() const { return (SizeType) hprops_.size(); }
     /// returns number of (deleted and valid)edges in the mesh
-    unsigned int edges_size() const { return (unsigned int) eprops_.size(); }
+    SizeType edges_size() const { return (SizeType) eprops_.size(); }
     /// returns number of (deleted and valid)faces in the mesh
-    unsigned int faces_size() const { return (unsigned int) fprops_.size(); }
+    SizeType faces_size() const { return (SizeType) fprops_.size(); }
 
 
     /// returns number of vertices in the mesh
-    unsigned int n_vertices() const { return vertices_size() - deleted_vertices_; }
+    SizeType n_vertices() const { return vertices_size() - deleted_vertices_; }
     /// returns number of halfedge in the mesh
-    unsigned int n_halfedges() const { return halfedges_size() - 2*deleted_edges_; }
+    SizeType n_halfedges() const { return halfedges_size() - 2*deleted_edges_; }
     /// returns number of edges in the mesh
-    unsigned int n_edges() const { return edges_size() - deleted_edges_; }
+    SizeType n_edges() const { return edges_size() - deleted_edges_; }
     /// returns number of faces in the mesh
-    unsigned int n_faces() const { return faces_size() - deleted_faces_; }
+    SizeType n_faces() const { return faces_size() - deleted_faces_; }
 
 
     /// returns true iff the mesh is empty, i.e., has no vertices
@@ -1001,9 +1001,9 @@ public: //--------------------------------------------------- memory management
     void free_memory();
 
     /// reserve memory (mainly used in file readers)
-    void reserve(unsigned int nvertices,
-                 unsigned int nedges,
-                 unsigned int nfaces );
+    void reserve(SizeType nvertices,
+                 SizeType nedges,
+                 SizeType nfaces );
 
 
     /// remove deleted vertices/edges/faces
@@ -1039,22 +1039,22 @@ public: //--------------------------------------------------- memory management
     /// return whether vertex \c v is valid, i.e. the index is stores it within the array bounds.
     bool is_valid(Vertex v) const
     {
-        return (0 <= v.idx()) && (v.idx() < (int)vertices_size());
+        return (0 <= v.idx()) && (v.idx() < (IndexType)vertices_size());
     }
     /// return whether halfedge \c h is valid, i.e. the index is stores it within the array bounds.
     bool is_valid(Halfedge h) const
     {
-        return (0 <= h.idx()) && (h.idx() < (int)halfedges_size());
+        return (0 <= h.idx()) && (h.idx() < (IndexType)halfedges_size());
     }
     /// return whether edge \c e is valid, i.e. the index is stores it within the array bounds.
     bool is_valid(Edge e) const
     {
-        return (0 <= e.idx()) && (e.idx() < (int)edges_size());
+        return (0 <= e.idx()) && (e.idx() < (IndexType)edges_size());
     }
     /// return whether face \c f is valid, i.e. the index is stores it within the array bounds.
     bool is_valid(Face f) const
     {
-        return (0 <= f.idx()) && (f.idx() < (int)faces_size());
+        return (0 <= f.idx()) && (f.idx() < (IndexType)faces_size());
     }
 
     //@}
@@ -1827,9 +1827,9 @@ private: //------------------------------------------------------- private data
     Vertex_property<Normal>  vnormal_;
     Face_property<Normal>    fnormal_;
 
-    unsigned int deleted_vertices_;
-    unsigned int deleted_edges_;
-    unsigned int deleted_faces_;
+    SizeType deleted_vertices_;
+    SizeType deleted_edges_;
+    SizeType deleted_faces_;
     bool garbage_;
 
     // helper data for add_face()
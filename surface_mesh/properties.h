@@ -28,6 +28,7 @@
 #include <string>
 #include <algorithm>
 #include <typeinfo>
+#include <surface_mesh/types.h>
 
 
 //== NAMESPACE ================================================================
@@ -153,14 +154,14 @@ public:
 
 
     /// Access the i'th element. No range check is performed!
-    reference operator[](int _idx)
+    reference operator[](IndexType _idx)
     {
         assert( size_t(_idx) < data_.size() );
         return data_[_idx];
     }
 
     /// Const access to the i'th element. No range check is performed!
-    const_reference operator[](int _idx) const
+    const_reference operator[](IndexType _idx) const
     {
         assert( size_t(_idx) < data_.size());
         return data_[_idx];
@@ -214,13 +215,13 @@ public:
         return parray_ != NULL;
     }
 
-    reference operator[](int i)
+    reference operator[](IndexType i)
     {
         assert(parray_ != NULL);
         return (*parray_)[i];
     }
 
-    const_reference operator[](int i) const
+    const_reference operator[](IndexType i) const
     {
         assert(parray_ != NULL);
         return (*parray_)[i];
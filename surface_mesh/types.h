@@ -54,6 +54,16 @@ typedef Vector<Scalar,3> Color;
 /// Texture coordinate type
 typedef Vector<Scalar,3> Texture_coordinate;
 
+/// Index type of the element handles, and unsigned type of element counts:
+/// 64-bit if built with USE_64BIT_INDICES, for meshes beyond the range of int
+#ifdef USE_64BIT_INDICES
+typedef long long IndexType;
+typedef unsigned long long SizeType;
+#else
+typedef int IndexType;
+typedef unsigned int SizeType;
+#endif
+
 
 //=============================================================================
 } // namespace surface_mesh